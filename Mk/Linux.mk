@@ -3,3 +3,8 @@
 
 ARCH_FLAGS += -DLINUX -DKEEP_INLINES
 LIBS += -lrt
+
+# io_uring backend for the lock-free runtime's reactor (epoll otherwise)
+LIBURING := $(wildcard /usr/include/liburing.h)
+ARCH_FLAGS += $(if $(LIBURING),-DHAS_LIBURING,)
+LIBS += $(if $(LIBURING),-luring,)
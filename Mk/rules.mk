@@ -88,4 +88,10 @@ else
 DTRACE_GCC_OPTIMIZATIONS:=-O1 -finline-functions
 endif
 endif
+# Linux USDT probes (the same ofluxprobe.d provider), when sys/sdt.h
+# (systemtap-sdt-dev) is installed
+ifeq ($(_ARCH),Linux)
+SDT_HEADER:=$(wildcard /usr/include/sys/sdt.h)
+ARCH_FLAGS += $(if $(SDT_HEADER),-DHAS_SDT,)
+endif
 -include $(OFLUXSRCDIR)/Mk/$(_PROC).mk
@@ -0,0 +1,6 @@
+/* auto-generated - do not modify */
+
+ namespace oflux { const char * runtime_version = 
+""
+; }
+
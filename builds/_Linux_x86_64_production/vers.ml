@@ -0,0 +1,5 @@
+(* auto-generated - do not modify*)
+
+let vers= 
+""
+
@@ -95,6 +95,9 @@ let add_self_guardrefs pr =
         let add_self_guardref_nonabst nd =
                 let _,p1,p2 = nd.nodename in
                 { detached = nd.detached
+                ; priority = nd.priority
+                ; period = nd.period
+                ; maxinflight = nd.maxinflight
                 ; abstract = nd.abstract
                 ; ismutable = false
                 ; externalnode = nd.externalnode
@@ -296,6 +299,9 @@ let apply_guardref_subst gsubst pr =
                         in  Debug.dprint_string ("   n:"^(strip_position nd.nodename)^"\n"); List.iter dpgr nd.guardrefs
                 in
                 { detached = nd.detached
+                ; priority = nd.priority
+                ; period = nd.period
+                ; maxinflight = nd.maxinflight
                 ; abstract = nd.abstract
                 ; ismutable = nd.ismutable
                 ; nodename = nd.nodename
@@ -348,6 +354,9 @@ let hollow_out pr = (* used to make external instances for program append *)
 		} in
 	let on_node nd =
 		{ detached = nd.detached
+		; priority = nd.priority
+		; period = nd.period
+		; maxinflight = nd.maxinflight
 		; abstract = nd.abstract
 		; ismutable = nd.ismutable
 		; externalnode = true (* change done here *)
@@ -440,6 +449,9 @@ let flatten prog =
                 } in
 	let for_node_decl pre_mi pre_md nd =
 		{ detached = nd.detached
+		; priority = nd.priority
+		; period = nd.period
+		; maxinflight = nd.maxinflight
 		; abstract = nd.abstract
                 ; ismutable = nd.ismutable
                 ; externalnode = nd.externalnode
@@ -677,6 +689,9 @@ let flatten_plugin' plugin_name prog =
                 let isext = nd.externalnode
                 in
                 { detached = nd.detached
+                ; priority = nd.priority
+                ; period = nd.period
+                ; maxinflight = nd.maxinflight
                 ; abstract = nd.abstract
                 ; ismutable = nd.ismutable
                 ; externalnode = nd.externalnode
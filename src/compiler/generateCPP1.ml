@@ -964,6 +964,12 @@ let emit_atom_map_map plugin_opt symtable code =
 				^(get_atomic_class_str "" gd.gtype)^"> "
 				^clean_n^"_map; "
 				^clean_n^"_map_ptr = & "^clean_n^"_map;")
+		    else if gd.gsharded then
+			("oflux::atomic::AtomicMapSharded<"^clean_n^"_key"
+				^","^(get_atomic_class_str "" gd.gtype)
+				^","^(if gd.gunordered then "false" else "true")
+				^"> "^clean_n^"_map; "
+				^clean_n^"_map_ptr = & "^clean_n^"_map;")
 		    else
                         let mappolicy =
                                 "oflux::atomic::"
@@ -1636,6 +1642,11 @@ let emit_test_main code =
 		; ", NULL"
 		; ", ofluximpl::init_atomic_maps"
 		; ", \"/tmp\" // subdir for door creations"
+		; ", 0 // spin budget before parking (0 = default)"
+		; ", 0 // hand off depth: ready successors run in a row (0 = default, < 0 = off)"
+		; ", 0 // wake threshold: events kept before waking others (0 = default, < 0 = none)"
+		; ", NULL // worker CPU list, e.g. \"2-7\" (NULL = not pinned)"
+		; ", NULL // housekeeping CPU list for doors/offload/reactor threads (NULL = not pinned)"
 		; "};"
 		; "oflux::logging::toStream(std::cout); // comment out if no oflux logging is desired"
 		; "oflux::EnvironmentVar env(oflux::runtime::Factory::"^(CmdLine.get_runtime_engine())^");"
@@ -25,7 +25,7 @@ open Flow
  general program structure is as follows:
   <flow name=... ofluxversion=...>
    <guard name=... magicnumber=.../>
-   <node name=... source=[true|false] iserrhandler=[true|false] detached=[true|false] inputunionhash=... outputunionhash=...> <!-- name of the node -->
+   <node name=... source=[true|false] iserrhandler=[true|false] detached=[true|false] priority=... period=... maxinflight=... inputunionhash=... outputunionhash=...> <!-- name of the node -->
     <guardref name=... wtype=... hash=... late=.../>
     <errorhandler name=.../>
     <successorlist> <!-- a list of concurrent branches -- all are taken -->
@@ -98,6 +98,9 @@ let xml_inputunionhash_str = "inputunionhash"
 let xml_outputunionhash_str = "outputunionhash"
 let xml_wtype_str = "wtype"
 let xml_detached_str = "detached"
+let xml_priority_str = "priority"
+let xml_period_str = "period"
+let xml_maxinflight_str = "maxinflight"
 let xml_external_str = "external"
 let xml_isnegated_str = "isnegated"
 let xml_iserrhandler_str = "iserrhandler"
@@ -186,7 +189,7 @@ let successorlist successors =
 		,[]
 		,successors)
 
-let node el_name el_function el_source el_door el_iserrorhandler el_detached el_external el_inputunionhash el_outputunionhash guardrefs errorhandler_opt successorlist =
+let node el_name el_function el_source el_door el_iserrorhandler el_detached el_priority el_period el_maxinflight el_external el_inputunionhash el_outputunionhash guardrefs errorhandler_opt successorlist =
 	Element(xml_node_str
 		,[ xml_name_str,el_name
 		 ; xml_function_str,el_function
@@ -194,6 +197,9 @@ let node el_name el_function el_source el_door el_iserrorhandler el_detached el_
 		 ; xml_door_str,el_door
 		 ; xml_iserrhandler_str,el_iserrorhandler
 		 ; xml_detached_str,el_detached
+		 ; xml_priority_str,el_priority
+		 ; xml_period_str,el_period
+		 ; xml_maxinflight_str,el_maxinflight
 		 ; xml_external_str,el_external
 		 ; xml_inputunionhash_str,el_inputunionhash
 		 ; xml_outputunionhash_str,el_outputunionhash
@@ -606,6 +612,9 @@ let emit_program_xml' programname br usesmodel =
                         (if is_dr then "true" else "false")
 			(if is_eh then "true" else "false")
 			(if is_dt then "true" else "false")
+			(string_of_int (SymbolTable.priority_of stable n))
+			(string_of_int (SymbolTable.period_of stable n))
+			(string_of_int (SymbolTable.maxinflight_of stable n))
 			(if is_ext then "true" else "false")
                         (n_in_uh)
                         (n_out_uh)
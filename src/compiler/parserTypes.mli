@@ -59,6 +59,9 @@ type guardref = { guardname: string positioned
 
 type node_decl = 
 	{ detached: bool
+	; priority: int (* run queue lane, 0 is bulk *)
+	; period: int (* us between source runs, 0 is back to back *)
+	; maxinflight: int (* events in flight before sources park, 0 is no limit *)
 	; abstract: bool
 	; ismutable: bool
         ; externalnode: bool
@@ -33,6 +33,9 @@ type node_data =
 		; nodeguardrefs: guardref list
 		; where: position 
 		; nodedetached: bool 
+		; nodepriority: int
+		; nodeperiod: int
+		; nodemaxinflight: int
                 ; nodeabstract: bool
                 ; nodeexternal: bool
                 }
@@ -50,6 +53,7 @@ type guard_data =
 		; magicnumber: int 
                 ; gunordered: bool
                 ; ggc: bool
+                ; gsharded: bool
                 }
 
 type module_inst_data =
@@ -100,6 +104,7 @@ let add_guard symtable g =
 		; magicnumber = mn
 		; gunordered = List.mem "unordered" g.atommodifiers
                 ; ggc = List.mem "gc" g.atommodifiers
+                ; gsharded = List.mem "sharded" g.atommodifiers
                 }) symtable in
 	let _ = next_magic_no := mn+1
 	in  res
@@ -127,6 +132,9 @@ let add_node_symbol symtable n =
 		; nodeguardrefs=n.guardrefs
 		; where=pos
 		; nodedetached=n.detached 
+		; nodepriority=n.priority
+		; nodeperiod=n.period
+		; nodemaxinflight=n.maxinflight
                 ; nodeabstract=(n.abstract || n.outputs = None)
                 ; nodeexternal=n.externalnode
                 }) symtable
@@ -156,6 +164,18 @@ let is_detached symtable name =
 	let x = lookup_node_symbol symtable name
 	in  x.nodedetached
 
+let priority_of symtable name =
+	let x = lookup_node_symbol symtable name
+	in  x.nodepriority
+
+let period_of symtable name =
+	let x = lookup_node_symbol symtable name
+	in  x.nodeperiod
+
+let maxinflight_of symtable name =
+	let x = lookup_node_symbol symtable name
+	in  x.nodemaxinflight
+
 let is_abstract symtable name =
 	let x = lookup_node_symbol symtable name
 	in  x.nodeabstract
@@ -48,6 +48,7 @@ type guard_data = { garguments: ParserTypes.decl_formal list
 		; magicnumber: int (* used for priority - text order in prog *)
                 ; gunordered: bool
                 ; ggc: bool
+                ; gsharded: bool (* classic runtime: AtomicMapSharded *)
 		}
 
 val add_guard : symbol_table -> ParserTypes.atom_decl -> symbol_table
@@ -67,6 +68,9 @@ type node_data =
 		; nodeguardrefs: ParserTypes.guardref list
 		; where: ParserTypes.position 
 		; nodedetached: bool 
+		; nodepriority: int
+		; nodeperiod: int
+		; nodemaxinflight: int
                 ; nodeabstract: bool
                 ; nodeexternal: bool
                 }
@@ -85,6 +89,9 @@ val fold_nodes : (string -> node_data -> 'b -> 'b) ->
 
 val is_detached : symbol_table -> string -> bool
 val is_abstract : symbol_table -> string -> bool
+val priority_of : symbol_table -> string -> int
+val period_of : symbol_table -> string -> int
+val maxinflight_of : symbol_table -> string -> int
 val is_external : symbol_table -> string -> bool
 
 val strip_position3 : ParserTypes.decl_formal -> string * string * string
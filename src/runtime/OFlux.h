@@ -199,14 +199,15 @@ extern E theE;
 // ----- EventBase Pointers (pretty important items really) ----
 
 class EventBase;
-typedef shared_ptr<EventBase> EventBaseSharedPtr;
+/// the reference count is held in the EventBase itself
+typedef intrusive_ptr<EventBase> EventBaseSharedPtr;
 
 /// implementation using shared pointers:
 #ifdef SHARED_PTR_EVENTS
 typedef EventBaseSharedPtr EventBasePtr; // full shared
 #define mk_EventBasePtr(X) EventBasePtr(X)
 #define mk_EventBaseSharedPtr(X) X
-#define get_EventBasePtr(X) (X.get())
+#define get_EventBasePtr(X) ((X).get())
 #define take_EventBasePtr(GETS,VAL) GETS.swap(VAL)
 #define get_EventBaseSharedPtr(X) X
 #define recover_EventBasePtr(X) (X.recover())
@@ -0,0 +1,168 @@
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "OFluxAffinity.h"
+#include "OFluxLogging.h"
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef LINUX
+# include <sched.h>
+# include <pthread.h>
+#endif // LINUX
+
+namespace oflux {
+
+CpuSet::CpuSet(const char * list)
+{
+	const char * err = parse(list,_cpus);
+	if(err) {
+		oflux_log_error("CpuSet::CpuSet() bad CPU list \"%s\": %s\n"
+			, list
+			, err);
+		_cpus.clear();
+	}
+	_str = to_str(_cpus);
+}
+
+static const char *
+parse_cpu(const char * & s, long & cpu)
+{
+	char * end = NULL;
+	if(*s < '0' || *s > '9') { // strtol() would skip blanks and signs
+		return "expected a CPU number";
+	}
+	cpu = strtol(s,&end,10);
+	s = end;
+	return (cpu >= CpuSet::Max_Cpus ? "CPU number too large" : NULL);
+}
+
+const char *
+CpuSet::parse(const char * list, std::vector<int> & cpus)
+{
+	cpus.clear();
+	const char * s = list;
+	while(s && *s) {
+		long lo = 0;
+		const char * err = parse_cpu(s,lo);
+		if(err) {
+			return err;
+		}
+		long hi = lo;
+		if(*s == '-') {
+			++s;
+			if((err = parse_cpu(s,hi)) != NULL) {
+				return err;
+			}
+			if(hi < lo) {
+				return "reversed range";
+			}
+		}
+		for(long c = lo; c <= hi; ++c) {
+			cpus.push_back((int)c);
+		}
+		if(*s == ',') {
+			++s;
+			if(!*s) {
+				return "trailing ','";
+			}
+		} else if(*s) {
+			return "expected ',' or '-'";
+		}
+	}
+	return NULL;
+}
+
+std::string
+CpuSet::to_str(const std::vector<int> & cpus)
+{
+	std::string res;
+	char buff[32];
+	for(size_t i = 0; i < cpus.size(); ) {
+		size_t j = i;
+		while(j+1 < cpus.size() && cpus[j+1] == cpus[j]+1) {
+			++j;
+		}
+		if(j > i) {
+			snprintf(buff,sizeof(buff),"%s%d-%d"
+				, res.empty() ? "" : ",", cpus[i], cpus[j]);
+		} else {
+			snprintf(buff,sizeof(buff),"%s%d"
+				, res.empty() ? "" : ",", cpus[i]);
+		}
+		res += buff;
+		i = j+1;
+	}
+	return res.empty() ? std::string("-") : res;
+}
+
+int
+CpuSet::pin(const std::vector<int> & cpus)
+{
+	if(cpus.empty()) {
+		return 0;
+	}
+#ifdef LINUX
+	cpu_set_t cs;
+	CPU_ZERO(&cs);
+	for(size_t i = 0; i < cpus.size(); ++i) {
+		CPU_SET(cpus[i],&cs);
+	}
+	int res = pthread_setaffinity_np(pthread_self(),sizeof(cs),&cs);
+	if(res) {
+		oflux_log_error("CpuSet::pin() failed to pin to %s (%d)\n"
+			, to_str(cpus).c_str()
+			, res);
+	}
+	return res;
+#else
+	return -1;
+#endif // LINUX
+}
+
+int
+CpuSet::pin() const
+{
+	return pin(_cpus);
+}
+
+int
+CpuSet::pin_one(int i) const
+{
+	if(empty()) {
+		return 0;
+	}
+	return pin(std::vector<int>(1,(*this)[i]));
+}
+
+std::string
+CpuSet::current()
+{
+	std::vector<int> cpus;
+#ifdef LINUX
+	cpu_set_t cs;
+	if(pthread_getaffinity_np(pthread_self(),sizeof(cs),&cs) == 0) {
+		for(int c = 0; c < CPU_SETSIZE; ++c) {
+			if(CPU_ISSET(c,&cs)) {
+				cpus.push_back(c);
+			}
+		}
+	}
+#endif // LINUX
+	return to_str(cpus);
+}
+
+} // namespace oflux
@@ -0,0 +1,81 @@
+#ifndef OFLUX_AFFINITY_H
+#define OFLUX_AFFINITY_H
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file OFluxAffinity.h
+ * @author Mark Pichora
+ * CPU placement of runtime threads.  RunTimeConfiguration::worker_cpus
+ * and housekeeping_cpus are CPU lists in the kernel's format ("0-3,8").
+ * Workers are pinned to the former, doors/offload/reactor threads to
+ * the latter.  Pinning is a no-op where it is not supported.
+ */
+
+#include <vector>
+#include <string>
+
+namespace oflux {
+
+class CpuSet {
+public:
+	enum { Max_Cpus = 1024 }; // as CPU_SETSIZE
+
+	/**
+	 * @param list is a CPU list like "0-3,8" (NULL or "" is empty;
+	 * a bad list is logged and also leaves the set empty)
+	 */
+	CpuSet(const char * list = NULL);
+	/**
+	 * @brief parse a CPU list into cpus
+	 * @return NULL on success, or what is wrong with the list
+	 * (a malformed entry, a reversed range like "8-2" or a CPU
+	 * number of Max_Cpus or more)
+	 */
+	static const char * parse(const char * list, std::vector<int> & cpus);
+	inline bool empty() const { return _cpus.empty(); }
+	inline int size() const { return (int)_cpus.size(); }
+	inline int operator[](int i) const { return _cpus[i % size()]; }
+	/**
+	 * @brief pin the calling thread to all of the CPUs in the set
+	 * @return 0 on success (or if the set is empty)
+	 */
+	int pin() const;
+	/**
+	 * @brief pin the calling thread to the i-th CPU (modulo size())
+	 */
+	int pin_one(int i) const;
+	/**
+	 * @return the set as a CPU list ("-" if empty)
+	 */
+	const std::string & str() const { return _str; }
+	/**
+	 * @return the CPUs the calling thread may run on as a CPU list
+	 */
+	static std::string current();
+private:
+	static int pin(const std::vector<int> & cpus);
+	static std::string to_str(const std::vector<int> & cpus);
+private:
+	std::vector<int> _cpus;
+	std::string _str;
+};
+
+} // namespace oflux
+
+#endif // OFLUX_AFFINITY_H
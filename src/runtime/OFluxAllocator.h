@@ -61,6 +61,7 @@ public:
 	{
 		ai.put(v); // no deferring happening
 	}
+	inline static void allocated() {} // not counted
 };
 
 
@@ -103,16 +104,16 @@ public:
 		}
 	}
 	inline T * get() 
-	{ return new (_impl->get()) T(); } // pattern new
+	{ DF::allocated(); return new (_impl->get()) T(); } // pattern new
 	template<typename R1>
 	inline T * get(R1 r1)
-	{ return new (_impl->get()) T(r1); } // pattern new
+	{ DF::allocated(); return new (_impl->get()) T(r1); } // pattern new
 	template<typename R1, typename R2>
 	inline T * get(R1 r1,R2 r2)
-	{ return new (_impl->get()) T(r1,r2); } // pattern new
+	{ DF::allocated(); return new (_impl->get()) T(r1,r2); } // pattern new
 	template<typename R1, typename R2, typename R3>
 	inline T * get(R1 r1,R2 r2,R3 r3)
-	{ return new (_impl->get()) T(r1,r2,r3); } // pattern new
+	{ DF::allocated(); return new (_impl->get()) T(r1,r2,r3); } // pattern new
 private:
 	AllocatorImplementation * _impl;
 };
@@ -97,6 +97,11 @@ struct RunTimeConfiguration {
 	void * init_plugin_params;
 	void (*initAtomicMapsF)(int);
 	const char * doors_dir;
+	int spin_budget; // lock-free: pause iterations polling before parking (0 = default)
+	int handoff_depth; // lock-free: ready successors run in a row without queueing (0 = default, < 0 = off)
+	int wake_threshold; // lock-free: events a thread keeps queued for itself before waking others (0 = default, < 0 = none)
+	const char * worker_cpus; // CPU list ("0-3,8") workers are pinned to (NULL = not pinned)
+	const char * housekeeping_cpus; // CPU list for doors/offload/reactor threads (NULL = not pinned)
 };
 
 } // namespace oflux
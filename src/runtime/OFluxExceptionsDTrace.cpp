@@ -17,6 +17,8 @@
  */
 #ifdef HAS_DTRACE
 # include "ofluxprobe.h"
+#else
+# include "OFluxLibDTrace.h"
 #endif
 
 extern "C" {
@@ -26,6 +28,7 @@ void trigger_probe_aha_exception_begin_throw(int i)
 #ifdef HAS_DTRACE
 	OFLUX_AHA_EXCEPTION_BEGIN_THROW(i);
 #else
+	PUBLIC_AHA_EXCEPTION_BEGIN_THROW(i);
 #endif
 }
 
@@ -34,7 +34,10 @@
 #include <sys/types.h>
 #include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <algorithm>
 #include <fcntl.h>
+#include <sched.h>
 #ifdef Darwin
 # include <sys/event.h>
 #elif defined LINUX
@@ -44,6 +47,24 @@
 #endif
 #ifdef HAS_DTRACE
 # include "ofluxshimprobe.h"
+#elif defined(HAS_SDT)
+// Linux USDT versions of the ofluxshimprobe.d probes (see OFluxLibDTrace.cpp)
+# define _SDT_HAS_SEMAPHORES 1
+# include <sys/sdt.h>
+extern "C" {
+volatile unsigned short oflux_shim__call_semaphore
+	__attribute__((section(".probes"))) = 0;
+volatile unsigned short oflux_shim__wait_semaphore
+	__attribute__((section(".probes"))) = 0;
+volatile unsigned short oflux_shim__return_semaphore
+	__attribute__((section(".probes"))) = 0;
+} // extern "C"
+# define OFLUX_SHIM_CALL(X) \
+	do { if(oflux_shim__call_semaphore) { STAP_PROBE1(oflux,shim__call,X); } } while(0)
+# define OFLUX_SHIM_WAIT(X) \
+	do { if(oflux_shim__wait_semaphore) { STAP_PROBE1(oflux,shim__wait,X); } } while(0)
+# define OFLUX_SHIM_RETURN(X) \
+	do { if(oflux_shim__return_semaphore) { STAP_PROBE1(oflux,shim__return,X); } } while(0)
 #else
 # define OFLUX_SHIM_CALL(X)
 # define OFLUX_SHIM_WAIT(X)
@@ -81,6 +102,31 @@ oflux::RunTimeAbstractForShim *eminfo = NULL;
 
 SafeArray<bool, 16384> is_regular;
 
+/**
+ * cached whole-file mapping of a regular fd (for mincore residency checks)
+ * The file it maps is checked with fstat() on each use (the fd may have
+ * been closed and reused without our close() seeing it).  busy is held
+ * while the mapping is used or replaced.
+ */
+struct ResidencyMap {
+    void * addr;
+    size_t len;
+    dev_t dev;
+    ino_t ino;
+    time_t mtime;
+    volatile int busy;
+};
+
+SafeArray<ResidencyMap, 16384> residency_map;
+
+// read() on a regular file: were the pages resident (no blocking)?
+static unsigned long read_resident_hits = 0;
+static unsigned long read_resident_misses = 0;
+
+#if defined LINUX && defined RWF_NOWAIT
+static bool has_rwf_nowait = true; // until the kernel says otherwise
+#endif
+
 extern "C" {
 
 typedef ssize_t (*readFnType) (int, void *, size_t);
@@ -135,6 +181,105 @@ static pollFnType shim_poll = NULL;
 
 static int page_size;
 
+static void unmap_residency_map(ResidencyMap & rm)
+{
+	if (rm.addr) {
+		munmap(rm.addr, rm.len);
+	}
+	rm.addr = NULL;
+	rm.len = 0;
+}
+
+static void drop_residency_map(int fd)
+{
+	ResidencyMap & rm = residency_map[fd];
+	while (__sync_lock_test_and_set(&rm.busy, 1)) {
+		sched_yield(); // a read on fd is checking it
+	}
+	unmap_residency_map(rm);
+	__sync_lock_release(&rm.busy);
+}
+
+/**
+ * @brief do the mapping and mincore check (rm.busy is held)
+ */
+static bool mapped_pages_resident(ResidencyMap & rm, int fd, size_t count)
+{
+	off_t off = lseek(fd, 0, SEEK_CUR);
+	struct stat st;
+	if (off < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+		return false;
+	}
+	if (rm.addr == NULL
+			|| rm.dev != st.st_dev
+			|| rm.ino != st.st_ino
+			|| rm.mtime != st.st_mtime
+			|| rm.len != (size_t)st.st_size) {
+		// not the file (or file contents) that was mapped
+		unmap_residency_map(rm);
+		if (st.st_size == 0) {
+			return true; // nothing to read
+		}
+		void *addr = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (addr == MAP_FAILED) {
+			return false;
+		}
+		rm.addr = addr;
+		rm.len = st.st_size;
+		rm.dev = st.st_dev;
+		rm.ino = st.st_ino;
+		rm.mtime = st.st_mtime;
+	}
+	size_t end = std::min((size_t)off + count, rm.len); // short read at EOF
+	if ((size_t)off >= end) {
+		return true; // at EOF
+	}
+	enum { Vec_Pages = 64 };
+	unsigned char vec[Vec_Pages];
+	size_t first = off & ~((size_t)page_size-1);
+	size_t npages = (end - first + page_size-1) / page_size;
+	for (size_t p = 0; p < npages; p += Vec_Pages) {
+		size_t n = std::min(npages - p, (size_t)Vec_Pages);
+		char * addr = (char*)rm.addr + first + p*page_size;
+#ifdef LINUX
+		if (mincore(addr, n*page_size, vec) < 0) {
+#else
+		if (mincore(addr, n*page_size, (char*)vec) < 0) {
+#endif
+			return false;
+		}
+		for (size_t i = 0; i < n; i++) {
+			if ((vec[i] & 0x1) == 0) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief are the pages for a read of count bytes at fd's offset resident?
+ * The file is mapped once (and again only when it changes), so this costs
+ * an lseek, an fstat and a mincore per read.  A read racing another on
+ * the same fd just reports the pages as not resident.
+ */
+static bool file_pages_resident(int fd, size_t count)
+{
+	ResidencyMap & rm = residency_map[fd];
+	if (__sync_lock_test_and_set(&rm.busy, 1)) {
+		return false;
+	}
+	bool res = mapped_pages_resident(rm, fd, count);
+	__sync_lock_release(&rm.busy);
+	return res;
+}
+
+extern "C" void shimReadStats(unsigned long *hits, unsigned long *misses)
+{
+	*hits = read_resident_hits;
+	*misses = read_resident_misses;
+}
+
 #define STRINGIFY(x) XSTRINGIFY(x)
 #define XSTRINGIFY(x) #x
 
@@ -324,36 +469,35 @@ extern "C" ssize_t read(int fd, void *buf, size_t count)
 		}
 	} else {
 		/*
-			Use mmap and mincore to find out if the page is in memory,
-			if YES, then just do the read
-			if NO, then use the thread-pool to fake asynch IO
+			If the pages are in memory just do the read,
+			otherwise use the thread-pool to fake asynch IO.
+			RWF_NOWAIT reads what is cached in one syscall,
+			a cached mapping + mincore is the fallback.
 		*/
-		off_t off = lseek(fd, 0, SEEK_CUR);
-		void *addr = mmap(0, count, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, off);
-
-		int len = (count+page_size-1) / page_size;
-		unsigned char *vec = new unsigned char[len];
-		//int rt = -- unused
-#ifdef LINUX
-		mincore((char*)addr, count, (unsigned char*)vec);
-#else
-		mincore((char*)addr, count, (char*)vec);
-#endif
-		munmap(addr, count);
-		bool in_memory = true;
-
-		for (int i=0; i< len; i++) {
-			if (vec[i] == 0) {
-				in_memory = false;
-				break;
+		bool checked = false;
+#if defined LINUX && defined RWF_NOWAIT
+		if (has_rwf_nowait) {
+			struct iovec iov;
+			iov.iov_base = buf;
+			iov.iov_len = count;
+			ret = preadv2(fd, &iov, 1, -1, RWF_NOWAIT);
+			if (ret >= 0) {
+				__sync_fetch_and_add(&read_resident_hits, 1);
+				return ret;
+			} else if (errno == EAGAIN) {
+				checked = true; // not resident
+			} else if (errno == EOPNOTSUPP || errno == ENOSYS) {
+				has_rwf_nowait = false;
+			} else if (errno != EINVAL) {
+				return ret; // read() would fail the same way
 			}
 		}
-
-		delete [] vec;
-
-		if (in_memory) {
+#endif
+		if (!checked && file_pages_resident(fd, count)) {
+			__sync_fetch_and_add(&read_resident_hits, 1);
 			return ((shim_read)(fd, buf, count));
 		}
+		__sync_fetch_and_add(&read_resident_misses, 1);
 	}
 
 	int mgr_awake = eminfo->wake_another_thread();
@@ -431,6 +575,7 @@ extern "C" int close(int fd)
                 return -1;
         }
         is_regular[fd] = false;
+        drop_residency_map(fd);
 	return ((*shim_close)(fd));
 }
 
@@ -0,0 +1,312 @@
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "OFluxLatency.h"
+#include "OFluxWrappers.h"
+#include "lockfree/OFluxMachineSpecific.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+namespace oflux {
+
+static long long
+monotonic_raw_ns()
+{
+	struct timespec ts;
+#ifdef CLOCK_MONOTONIC_RAW
+	clock_gettime(CLOCK_MONOTONIC_RAW,&ts);
+#else
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+#endif
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+bool CycleClock::_tsc = false;
+
+/**
+ * @brief a (ticks, ns) pair taken at load to calibrate ns_per_tick()
+ * against (plain data: set by cycle_clock_init(), not a constructor)
+ */
+static struct CycleClockOrigin {
+	unsigned long long ticks;
+	long long ns;
+} _origin;
+
+/**
+ * @return true if /proc/cpuinfo says the TSC ticks at a constant rate
+ * and does not stop in deep C-states (so it can time across cores)
+ */
+static bool
+tsc_invariant()
+{
+#if defined(x86_64_HOST_ARCH) || defined(i386_HOST_ARCH)
+	FILE * f = fopen("/proc/cpuinfo","r");
+	if(!f) {
+		return false;
+	}
+	char line[4096];
+	bool constant = false;
+	bool nonstop = false;
+	while(fgets(line,sizeof(line),f)) {
+		if(strncmp(line,"flags",5) == 0) {
+			constant = (strstr(line," constant_tsc") != NULL);
+			nonstop = (strstr(line," nonstop_tsc") != NULL);
+			break;
+		}
+	}
+	fclose(f);
+	return constant && nonstop;
+#else
+	return false;
+#endif
+}
+
+/**
+ * runs before the static initializers (of this library and those that
+ * load after it), so the clock source and origin never change under
+ * a caller of now()
+ */
+static void __attribute__((constructor(101)))
+cycle_clock_init()
+{
+	CycleClock::_tsc = tsc_invariant();
+	_origin.ticks = CycleClock::now();
+	_origin.ns = monotonic_raw_ns();
+}
+
+double
+CycleClock::ns_per_tick()
+{
+	if(!_tsc) {
+		return 1.0; // now() is in ns
+	}
+	static volatile double calibrated = 0.0;
+	if(calibrated == 0.0) {
+		long long ns;
+		unsigned long long ticks;
+		do { // at least 1ms apart for a decent estimate
+			ns = monotonic_raw_ns();
+			ticks = now();
+		} while(ns - _origin.ns < 1000000LL);
+		calibrated = (double)(ns - _origin.ns)
+			/ (double)(ticks - _origin.ticks);
+	}
+	return calibrated;
+}
+
+void
+Histogram::clear()
+{
+	memset(_counts,0,sizeof(_counts));
+	_count = 0;
+	_sum = 0;
+	_max = 0;
+}
+
+unsigned long long
+Histogram::lower(int i)
+{
+	if(i < Sub) {
+		return i;
+	}
+	int e = i / Sub + Sub_Bits - 1;
+	return (unsigned long long)(i % Sub + Sub) << (e - Sub_Bits);
+}
+
+unsigned long long
+Histogram::upper(int i)
+{
+	return (i + 1 < Buckets ? lower(i+1) - 1 : ~0ULL);
+}
+
+void
+Histogram::merge(const Histogram & h)
+{
+	for(int i = 0; i < Buckets; ++i) {
+		_counts[i] += h._counts[i];
+	}
+	_count += h._count;
+	_sum += h._sum;
+	if(h._max > _max) {
+		_max = h._max;
+	}
+}
+
+unsigned long long
+Histogram::percentile(double q) const
+{
+	unsigned long long total = 0;
+	for(int i = 0; i < Buckets; ++i) {
+		total += _counts[i]; // (_count may be ahead of these)
+	}
+	if(total == 0) {
+		return 0;
+	}
+	unsigned long long rank = (unsigned long long)ceil(q * total);
+	if(rank < 1) {
+		rank = 1;
+	}
+	unsigned long long seen = 0;
+	int i = 0;
+	for(; i < Buckets - 1; ++i) {
+		seen += _counts[i];
+		if(seen >= rank) {
+			break;
+		}
+	}
+	unsigned long long u = upper(i);
+	return (u > _max ? _max : u);
+}
+
+namespace latency {
+
+const char *
+metric_name(int m)
+{
+	static const char * names[] =
+		{ "exec"
+		, "queue_wait"
+		, "guard_wait"
+		, "?"
+		};
+	return names[(m >= 0 && m < M_num_metrics) ? m : M_num_metrics];
+}
+
+void
+NodeLatency::clear()
+{
+	for(int m = 0; m < M_num_metrics; ++m) {
+		h[m].clear();
+	}
+}
+
+void
+NodeLatency::merge(const NodeLatency & nl)
+{
+	for(int m = 0; m < M_num_metrics; ++m) {
+		h[m].merge(nl.h[m]);
+	}
+}
+
+double
+NodeLatency::percentile_ns(int m, double q) const
+{
+	return h[m].percentile(q) * CycleClock::ns_per_tick();
+}
+
+double
+NodeLatency::max_ns(int m) const
+{
+	return h[m].max() * CycleClock::ns_per_tick();
+}
+
+__thread Table * _table = NULL;
+
+/**
+ * @brief all the tables ever handed out (never freed), and those
+ * whose threads have exited (reused by new threads)
+ */
+static struct Tables {
+	Tables()
+		: all(NULL)
+		, free(NULL)
+	{ oflux_mutex_init(&lock); }
+	oflux_mutex_t lock;
+	Table * all;
+	Table * free;
+} _tables;
+
+static void
+release_table(void * vt)
+{
+	Table * t = static_cast<Table *>(vt);
+	AutoLock al(&_tables.lock);
+	t->next_free = _tables.free;
+	_tables.free = t;
+}
+
+static ThreadLocalDataKey<Table> _table_key(release_table);
+
+static Table *
+acquire_table()
+{
+	AutoLock al(&_tables.lock);
+	Table * t = _tables.free;
+	if(t) {
+		_tables.free = t->next_free;
+	} else {
+		t = new Table();
+		memset(t,0,sizeof(Table));
+		t->next = _tables.all;
+		lockfree::write_barrier();
+		_tables.all = t;
+	}
+	return t;
+}
+
+void
+record_slow(int node_id, int m, unsigned long long ticks)
+{
+	if((unsigned)node_id >= Max_Nodes) {
+		return;
+	}
+	Table * t = _table;
+	if(!t) {
+		t = acquire_table();
+		_table = t;
+		_table_key.set(t); // handed back when this thread exits
+	}
+	NodeLatency * volatile * c = t->chunks[node_id >> Chunk_Scale];
+	if(!c) {
+		c = new NodeLatency * volatile [Chunk_Size];
+		for(int i = 0; i < Chunk_Size; ++i) {
+			c[i] = NULL;
+		}
+		lockfree::write_barrier();
+		t->chunks[node_id >> Chunk_Scale] = c;
+	}
+	NodeLatency * nl = c[node_id & (Chunk_Size-1)];
+	if(!nl) {
+		nl = new NodeLatency();
+		lockfree::write_barrier();
+		c[node_id & (Chunk_Size-1)] = nl;
+	}
+	nl->h[m].add(ticks);
+}
+
+void
+snapshot(int node_id, NodeLatency & merged)
+{
+	merged.clear();
+	if((unsigned)node_id >= Max_Nodes) {
+		return;
+	}
+	AutoLock al(&_tables.lock);
+	for(Table * t = _tables.all; t; t = t->next) {
+		NodeLatency * volatile * c = t->chunks[node_id >> Chunk_Scale];
+		lockfree::load_load_barrier();
+		NodeLatency * nl = (c ? c[node_id & (Chunk_Size-1)] : NULL);
+		lockfree::load_load_barrier();
+		if(nl) {
+			merged.merge(*nl);
+		}
+	}
+}
+
+} // namespace latency
+} // namespace oflux
@@ -0,0 +1,205 @@
+#ifndef OFLUX_LATENCY_H
+#define OFLUX_LATENCY_H
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file OFluxLatency.h
+ * @author Mark Pichora
+ * Per node latency histograms (always on, unlike the PROFILING
+ * TimerStats).  Each thread records into its own log-bucketed
+ * histograms (no atomics on the hot path) of the execution time, the
+ * queue wait (event birth to node start) and the guard wait of every
+ * node it runs.  snapshot() merges the threads' histograms of a node
+ * so percentiles (p99, p999) can be read off in production.
+ */
+
+#include <time.h>
+
+namespace oflux {
+
+/**
+ * @class CycleClock
+ * @brief cheap timestamps: the TSC on x86 when it is invariant
+ * (constant_tsc and nonstop_tsc), CLOCK_MONOTONIC_RAW otherwise
+ */
+class CycleClock {
+public:
+	static inline unsigned long long now()
+	{
+#if defined(x86_64_HOST_ARCH) || defined(i386_HOST_ARCH)
+		if(_tsc) {
+			unsigned int lo;
+			unsigned int hi;
+			__asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+			return ((unsigned long long)hi << 32) | lo;
+		}
+#endif
+		struct timespec ts;
+#ifdef CLOCK_MONOTONIC_RAW
+		clock_gettime(CLOCK_MONOTONIC_RAW,&ts);
+#else
+		clock_gettime(CLOCK_MONOTONIC,&ts);
+#endif
+		return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	}
+	/**
+	 * @brief nanoseconds per now() tick (calibrated on first call)
+	 */
+	static double ns_per_tick();
+	/**
+	 * @return true if now() reads the TSC (decided as the library
+	 * loads, before any static initializer can call now())
+	 */
+	static inline bool tsc() { return _tsc; }
+	static bool _tsc;
+};
+
+/**
+ * @class Histogram
+ * @brief log-bucketed (HDR style) histogram of tick counts
+ * Values below Sub are exact; above that each power of two is split
+ * into Sub buckets, so a bucket is within 1/Sub (12.5%) of its values.
+ * add() is not atomic: one thread writes, others may read (racily) to
+ * merge().
+ */
+class Histogram {
+public:
+	enum  { Sub_Bits = 3
+	      , Sub = (1 << Sub_Bits)
+	      , Max_Exp = 42 // larger values land in the last bucket
+	      , Buckets = (Max_Exp - Sub_Bits + 2) * Sub
+	      };
+
+	Histogram() { clear(); }
+	void clear();
+	static inline int index(unsigned long long v)
+	{
+		if(v < Sub) {
+			return (int)v;
+		}
+		int e = 63 - __builtin_clzll(v);
+		if(e > Max_Exp) {
+			return Buckets - 1;
+		}
+		return (e - Sub_Bits + 1) * Sub + (int)(v >> (e - Sub_Bits)) - Sub;
+	}
+	static unsigned long long lower(int i);
+	static unsigned long long upper(int i);
+	inline void add(unsigned long long v)
+	{
+		++_counts[index(v)];
+		++_count;
+		_sum += v;
+		if(v > _max) {
+			_max = v;
+		}
+	}
+	void merge(const Histogram & h);
+	/**
+	 * @param q the quantile wanted (0.99 for p99)
+	 * @return upper bound of the bucket holding it (0 when empty)
+	 */
+	unsigned long long percentile(double q) const;
+	inline unsigned long long count() const { return _count; }
+	inline unsigned long long max() const { return _max; }
+	inline unsigned long long sum() const { return _sum; }
+	inline double mean() const
+	{ return _count ? (double)_sum / _count : 0.0; }
+private:
+	unsigned long long _counts[Buckets];
+	unsigned long long _count;
+	unsigned long long _sum;
+	unsigned long long _max;
+};
+
+namespace latency {
+
+enum Metric
+	{ M_exec         // node function run time
+	, M_queue_wait   // event birth to its node starting
+	, M_guard_wait   // first try at its guards to having all of them
+	, M_num_metrics
+	};
+
+const char * metric_name(int m);
+
+/**
+ * @brief the histograms kept for one node (in CycleClock ticks)
+ */
+struct NodeLatency {
+	Histogram h[M_num_metrics];
+
+	void clear();
+	void merge(const NodeLatency & nl);
+	/**
+	 * @return percentile q of metric m in nanoseconds
+	 */
+	double percentile_ns(int m, double q) const;
+	double max_ns(int m) const;
+};
+
+enum  { Chunk_Scale = 8
+      , Chunk_Size = (1 << Chunk_Scale)
+      , Chunks = 256
+      , Max_Nodes = Chunks * Chunk_Size // flow::Node::id() bound
+      };
+
+/**
+ * @brief a thread's histograms indexed by node id (chunks allocated as
+ * the thread first runs a node)
+ */
+struct Table {
+	NodeLatency * volatile * volatile chunks[Chunks];
+	Table * next;      // all tables
+	Table * next_free; // tables of exited threads
+};
+
+extern __thread Table * _table;
+
+void record_slow(int node_id, int m, unsigned long long ticks);
+
+/**
+ * @brief add ticks to metric m of node node_id for this thread
+ */
+inline void
+record(int node_id, int m, unsigned long long ticks)
+{
+	Table * t = _table;
+	NodeLatency * volatile * c;
+	NodeLatency * nl;
+	if(t
+			&& (unsigned)node_id < Max_Nodes
+			&& (c = t->chunks[node_id >> Chunk_Scale]) != NULL
+			&& (nl = c[node_id & (Chunk_Size-1)]) != NULL) {
+		nl->h[m].add(ticks);
+	} else {
+		record_slow(node_id,m,ticks);
+	}
+}
+
+/**
+ * @brief add up the histograms of node node_id over all threads
+ * (those of exited threads are kept)
+ */
+void snapshot(int node_id, NodeLatency & merged);
+
+} // namespace latency
+} // namespace oflux
+
+#endif // OFLUX_LATENCY_H
@@ -108,3 +108,98 @@ void PUBLIC_AHA_EXCEPTION_BEGIN_THROW(int A)
 } // namespace oflux
 
 #endif // HAS_DTRACE
+
+#if !defined(HAS_DTRACE) && defined(HAS_SDT)
+// Linux USDT probes: sys/sdt.h notes name each probe's semaphore, the
+// tracer finds it in the .probes section and counts itself in
+# define _SDT_HAS_SEMAPHORES 1
+# include <sys/sdt.h>
+
+#define OFLUX_SDT_SEMAPHORE(PROBE) \
+	volatile unsigned short oflux_##PROBE##_semaphore \
+		__attribute__((section(".probes"))) = 0
+
+extern "C" {
+OFLUX_SDT_SEMAPHORE(guard__acquire);
+OFLUX_SDT_SEMAPHORE(guard__wait);
+OFLUX_SDT_SEMAPHORE(guard__release);
+OFLUX_SDT_SEMAPHORE(fifo__push);
+OFLUX_SDT_SEMAPHORE(fifo__pop);
+OFLUX_SDT_SEMAPHORE(node__start);
+OFLUX_SDT_SEMAPHORE(node__done);
+OFLUX_SDT_SEMAPHORE(node__haveallguards);
+OFLUX_SDT_SEMAPHORE(node__acquireguards);
+OFLUX_SDT_SEMAPHORE(event__born);
+OFLUX_SDT_SEMAPHORE(event__death);
+OFLUX_SDT_SEMAPHORE(aha__exception__begin__throw);
+} // extern "C"
+
+namespace oflux {
+
+void sdt_guard_acquire(const char *A,const char *B,int C)
+{
+	STAP_PROBE3(oflux,guard__acquire,A,B,C);
+}
+
+void sdt_guard_wait(const char *A,const char *B,int C)
+{
+	STAP_PROBE3(oflux,guard__wait,A,B,C);
+}
+
+void sdt_guard_release(const char *A,const char *B,int C)
+{
+	STAP_PROBE3(oflux,guard__release,A,B,C);
+}
+
+
+void sdt_fifo_push(const void *A,const char *B)
+{
+	STAP_PROBE2(oflux,fifo__push,A,B);
+}
+
+void sdt_fifo_pop(const void *A,const char *B)
+{
+	STAP_PROBE2(oflux,fifo__pop,A,B);
+}
+
+
+void sdt_node_start(const void *A,const char * B,int C,int D)
+{
+	STAP_PROBE4(oflux,node__start,A,B,C,D);
+}
+
+void sdt_node_done(const void *A,const char *B)
+{
+	STAP_PROBE2(oflux,node__done,A,B);
+}
+
+void sdt_node_haveallguards(const void *A, const char *B)
+{
+	STAP_PROBE2(oflux,node__haveallguards,A,B);
+}
+
+void sdt_node_acquireguards(const void *A, const char *B)
+{
+	STAP_PROBE2(oflux,node__acquireguards,A,B);
+}
+
+
+void sdt_event_born(const void *A,const char * B)
+{
+	STAP_PROBE2(oflux,event__born,A,B);
+}
+
+void sdt_event_death(const void *A,const char * B)
+{
+	STAP_PROBE2(oflux,event__death,A,B);
+}
+
+
+void sdt_aha_exception_begin_throw(int A)
+{
+	STAP_PROBE1(oflux,aha__exception__begin__throw,A);
+}
+
+} // namespace oflux
+
+#endif // HAS_SDT
@@ -20,6 +20,25 @@
 
 // this header is safe to consume everywhere (now)
 
+#if !defined(HAS_DTRACE) && defined(HAS_SDT)
+// Linux USDT: each probe of ofluxprobe.d has a semaphore which a tracer
+// (bpftrace, stap, perf) raises while it is attached.  The probe
+// arguments (node and guard names) are only worked out when it is up.
+extern "C" {
+extern volatile unsigned short oflux_guard__acquire_semaphore;
+extern volatile unsigned short oflux_guard__wait_semaphore;
+extern volatile unsigned short oflux_guard__release_semaphore;
+extern volatile unsigned short oflux_fifo__push_semaphore;
+extern volatile unsigned short oflux_fifo__pop_semaphore;
+extern volatile unsigned short oflux_node__start_semaphore;
+extern volatile unsigned short oflux_node__done_semaphore;
+extern volatile unsigned short oflux_node__haveallguards_semaphore;
+extern volatile unsigned short oflux_node__acquireguards_semaphore;
+extern volatile unsigned short oflux_event__born_semaphore;
+extern volatile unsigned short oflux_event__death_semaphore;
+extern volatile unsigned short oflux_aha__exception__begin__throw_semaphore;
+} // extern "C"
+#endif // HAS_SDT
 
 namespace oflux {
 
@@ -42,7 +61,59 @@ void PUBLIC_EVENT_DEATH(const void *,const char * X);
 
 void PUBLIC_AHA_EXCEPTION_BEGIN_THROW(int);
 
-#else // ! HAS_DTRACE
+#elif defined(HAS_SDT)
+
+// the probes themselves are in OFluxLibDTrace.cpp (liboflux owns them)
+void sdt_guard_acquire(const char *,const char *,int);
+void sdt_guard_wait(const char *,const char *,int);
+void sdt_guard_release(const char *,const char *,int);
+
+void sdt_fifo_push(const void *,const char *);
+void sdt_fifo_pop(const void *,const char *);
+
+void sdt_node_start(const void *,const char * X,int Y,int Z);
+void sdt_node_done(const void *,const char * X);
+void sdt_node_haveallguards(const void *, const char *);
+void sdt_node_acquireguards(const void *, const char *);
+
+void sdt_event_born(const void *,const char * X);
+void sdt_event_death(const void *,const char * X);
+
+void sdt_aha_exception_begin_throw(int);
+
+# define OFLUX_SDT(PROBE,FUNC,ARGS) \
+	do { if(oflux_##PROBE##_semaphore) { ::oflux::FUNC ARGS; } } while(0)
+
+# define PUBLIC_GUARD_ACQUIRE(X,Y,Z) \
+	OFLUX_SDT(guard__acquire,sdt_guard_acquire,(X,Y,Z))
+# define PUBLIC_GUARD_WAIT(X,Y,Z) \
+	OFLUX_SDT(guard__wait,sdt_guard_wait,(X,Y,Z))
+# define PUBLIC_GUARD_RELEASE(X,Y,Z) \
+	OFLUX_SDT(guard__release,sdt_guard_release,(X,Y,Z))
+
+# define PUBLIC_FIFO_PUSH(E,X) \
+	OFLUX_SDT(fifo__push,sdt_fifo_push,(E,X))
+# define PUBLIC_FIFO_POP(E,X) \
+	OFLUX_SDT(fifo__pop,sdt_fifo_pop,(E,X))
+
+# define PUBLIC_NODE_START(E,X,Y,Z) \
+	OFLUX_SDT(node__start,sdt_node_start,(E,X,Y,Z))
+# define PUBLIC_NODE_DONE(E,X) \
+	OFLUX_SDT(node__done,sdt_node_done,(E,X))
+# define PUBLIC_NODE_HAVEALLGUARDS(E,X) \
+	OFLUX_SDT(node__haveallguards,sdt_node_haveallguards,(E,X))
+# define PUBLIC_NODE_ACQUIREGUARDS(E,X) \
+	OFLUX_SDT(node__acquireguards,sdt_node_acquireguards,(E,X))
+
+# define PUBLIC_EVENT_BORN(E,X) \
+	OFLUX_SDT(event__born,sdt_event_born,(E,X))
+# define PUBLIC_EVENT_DEATH(E,X) \
+	OFLUX_SDT(event__death,sdt_event_death,(E,X))
+
+# define PUBLIC_AHA_EXCEPTION_BEGIN_THROW(A) \
+	OFLUX_SDT(aha__exception__begin__throw,sdt_aha_exception_begin_throw,(A))
+
+#else // ! HAS_DTRACE && ! HAS_SDT
 
 # define PUBLIC_GUARD_ACQUIRE(X,Y,Z)
 # define PUBLIC_GUARD_WAIT(X,Y,Z)
@@ -61,7 +132,7 @@ void PUBLIC_AHA_EXCEPTION_BEGIN_THROW(int);
 
 # define PUBLIC_AHA_EXCEPTION_BEGIN_THROW(A)
 
-#endif // HAS_DTRACE
+#endif // HAS_DTRACE / HAS_SDT
 
 
 } // namespace oflux
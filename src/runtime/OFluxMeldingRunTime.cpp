@@ -45,7 +45,7 @@ int RunTimeThread::execute_detached(
 #ifdef PROFILING
         TimerPause oflux_tp(_timer_list);
 #endif
-        std::vector<flow::Case *> fsuccessors;
+        std::vector<const flow::SuccessorRecord *> fsuccessors;
         int return_code;
         {
                 UnlockRunTime urt(_rt);
@@ -60,7 +60,7 @@ int RunTimeThread::execute_detached(
                         }
                         fsuccessors.clear();
                         ev->flow_node()->get_successors(fsuccessors, ev_output, return_code);
-                        flow::Case * fsucc_first_case = (fsuccessors.size() == 1 ? fsuccessors[0] : NULL);
+                        const flow::SuccessorRecord * fsucc_first_case = (fsuccessors.size() == 1 ? fsuccessors[0] : NULL);
                         flow::Node * fsucc_first = (fsucc_first_case ? fsucc_first_case->targetNode() : NULL);
                         if(fsucc_first != NULL 
                                         && fsucc_first->guards().size() == 0
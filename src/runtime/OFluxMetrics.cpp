@@ -0,0 +1,486 @@
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "OFluxMetrics.h"
+#include "OFluxRunTimeAbstract.h"
+#include "OFluxLogging.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace oflux {
+namespace metrics {
+
+static const char * _socket_path = NULL;
+
+void
+socket_path(const char * path)
+{
+	_socket_path = path;
+}
+
+const char *
+socket_path()
+{
+	return _socket_path;
+}
+
+const char *
+type_name(Type t)
+{
+	switch(t) {
+	case T_counter: return "counter";
+	case T_gauge:   return "gauge";
+	case T_summary: return "summary";
+	}
+	return "untyped";
+}
+
+Labels &
+Labels::add(const char * name, const char * value)
+{
+	_pairs.push_back(std::make_pair(std::string(name),std::string(value)));
+	return *this;
+}
+
+Labels &
+Labels::add(const char * name, long long value)
+{
+	char buff[32];
+	snprintf(buff,sizeof(buff),"%lld",value);
+	return add(name,buff);
+}
+
+Snapshot::Snapshot()
+	: _taken_ms(0)
+{
+	struct timeval tv;
+	gettimeofday(&tv,NULL);
+	_taken_ms = tv.tv_sec * 1000LL + tv.tv_usec / 1000;
+}
+
+Snapshot::~Snapshot()
+{
+	for(size_t i = 0; i < _families.size(); ++i) {
+		delete _families[i];
+	}
+}
+
+Family &
+Snapshot::family(const char * name, Type type, const char * help)
+{
+	std::map<std::string, size_t>::iterator itr = _index.find(name);
+	if(itr != _index.end()) {
+		return *_families[(*itr).second];
+	}
+	_index[name] = _families.size();
+	_families.push_back(new Family(name,type,help));
+	return *_families.back();
+}
+
+static void
+append_value(std::string & out, double v)
+{
+	char buff[64];
+	snprintf(buff,sizeof(buff),"%.15g",v);
+	out += buff;
+}
+
+/**
+ * @brief append s quoted (escapes are the same for label values and
+ * JSON strings as long as control characters are not allowed through)
+ */
+static void
+append_quoted(std::string & out, const std::string & s)
+{
+	out += '"';
+	for(size_t i = 0; i < s.size(); ++i) {
+		char c = s[i];
+		if(c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		} else if(c == '\n') {
+			out += "\\n";
+		} else if((unsigned char)c < 0x20) {
+			out += ' ';
+		} else {
+			out += c;
+		}
+	}
+	out += '"';
+}
+
+void
+Snapshot::prometheus(std::string & out) const
+{
+	for(size_t i = 0; i < _families.size(); ++i) {
+		const Family & f = *_families[i];
+		out += "# HELP " + f.name() + " " + f.help() + "\n";
+		out += "# TYPE " + f.name() + " " + type_name(f.type()) + "\n";
+		const std::vector<Sample> & ss = f.samples();
+		for(size_t j = 0; j < ss.size(); ++j) {
+			const Labels::Pairs & ls = ss[j].labels.pairs();
+			out += f.name();
+			out += ss[j].suffix;
+			for(size_t k = 0; k < ls.size(); ++k) {
+				out += (k == 0 ? "{" : ",");
+				out += ls[k].first + "=";
+				append_quoted(out,ls[k].second);
+			}
+			out += (ls.size() ? "} " : " ");
+			append_value(out,ss[j].value);
+			out += "\n";
+		}
+	}
+}
+
+void
+Snapshot::json(std::string & out) const
+{
+	char buff[64];
+	snprintf(buff,sizeof(buff),"{\"timestamp_ms\":%lld,\"metrics\":[",_taken_ms);
+	out += buff;
+	for(size_t i = 0; i < _families.size(); ++i) {
+		const Family & f = *_families[i];
+		out += (i ? ",\n{\"name\":" : "\n{\"name\":");
+		append_quoted(out,f.name());
+		out += ",\"type\":\"";
+		out += type_name(f.type());
+		out += "\",\"help\":";
+		append_quoted(out,f.help());
+		out += ",\"samples\":[";
+		const std::vector<Sample> & ss = f.samples();
+		for(size_t j = 0; j < ss.size(); ++j) {
+			const Labels::Pairs & ls = ss[j].labels.pairs();
+			out += (j ? ",{" : "{");
+			if(*ss[j].suffix) {
+				out += "\"suffix\":";
+				append_quoted(out,ss[j].suffix);
+				out += ",";
+			}
+			out += "\"labels\":{";
+			for(size_t k = 0; k < ls.size(); ++k) {
+				if(k) {
+					out += ",";
+				}
+				append_quoted(out,ls[k].first);
+				out += ":";
+				append_quoted(out,ls[k].second);
+			}
+			out += "},\"value\":";
+			append_value(out,ss[j].value);
+			out += "}";
+		}
+		out += "]}";
+	}
+	out += "\n]}\n";
+}
+
+Server::Server()
+	: _rt(NULL)
+	, _listen_fd(-1)
+	, _thread_started(false)
+	, _tid(0)
+	, _served(0)
+{
+	_wake_fds[0] = -1;
+	_wake_fds[1] = -1;
+}
+
+Server::~Server()
+{
+	stop();
+}
+
+static void *
+Server_start_thread(void * pv)
+{
+	Server * s = static_cast<Server *>(pv);
+	AutoThreadExit ate(s->exit());
+	s->run();
+	return NULL;
+}
+
+/**
+ * @return true if nothing is left at path: a socket nobody answers on
+ * (left over from an earlier run) is removed
+ */
+bool
+Server::clear_path(const char * path)
+{
+	struct stat st;
+	if(lstat(path,&st) != 0) {
+		return errno == ENOENT;
+	}
+	if(!S_ISSOCK(st.st_mode)) {
+		oflux_log_error("metrics::Server::start() %s exists and "
+			"is not a socket\n"
+			, path);
+		return false;
+	}
+	struct sockaddr_un addr;
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path,path);
+	int fd = socket(AF_UNIX,SOCK_STREAM,0);
+	bool live = (fd >= 0
+		&& connect(fd,(struct sockaddr *)&addr,sizeof(addr)) == 0);
+	if(fd >= 0) {
+		close(fd);
+	}
+	if(live) {
+		oflux_log_error("metrics::Server::start() %s is in use "
+			"by another server\n"
+			, path);
+		return false;
+	}
+	return unlink(path) == 0 || errno == ENOENT;
+}
+
+bool
+Server::start(RunTimeAbstract * rt, size_t stack_size)
+{
+	const char * path = socket_path();
+	if(!path || _thread_started) {
+		return false;
+	}
+	struct sockaddr_un addr;
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(strlen(path) >= sizeof(addr.sun_path)) {
+		oflux_log_error("metrics::Server::start() socket path %s "
+			"is too long\n"
+			, path);
+		return false;
+	}
+	strcpy(addr.sun_path,path);
+	if(!clear_path(path)) {
+		return false;
+	}
+	_rt = rt;
+	_path = path;
+	_listen_fd = socket(AF_UNIX,SOCK_STREAM,0);
+	if(_listen_fd < 0
+			|| bind(_listen_fd,(struct sockaddr *)&addr,sizeof(addr)) != 0
+			|| chmod(path,Socket_Mode) != 0 // before anyone connects
+			|| listen(_listen_fd,8) != 0
+			|| pipe(_wake_fds) != 0) {
+		oflux_log_error("metrics::Server::start() could not listen "
+			"on %s (errno %d)\n"
+			, path
+			, errno);
+		stop();
+		return false;
+	}
+	_exit.started();
+	if(oflux_create_thread(
+			  stack_size
+			, Server_start_thread
+			, this
+			, &_tid) != 0) {
+		_exit.done();
+		oflux_log_error("metrics::Server::start() failed to create "
+			"the metrics thread\n");
+		stop();
+		return false;
+	}
+	_thread_started = true;
+	oflux_log_info("metrics::Server::start() serving on %s\n", path);
+	return true;
+}
+
+void
+Server::stop()
+{
+	if(_thread_started) {
+		char c = 0;
+		while(write(_wake_fds[1],&c,1) < 0 && errno == EINTR) {}
+		// the thread is detached: wait for it to say it is done
+		if(!_exit.wait(Stop_Wait_Ms)) {
+			// leave its sockets be rather than close them under it
+			oflux_log_error("metrics::Server::stop() metrics thread "
+				"did not finish\n");
+			return;
+		}
+		_thread_started = false;
+	}
+	if(_listen_fd >= 0) {
+		close(_listen_fd);
+		_listen_fd = -1;
+		unlink(_path.c_str());
+	}
+	for(int i = 0; i < 2; ++i) {
+		if(_wake_fds[i] >= 0) {
+			close(_wake_fds[i]);
+			_wake_fds[i] = -1;
+		}
+	}
+	_rt = NULL;
+}
+
+void
+Server::run()
+{
+	while(true) {
+		struct pollfd pfds[2];
+		pfds[0].fd = _listen_fd;
+		pfds[0].events = POLLIN;
+		pfds[0].revents = 0;
+		pfds[1].fd = _wake_fds[0];
+		pfds[1].events = POLLIN;
+		pfds[1].revents = 0;
+		if(poll(pfds,2,-1) < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			oflux_log_error("metrics::Server::run() poll failed "
+				"(errno %d)\n"
+				, errno);
+			break;
+		}
+		if(pfds[1].revents) {
+			break; // stop()
+		}
+		if(pfds[0].revents & POLLIN) {
+			int fd = accept(_listen_fd,NULL,NULL);
+			if(fd >= 0) {
+				answer(fd);
+				close(fd);
+			}
+		}
+	}
+}
+
+enum { Request_Max = 4096, Request_Timeout_ms = 1000 };
+
+static bool
+write_all(int fd, const char * buf, size_t len)
+{
+#ifdef MSG_NOSIGNAL
+	const int flags = MSG_NOSIGNAL; // the client may be gone
+#else
+	const int flags = 0;
+#endif
+	while(len > 0) {
+		ssize_t n = send(fd,buf,len,flags);
+		if(n < 0 && errno == EINTR) {
+			continue;
+		} else if(n <= 0) {
+			return false;
+		}
+		buf += n;
+		len -= n;
+	}
+	return true;
+}
+
+void
+Server::answer(int fd)
+{
+	// read the request line (a client that says nothing gets nothing)
+	char req[Request_Max];
+	size_t len = 0;
+	char * eol = NULL;
+	while(!eol && len < sizeof(req)-1) {
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if(poll(&pfd,1,Request_Timeout_ms) <= 0) {
+			return;
+		}
+		ssize_t n = read(fd,req+len,sizeof(req)-1-len);
+		if(n < 0 && errno == EINTR) {
+			continue;
+		} else if(n <= 0) {
+			break;
+		}
+		len += n;
+		req[len] = '\0';
+		eol = strchr(req,'\n');
+	}
+	if(len == 0) {
+		return; // connected and hung up (a liveness probe)
+	}
+	req[len] = '\0';
+	if(eol) {
+		*eol = '\0';
+	}
+	char * path = req;
+	bool http = (strncmp(req,"GET ",4) == 0);
+	if(http) {
+		path += 4;
+		char * sp = strchr(path,' ');
+		if(sp) {
+			*sp = '\0';
+		}
+	}
+	size_t plen = strcspn(path,"\r ");
+	path[plen] = '\0';
+	if(*path == '/') {
+		++path;
+	}
+	bool json = false;
+	if(strcmp(path,"metrics.json") == 0 || strcmp(path,"json") == 0) {
+		json = true;
+	} else if(*path && strcmp(path,"metrics") != 0) {
+		const char * not_found = (http
+			? "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n"
+			  "Connection: close\r\n\r\n"
+			: "unknown request (try metrics or json)\n");
+		write_all(fd,not_found,strlen(not_found));
+		return;
+	}
+	std::string body;
+	{
+		Snapshot s;
+		_rt->metrics_snapshot(s);
+		s.counter("oflux_metrics_requests_total"
+				, "requests answered by the metrics server")
+			.add(Labels(),++_served);
+		if(json) {
+			s.json(body);
+		} else {
+			s.prometheus(body);
+		}
+	}
+	if(http) {
+		char hdr[256];
+		snprintf(hdr,sizeof(hdr)
+			, "HTTP/1.0 200 OK\r\n"
+			  "Content-Type: %s\r\n"
+			  "Content-Length: %lu\r\n"
+			  "Connection: close\r\n\r\n"
+			, (json
+				? "application/json"
+				: "text/plain; version=0.0.4")
+			, (unsigned long)body.size());
+		if(!write_all(fd,hdr,strlen(hdr))) {
+			return;
+		}
+	}
+	write_all(fd,body.data(),body.size());
+}
+
+} // namespace metrics
+} // namespace oflux
@@ -0,0 +1,185 @@
+#ifndef OFLUX_METRICS_H
+#define OFLUX_METRICS_H
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file OFluxMetrics.h
+ * @author Mark Pichora
+ * Structured runtime metrics.  A Snapshot gathers, in one pass, the
+ * counters and gauges of a runtime (RunTimeAbstract::metrics_snapshot())
+ * and of its flow (flow::Flow::metrics_snapshot(): nodes, latencies,
+ * guards, admission) and renders them as Prometheus text or JSON.
+ * With OFLUX_CONFIG=metrics=path a Server thread answers on the Unix
+ * socket path:
+ *   curl --unix-socket path http://localhost/metrics       (Prometheus)
+ *   curl --unix-socket path http://localhost/metrics.json  (JSON)
+ * (or a bare "metrics" / "json" line).  Samples are read by the server
+ * thread when asked for, so the runtime threads do no extra work.
+ */
+
+#include "OFluxThreads.h"
+#include "OFluxWrappers.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace oflux {
+
+class RunTimeAbstract;
+
+namespace metrics {
+
+enum Type { T_counter, T_gauge, T_summary };
+
+const char * type_name(Type t);
+
+/**
+ * @class Labels
+ * @brief the (name,value) pairs that tell samples of a family apart
+ */
+class Labels {
+public:
+	typedef std::vector<std::pair<std::string,std::string> > Pairs;
+
+	Labels() {}
+	Labels & add(const char * name, const char * value);
+	Labels & add(const char * name, long long value);
+	inline const Pairs & pairs() const { return _pairs; }
+private:
+	Pairs _pairs;
+};
+
+struct Sample {
+	Labels       labels;
+	const char * suffix; // "_sum", "_count" for summaries ("" otherwise)
+	double       value;
+};
+
+/**
+ * @class Family
+ * @brief the samples of one metric name
+ */
+class Family {
+public:
+	Family(const char * name, Type type, const char * help)
+		: _name(name)
+		, _type(type)
+		, _help(help)
+	{}
+	inline void add(const Labels & l, double v, const char * suffix = "")
+	{
+		_samples.push_back(Sample());
+		Sample & s = _samples.back();
+		s.labels = l;
+		s.suffix = suffix;
+		s.value = v;
+	}
+	inline const std::string & name() const { return _name; }
+	inline Type type() const { return _type; }
+	inline const char * help() const { return _help; }
+	inline const std::vector<Sample> & samples() const { return _samples; }
+private:
+	std::string         _name;
+	Type                _type;
+	const char *        _help;
+	std::vector<Sample> _samples;
+};
+
+/**
+ * @class Snapshot
+ * @brief a set of families (in the order they were first added)
+ */
+class Snapshot {
+public:
+	Snapshot();
+	~Snapshot();
+	/**
+	 * @brief the family called name (created on first use)
+	 */
+	Family & family(const char * name, Type type, const char * help);
+	inline Family & counter(const char * name, const char * help)
+	{ return family(name,T_counter,help); }
+	inline Family & gauge(const char * name, const char * help)
+	{ return family(name,T_gauge,help); }
+	inline size_t size() const { return _families.size(); }
+	/**
+	 * @brief append the Prometheus text exposition format to out
+	 */
+	void prometheus(std::string & out) const;
+	/**
+	 * @brief append {"timestamp_ms":..,"metrics":[{"name":..,"type":..,
+	 *   "help":..,"samples":[{"labels":{..},"value":..},..]},..]} to out
+	 */
+	void json(std::string & out) const;
+private:
+	Snapshot(const Snapshot &); // not copied
+	Snapshot & operator=(const Snapshot &);
+private:
+	long long                       _taken_ms; // wall clock
+	std::vector<Family *>           _families;
+	std::map<std::string, size_t>   _index;
+};
+
+/**
+ * @brief where the Server listens (NULL for not at all)
+ */
+void socket_path(const char * path);
+const char * socket_path();
+
+/**
+ * @class Server
+ * @brief serves metrics snapshots of a runtime on a Unix socket
+ * The socket is made Socket_Mode (owner and group may connect).  A
+ * stale socket left at the path is replaced, anything else there is
+ * left alone.
+ */
+class Server {
+public:
+	enum    { Socket_Mode = 0660
+		, Stop_Wait_Ms = 2000 // for the server thread to finish
+		};
+
+	Server();
+	~Server();
+	/**
+	 * @brief listen on socket_path() (if any) for rt
+	 * @return false if it is not serving
+	 */
+	bool start(RunTimeAbstract * rt, size_t stack_size);
+	void stop();
+	void run(); // (the server thread)
+	inline ThreadExit & exit() { return _exit; }
+private:
+	bool clear_path(const char * path);
+	void answer(int fd);
+private:
+	RunTimeAbstract * _rt;
+	std::string       _path;
+	int               _listen_fd;
+	int               _wake_fds[2]; // written by stop()
+	bool              _thread_started;
+	ThreadExit        _exit;
+	oflux_thread_t    _tid;
+	unsigned long     _served;
+};
+
+} // namespace metrics
+} // namespace oflux
+
+#endif // OFLUX_METRICS_H
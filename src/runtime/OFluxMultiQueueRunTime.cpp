@@ -0,0 +1,369 @@
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "OFluxMultiQueueRunTime.h"
+#include "atomic/OFluxAtomicHolder.h"
+#include "flow/OFluxFlow.h"
+#include "flow/OFluxFlowNode.h"
+#include "event/OFluxEventBase.h"
+#include "event/OFluxEventOperations.h"
+#include "OFluxLogging.h"
+#include "OFluxProfiling.h"
+#include <unistd.h>
+
+namespace oflux {
+namespace runtime {
+namespace multiqueue {
+
+int
+RunTime::worker_target(const RunTimeConfiguration & rtc)
+{
+	int res = rtc.initial_thread_pool_size;
+	if(res <= 0) {
+		res = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if(rtc.max_thread_pool_size > 0 && res > rtc.max_thread_pool_size) {
+		res = rtc.max_thread_pool_size;
+	}
+	return res > 0 ? res : 1;
+}
+
+RunTime::RunTime(const RunTimeConfiguration & rtc)
+	: classic::RunTime(rtc)
+	, _num_workers(worker_target(rtc))
+	, _max_threads(rtc.max_thread_pool_size > 0
+		? rtc.max_thread_pool_size
+		: 4 * _num_workers)
+	, _next_home(0)
+	, _idle(0)
+	, _mq(_num_workers)
+{
+	oflux_log_info("oflux::runtime::multiqueue::RunTime initializing "
+		"(%d workers, %d queue shards)\n"
+		, _num_workers
+		, _mq.shards());
+}
+
+RunTime::~RunTime()
+{
+	_mq.clear();
+}
+
+classic::RunTimeThread *
+RunTime::new_RunTimeThread(oflux_thread_t tid)
+{
+	return new RunTimeThread(this,_next_home++ % _mq.shards(),tid);
+}
+
+int
+RunTime::wake_another_thread()
+{
+	if(_waiting_in_pool.count() > 0) {
+		_waiting_in_pool.signal();
+	} else {
+		add_worker();
+	}
+	return 0;
+}
+
+bool
+RunTime::add_worker()
+{
+	if(!_running || _thread_count >= _max_threads || !canThreadMore()) {
+		return false;
+	}
+	classic::RunTimeThread * rtt = new_RunTimeThread();
+	++_thread_count;
+	_thread_list.insert_front(rtt);
+	if(rtt->create()) {
+		oflux_log_error("multiqueue::RunTime::add_worker() "
+			"thread creation failed\n");
+		remove(rtt);
+		delete rtt;
+		return false;
+	}
+	if(_thread_count > _num_workers) {
+		++_stats.handoffs;
+	}
+	return true;
+}
+
+void
+RunTime::spawn_workers()
+{
+	while(_thread_count < _num_workers && add_worker()) {
+	}
+}
+
+void
+RunTime::drain_classic_queue(int home)
+{
+	std::vector<EventBasePtr> evs;
+	Queue::Element e;
+	while(_queue.pop(e)) {
+		evs.push_back(e);
+	}
+	_mq.push_list(home,evs);
+}
+
+void
+RunTime::push_list(int home, const std::vector<EventBasePtr> & evs)
+{
+	if(evs.empty()) {
+		return;
+	}
+	_mq.push_list(home,evs);
+	__sync_synchronize(); // pairs with the _idle increment
+	if(_idle > 0) {
+		AutoLock al(&_manager_lock);
+		_waiting_in_pool.signal();
+	}
+}
+
+void
+RunTime::hand_off()
+{
+	if(_idle == 0 && !_mq.empty()) {
+		AutoLock al(&_manager_lock);
+		add_worker();
+	}
+}
+
+bool
+RunTime::currently_detached()
+{
+	classic::RunTimeThread * rtt = thread_data_key.get();
+	if(rtt && rtt->thisEvent()) {
+		hand_off(); // node code is about to make a shimmed call
+	}
+	return true;
+}
+
+void
+RunTime::submitEvents(const std::vector<EventBasePtr> & evs)
+{
+	// node code never holds the manager lock here
+	classic::RunTimeThread * rtt = thread_data_key.get();
+	push_list(rtt
+		? static_cast<RunTimeThread *>(rtt)->home()
+		: 0
+		, evs);
+}
+
+void
+RunTime::log_snapshot()
+{
+	classic::RunTime::log_snapshot();
+	oflux_log_info("Multi-queue: %d shards %d events queued "
+		"%d workers (%d idle) %lu hand offs (%lu retired)\n"
+		, _mq.shards()
+		, _mq.size()
+		, _num_workers
+		, _idle
+		, _stats.handoffs
+		, _stats.retired);
+	_mq.log_snapshot();
+}
+
+void
+RunTime::queue_metrics_snapshot(metrics::Snapshot & s)
+{
+	classic::RunTime::queue_metrics_snapshot(s); // sources land there
+	metrics::Family & f = s.gauge("oflux_runtime_multiqueue_depth"
+		, "events in the multi-queue shards by lane");
+	for(int lane = 0; lane < QueueLanes::Lanes; ++lane) {
+		metrics::Labels l;
+		l.add("lane",(long long)lane);
+		f.add(l,_mq.lane_size(lane));
+	}
+	metrics::Labels l;
+	s.gauge("oflux_runtime_multiqueue_shards"
+		, "multi-queue shards").add(l,_mq.shards());
+	s.gauge("oflux_runtime_workers_idle"
+		, "workers waiting for events").add(l,_idle);
+	s.counter("oflux_runtime_handoffs_total"
+		, "workers started by blocking calls").add(l,_stats.handoffs);
+	s.counter("oflux_runtime_retired_total"
+		, "workers started by blocking calls that retired")
+		.add(l,_stats.retired);
+}
+
+bool
+RunTimeThread::wait_for_work()
+{
+	AutoLock al(&(_mqrt->_manager_lock));
+	__sync_fetch_and_add(&(_mqrt->_idle),1);
+	__sync_synchronize(); // pairs with push_list()
+	while(_system_running
+			&& !_request_death
+			&& !_mqrt->_load_flow_next
+			&& _mqrt->_mq.empty()) {
+		if(!_may_retire || _mqrt->_thread_count <= _mqrt->_num_workers) {
+			wait_in_pool();
+		} else if(fast_time(NULL) - _last_work >= Retire_Idle_S) {
+			_retired = true; // added for a blocked worker, now idle
+			break;
+		} else {
+			wait_in_pool_to_retire(); // then look again
+		}
+	}
+	__sync_fetch_and_sub(&(_mqrt->_idle),1);
+	return _system_running && !_request_death && !_retired;
+}
+
+void
+RunTimeThread::wait_in_pool_to_retire()
+{
+	struct timespec rel = { Retire_Idle_S, 0 };
+	_wait_state = RTTWS_wip;
+	_mqrt->_waiting_in_pool.timed_wait(&rel);
+	_wait_state = RTTWS_running;
+}
+
+void
+RunTimeThread::start()
+{
+	SetTrue keep_true_during_lifetime(_thread_running);
+	EventBaseSharedPtr ev;
+	EventBasePtr evb;
+	{
+		AutoLock al(&(_mqrt->_manager_lock));
+		_mqrt->drain_classic_queue(_home);
+		_mqrt->spawn_workers();
+	}
+	while(_system_running && !_request_death) {
+		if(_mqrt->_load_flow_next) {
+			AutoLock al(&(_mqrt->_manager_lock));
+			if(_mqrt->_load_flow_next) {
+				_mqrt->_load_flow_next = false;
+				_mqrt->load_flow();
+				_mqrt->drain_classic_queue(_home);
+			}
+		}
+		if(_mqrt->_mq.pop(_home,_seed,evb)) {
+			_last_work = fast_time(NULL);
+			_mqrt->wake_more();
+			ev = evb;
+			handle(ev);
+			ev.reset();
+		} else if(!wait_for_work()) {
+			break;
+		}
+	}
+	oflux_testcancel();
+	AutoLock al(&(_mqrt->_manager_lock));
+	_mqrt->remove(this);
+	if(_retired) {
+		++_mqrt->_stats.retired;
+		oflux_log_info("runtime thread %d is retiring\n", _tid);
+	} else {
+		oflux_log_info("runtime thread %d is exiting\n", _tid);
+		if(_mqrt->_thread_count > 0) {
+			_mqrt->wake_another_thread();
+		}
+	}
+}
+
+int
+RunTimeThread::execute(EventBaseSharedPtr & ev)
+{
+#ifdef PROFILING
+	TimerStart real_timing_execution(ev->flow_node()->real_timer_stats());
+	TimerStartPausable oflux_timing_execution(ev->flow_node()->oflux_timer_stats(), _timer_list);
+	_oflux_timer = & oflux_timing_execution;
+#endif
+	int return_code = ev->execute();
+#ifdef PROFILING
+	_oflux_timer = NULL;
+#endif
+	return return_code;
+}
+
+void
+RunTimeThread::handle(EventBaseSharedPtr & ev)
+{
+	_flow_node_working = ev->flow_node();
+	_this_event = ev.get();
+	std::vector<EventBasePtr> successor_events;
+	// ---------------- Execution -------------------
+	// node functions run without the manager lock (guards keep what
+	// must be serialized apart)
+	int return_code;
+	if(ev->getIsDetached() && _mqrt->canDetachMore()) {
+		_mqrt->hand_off(); // expected to block
+		SetTrue st(_detached);
+		__sync_fetch_and_add(&(_mqrt->_detached_count),1);
+		return_code = execute(ev);
+		__sync_fetch_and_sub(&(_mqrt->_detached_count),1);
+	} else {
+		SetTrue st(_detached); // not holding the manager lock
+		return_code = execute(ev);
+	}
+	{
+		AutoLock al(&(_mqrt->_manager_lock));
+		complete(ev,return_code,successor_events);
+	}
+	_mqrt->push_list(_home,successor_events);
+	_this_event = NULL;
+	_flow_node_working = NULL;
+}
+
+void
+RunTimeThread::complete(
+	  EventBaseSharedPtr & ev
+	, int return_code
+	, std::vector<EventBasePtr> & successor_events)
+{
+	// ----------- Successor processing -------------
+	if(return_code) { // error encountered
+		event::successors_on_error(
+			  successor_events // output
+			, ev
+			, return_code);
+	} else { // no error encountered
+		event::successors_on_no_error(
+			  successor_events // output
+			, ev);
+	}
+	// ------------ Release held atomics --------------
+	std::vector<EventBasePtr> successor_events_released;
+#ifdef SHARED_PTR_EVENTS
+	ev->atomics().release(successor_events_released,ev);
+#else // SHARED_PTR_EVENTS
+	ev->atomics().release(successor_events_released,_this_event);
+#endif // SHARED_PTR_EVENTS
+	for(int i = 0; i < (int)successor_events_released.size(); i++) {
+		EventBasePtr & succ_ev = successor_events_released[i];
+		if(succ_ev->atomics().acquire_all_or_wait(succ_ev)) {
+			successor_events.push_back(successor_events_released[i]);
+		}
+	}
+	if(_mqrt->_metrics_wanted) {
+		_mqrt->take_wanted_metrics();
+	}
+}
+
+} // namespace multiqueue
+} // namespace runtime
+
+RunTimeBase *
+_create_multiqueue_runtime(const RunTimeConfiguration & rtc)
+{
+	return new runtime::multiqueue::RunTime(rtc);
+}
+
+} // namespace oflux
@@ -0,0 +1,161 @@
+#ifndef _OFLUX_MULTIQUEUE_RUNTIME_H
+#define _OFLUX_MULTIQUEUE_RUNTIME_H
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file OFluxMultiQueueRunTime.h
+ * @author Mark Pichora
+ * A variant of the classic runtime (OFLUX_CONFIG=runtime_number=2).
+ * Runnable events sit in a MultiQueue (one shard per worker) instead of
+ * the single Queue, so workers pop and push events without the manager
+ * lock, and they run node functions without it too (as classic runs
+ * detached nodes), so node functions may run concurrently (as with the
+ * lock-free runtime).  The manager lock is only held to acquire/release
+ * guards and to compute successors, so the classic guard implementation
+ * is used unchanged.
+ * When a worker is about to block (a shimmed call, seen through
+ * currently_detached(), or a detached node) with work queued and no idle
+ * worker, another one is started to take over the queue.  Workers
+ * started that way beyond the initial count retire once they find no
+ * work.
+ */
+
+#include "OFluxRunTime.h"
+
+namespace oflux {
+namespace runtime {
+namespace multiqueue {
+
+class RunTimeThread;
+
+class RunTime : public classic::RunTime {
+public:
+	friend class RunTimeThread;
+
+	RunTime(const RunTimeConfiguration & rtc);
+	virtual ~RunTime();
+	/**
+	 * @brief an idle worker takes the queue, or one is started
+	 * (manager lock held)
+	 */
+	virtual int wake_another_thread();
+	/**
+	 * @brief always true: workers never hold the manager lock in
+	 * node code, so the shim passes calls straight through (after
+	 * hand_off())
+	 */
+	virtual bool currently_detached();
+	virtual void log_snapshot();
+	virtual classic::RunTimeThread * new_RunTimeThread(oflux_thread_t tid = 0);
+	virtual void submitEvents(const std::vector<EventBasePtr> &);
+protected:
+	virtual void queue_metrics_snapshot(metrics::Snapshot & s);
+	/**
+	 * @brief enqueue on shard home and wake an idle worker
+	 * (called without the manager lock)
+	 */
+	void push_list(int home, const std::vector<EventBasePtr> & evs);
+	/**
+	 * @brief move events from the classic queue (sources and loaded
+	 * flows land there) to shard home (manager lock held)
+	 */
+	void drain_classic_queue(int home);
+	/**
+	 * @brief start workers up to the target count (manager lock held)
+	 */
+	void spawn_workers();
+	/**
+	 * @brief the calling worker may block: let another take the queue
+	 * (called without the manager lock)
+	 */
+	void hand_off();
+	/**
+	 * @brief start one more worker (manager lock held)
+	 * @return false if the thread limits do not allow it
+	 */
+	bool add_worker();
+	inline void wake_more()
+	{
+		if(_idle > 0 && !_mq.empty()) {
+			AutoLock al(&_manager_lock);
+			_waiting_in_pool.signal();
+		}
+	}
+	static int worker_target(const RunTimeConfiguration & rtc);
+protected:
+	int          _num_workers; // started right away
+	int          _max_threads; // limit for workers added on blocking
+	int          _next_home;
+	volatile int _idle;
+	MultiQueue   _mq;
+	struct Stats {
+		Stats() : handoffs(0), retired(0) {}
+		unsigned long handoffs; // workers started for a blocked one
+		unsigned long retired;  // of those, exited when idle
+	} _stats;
+};
+
+class RunTimeThread : public classic::RunTimeThread {
+public:
+	enum { Retire_Idle_S = 2 }; // added workers without work this long exit
+
+	RunTimeThread(RunTime * rt, int home, oflux_thread_t tid = 0)
+		: classic::RunTimeThread(rt,tid)
+		, _mqrt(rt)
+		, _home(home)
+		, _seed(2463534242U + 97U * home)
+		, _may_retire(tid == 0) // not the thread that called start()
+		, _retired(false)
+		, _last_work(fast_time(NULL))
+		{}
+	virtual ~RunTimeThread() {}
+	virtual void start();
+	void handle(EventBaseSharedPtr & ev);
+	inline int home() const { return _home; }
+protected:
+	/**
+	 * @brief park in the pool until there is work
+	 * @return false if the thread should exit (or retire)
+	 */
+	bool wait_for_work();
+	/**
+	 * @brief wait_in_pool() for at most Retire_Idle_S
+	 */
+	void wait_in_pool_to_retire();
+	int execute(EventBaseSharedPtr & ev);
+	/**
+	 * @brief successors and guard release (manager lock held)
+	 */
+	void complete(EventBaseSharedPtr & ev
+		, int return_code
+		, std::vector<EventBasePtr> & successor_events);
+protected:
+	RunTime *    _mqrt;
+	int          _home; // MultiQueue shard
+	unsigned int _seed;
+	bool         _may_retire;
+	bool         _retired;
+	time_t       _last_work; // when an event was last popped
+};
+
+} // namespace multiqueue
+} // namespace runtime
+} // namespace oflux
+
+#endif // _OFLUX_MULTIQUEUE_RUNTIME_H
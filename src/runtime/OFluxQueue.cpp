@@ -17,8 +17,11 @@
  */
 #include "OFluxLogging.h"
 #include "OFluxQueue.h"
+#include "OFluxWrappers.h"
 #include "event/OFluxEventBase.h"
 #include "OFluxLibDTrace.h"
+#include <algorithm>
+#include <cstdio>
 
 
 namespace oflux {
@@ -29,25 +32,115 @@ Queue::element_name(const Element & e)
 	return flow::get_node_name(e->flow_node());
 }
 
+QueueLanes::QueueLanes()
+	: _size(0)
+{
+	for(int i = 0; i < Lanes; ++i) {
+		_stats.pushed[i] = 0;
+		_stats.max_depth[i] = 0;
+	}
+}
+
+int
+QueueLanes::lane_of(const Element & e)
+{
+	return e->flow_node()->lane();
+}
+
+void
+QueueLanes::push_back(const Element & e)
+{
+	int lane = lane_of(e);
+	_q[lane].push_back(e);
+	++_size;
+	++_stats.pushed[lane];
+	_stats.max_depth[lane] = std::max(_stats.max_depth[lane],(int)_q[lane].size());
+	PUBLIC_FIFO_PUSH(get_EventBasePtr(e),Queue::element_name(e));
+}
+
+void
+QueueLanes::push_front(const Element & e)
+{
+	int lane = lane_of(e);
+	_q[lane].push_front(e);
+	++_size;
+	++_stats.pushed[lane];
+	_stats.max_depth[lane] = std::max(_stats.max_depth[lane],(int)_q[lane].size());
+	PUBLIC_FIFO_PUSH(get_EventBasePtr(e),Queue::element_name(e));
+}
+
+int
+QueueLanes::pop(Element & e, int min_lane)
+{
+	if(_size == 0) {
+		return -1;
+	}
+	for(int lane = Lanes-1; lane >= min_lane; --lane) {
+		if(_q[lane].size() > 0) {
+			e = _q[lane].front();
+			_q[lane].pop_front();
+			--_size;
+			PUBLIC_FIFO_POP(get_EventBasePtr(e),Queue::element_name(e));
+			return lane;
+		}
+	}
+	return -1;
+}
+
+void
+QueueLanes::clear()
+{
+	for(int i = 0; i < Lanes; ++i) {
+		_q[i].clear();
+	}
+	_size = 0;
+}
+
+void
+QueueLanes::log_snapshot()
+{
+	for(int lane = Lanes-1; lane >= 0; --lane) {
+		std::deque<Element>::iterator dqitr = _q[lane].begin();
+		std::deque<Element>::iterator dqitr_end = _q[lane].end();
+		int sz = _q[lane].size();
+		while(dqitr != dqitr_end && sz > 0) {
+			if(get_EventBasePtr(*dqitr)) { (*dqitr)->log_snapshot();
+			}
+			dqitr++;
+			sz--; // done for safety -- never know who will access this in MT (you are bad ppl!)
+		}
+	}
+}
+
+void
+QueueLanes::log_stats(const char * what)
+{
+	for(int lane = Lanes-1; lane >= 0; --lane) {
+		oflux_log_info("%s lane %d: %d queued %d max depth %lu pushed\n"
+			, what
+			, lane
+			, (int)_q[lane].size()
+			, _stats.max_depth[lane]
+			, _stats.pushed[lane]);
+	}
+}
+
 void
 Queue::push(Element & e)
 {
 	_q.push_back(e);
-	PUBLIC_FIFO_PUSH(get_EventBasePtr(e),element_name(e));
 }
 
 void
 Queue::push_priority(Element & e)
 {
 	_q.push_front(e);
-	PUBLIC_FIFO_PUSH(get_EventBasePtr(e),element_name(e));
 }
 void
 Queue::push_list(const std::vector<Element> & vec)
 {
 	for(int i = 0; i < (int)vec.size(); i++) {
 		_q.push_back(vec[i]);
-		PUBLIC_FIFO_PUSH(get_EventBasePtr(vec[i]),element_name(vec[i]));
 	}
 }
 void
@@ -56,36 +149,193 @@ Queue::push_list_priority(const std::vector<Element> & vec)
 	// reverse
 	for(int i = ((int)vec.size())-1; i >= 0; i--) {
 		_q.push_front(vec[i]);
-		PUBLIC_FIFO_PUSH(get_EventBasePtr(vec[i]),element_name(vec[i]));
 	}
 }
 
 bool
 Queue::pop(Element & e)
 {
-	bool res = _q.size() > 0;
-	if(res) {
-		e = _q.front();
-		_q.pop_front();
-		PUBLIC_FIFO_POP(get_EventBasePtr(e),element_name(e));
-	}
-	return res;
+	return _q.pop(e) >= 0;
 }
 
 void
 Queue::log_snapshot()
 {
-	std::deque<Element>::iterator dqitr = _q.begin();
-	std::deque<Element>::iterator dqitr_end = _q.end();
-	int sz = _q.size();
 	oflux_log_info("<front of the event queue here>\n");
-	while(dqitr != dqitr_end && sz > 0) {
-		if(get_EventBasePtr(*dqitr)) { (*dqitr)->log_snapshot();
+	_q.log_snapshot();
+	oflux_log_info("<back of the event queue here>\n");
+	_q.log_stats("event queue");
+}
+
+MultiQueue::MultiQueue(int shards)
+	: _num_shards(shards < 1
+		? 1
+		: (shards > Max_Shards ? Max_Shards : shards))
+	, _shards(new Shard[_num_shards])
+{
+	for(int i = 0; i < QueueLanes::Lanes; ++i) {
+		_lane_size[i] = 0;
+	}
+}
+
+MultiQueue::~MultiQueue()
+{
+	delete [] _shards;
+}
+
+void
+MultiQueue::push_list(int home, const std::vector<Element> & vec)
+{
+	if(vec.empty()) {
+		return;
+	}
+	Shard & s = _shards[home % _num_shards];
+	AutoLock al(&s.lck);
+	for(int i = 0; i < (int)vec.size(); i++) {
+		s.q.push_back(vec[i]);
+		__sync_fetch_and_add(&_lane_size[QueueLanes::lane_of(vec[i])],1);
+	}
+	s.size = s.q.size();
+}
+
+bool
+MultiQueue::pop_locked(Shard & s, Element & e, int min_lane)
+{
+	int lane = s.q.pop(e,min_lane);
+	if(lane >= 0) {
+		s.size = s.q.size();
+		__sync_fetch_and_sub(&_lane_size[lane],1);
+	}
+	return lane >= 0;
+}
+
+int
+MultiQueue::top_lane() const
+{
+	for(int lane = QueueLanes::Lanes-1; lane > 0; --lane) {
+		if(_lane_size[lane] > 0) {
+			return lane;
 		}
-		dqitr++;
-		sz--; // done for safety -- never know who will access this in MT (you are bad ppl!)
 	}
-	oflux_log_info("<back of the event queue here>\n");
+	return 0;
+}
+
+static inline unsigned int
+xorshift(unsigned int & seed)
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+bool
+MultiQueue::pop(int home, unsigned int & seed, Element & e)
+{
+	home = home % _num_shards;
+	int top = top_lane();
+	if(top > 0) {
+		// a higher lane is queued somewhere: find it before the rest
+		for(int i = 0; i < _num_shards; ++i) {
+			Shard & s = _shards[(home + i) % _num_shards];
+			if(s.size > 0) {
+				AutoLock al(&s.lck);
+				if(pop_locked(s,e,top)) {
+					return true;
+				}
+			}
+		}
+	}
+	if(_shards[home].size > 0) {
+		AutoLock al(&(_shards[home].lck));
+		if(pop_locked(_shards[home],e)) {
+			return true;
+		}
+	}
+	if(_num_shards > 1) {
+		// two choices: take from the longer of two random shards
+		int c1 = xorshift(seed) % _num_shards;
+		int c2 = xorshift(seed) % _num_shards;
+		if(_shards[c2].size > _shards[c1].size) {
+			std::swap(c1,c2);
+		}
+		int choice[] = { c1, c2 };
+		for(int i = 0; i < 2; ++i) {
+			Shard & s = _shards[choice[i]];
+			if(s.size > 0 && oflux_mutex_trylock(&s.lck) == 0) {
+				bool res = pop_locked(s,e);
+				oflux_mutex_unlock(&s.lck);
+				if(res) {
+					return true;
+				}
+			}
+		}
+	}
+	// sweep before reporting empty (the samples may have missed)
+	int start = xorshift(seed) % _num_shards;
+	for(int i = 0; i < _num_shards; ++i) {
+		Shard & s = _shards[(start + i) % _num_shards];
+		if(s.size > 0) {
+			AutoLock al(&s.lck);
+			if(pop_locked(s,e)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool
+MultiQueue::empty() const
+{
+	for(int i = 0; i < _num_shards; ++i) {
+		if(_shards[i].size > 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int
+MultiQueue::size() const
+{
+	int res = 0;
+	for(int i = 0; i < _num_shards; ++i) {
+		res += _shards[i].size;
+	}
+	return res;
+}
+
+void
+MultiQueue::clear()
+{
+	for(int i = 0; i < _num_shards; ++i) {
+		AutoLock al(&(_shards[i].lck));
+		_shards[i].q.clear();
+		_shards[i].size = 0;
+	}
+	for(int i = 0; i < QueueLanes::Lanes; ++i) {
+		_lane_size[i] = 0;
+	}
+}
+
+void
+MultiQueue::log_snapshot()
+{
+	for(int i = 0; i < _num_shards; ++i) {
+		AutoLock al(&(_shards[i].lck));
+		oflux_log_info("<front of event queue shard %d (%d events)>\n"
+			, i
+			, (int)_shards[i].q.size());
+		_shards[i].q.log_snapshot();
+	}
+	oflux_log_info("<back of the event queue shards here>\n");
+	for(int i = 0; i < _num_shards; ++i) {
+		char what[32];
+		snprintf(what,sizeof(what),"shard %d",i);
+		AutoLock al(&(_shards[i].lck));
+		_shards[i].q.log_stats(what);
+	}
 }
 
 } // namespace oflux
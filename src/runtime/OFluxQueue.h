@@ -21,35 +21,119 @@
 /**
  * @file OFluxQueue.h
  * @author Mark Pichora
- * So far this run time only has a FIFO queue.
+ * The run time queues are FIFO within each priority lane
+ * (see flow::Node::lane()), and the highest lane is popped first.
  */
 
 #include "OFlux.h"
+#include "OFluxThreads.h"
+#include "flow/OFluxFlowNode.h"
 #include <deque>
 #include <vector>
 
-// queue for events (FIFO)
+// queue for events (FIFO per lane)
 
 namespace oflux {
 
+/**
+ * @class QueueLanes
+ * @brief one FIFO per priority lane (not synchronized)
+ * Keeps per-lane depth statistics for log_snapshot().
+ */
+class QueueLanes {
+public:
+	typedef EventBasePtr Element;
+	enum { Lanes = flow::Node::Priority_Lanes };
+
+	QueueLanes();
+	static int lane_of(const Element & e);
+	void push_back(const Element & e);
+	void push_front(const Element & e);
+	/**
+	 * @brief pop from the highest non-empty lane at or above min_lane
+	 * @return the lane popped from (-1 if there was nothing)
+	 */
+	int pop(Element & e, int min_lane = 0);
+	inline int size() const { return _size; }
+	inline int size(int lane) const { return _q[lane].size(); }
+	void clear();
+	void log_snapshot(); // the events, highest lane first
+	void log_stats(const char * what);
+private:
+	std::deque<Element> _q[Lanes];
+	int _size;
+	struct Stats {
+		unsigned long pushed[Lanes];
+		int max_depth[Lanes];
+	} _stats;
+};
+
 /**
  * @class Queue
  * @brief the run time's queue data structure
  */
 class Queue {
 public:
-	typedef EventBasePtr Element;
+	typedef QueueLanes::Element Element;
 	Queue() {}
 	~Queue() { _q.clear(); }
 	static const char * element_name(const Element &);
 	void push(Element & e);
-	void push_priority(Element & e);
+	void push_priority(Element & e); // front of its lane
 	void push_list(const std::vector<Element> & vec);
 	void push_list_priority(const std::vector<Element> & vec);
 	bool pop(Element & e);
+	inline int size() const { return _q.size(); }
+	inline int size(int lane) const { return _q.size(lane); }
 	void log_snapshot();
 private:
-	std::deque<Element> _q;
+	QueueLanes _q;
+};
+
+/**
+ * @class MultiQueue
+ * @brief a relaxed FIFO made of one locked queue (shard) per thread
+ * Threads push to their home shard and pop from it first.  When it is
+ * empty they sample two other shards and pop from the longer one, so
+ * the ordering is only FIFO per shard (the relaxed multi-queue).
+ * Lanes are honoured across shards: while any shard holds events in a
+ * lane above 0, pop() looks for those before taking anything lower.
+ */
+class MultiQueue {
+public:
+	typedef Queue::Element Element;
+	enum { Max_Shards = 64 };
+
+	MultiQueue(int shards);
+	~MultiQueue();
+	inline int shards() const { return _num_shards; }
+	void push_list(int home, const std::vector<Element> & vec);
+	/**
+	 * @brief pop an element (home shard first)
+	 * @param seed is the caller's random state (never 0)
+	 * @return false if every shard was seen empty
+	 */
+	bool pop(int home, unsigned int & seed, Element & e);
+	bool empty() const; // approximate without locks
+	int size() const;
+	inline int lane_size(int lane) const { return _lane_size[lane]; }
+	void clear();
+	void log_snapshot();
+private:
+	struct Shard {
+		Shard() : size(0) { oflux_mutex_init(&lck); }
+		~Shard() { oflux_mutex_destroy(&lck); }
+		oflux_mutex_t lck;
+		QueueLanes q;
+		volatile int size;
+		char _pad[64]; // keep shard locks off each other's lines
+	};
+	bool pop_locked(Shard & s, Element & e, int min_lane = 0);
+	int top_lane() const; // highest lane with queued events
+private:
+	int          _num_shards;
+	Shard *      _shards;
+	volatile int _lane_size[QueueLanes::Lanes]; // over all shards
 };
 
 };
@@ -40,6 +40,12 @@ public:
 		log[i%log_size].index = i;
 		return log[i%log_size].d;
 	}
+	inline D & submit_local() // when only one thread submits
+	{
+		long long i = index++;
+		log[i%log_size].index = i;
+		return log[i%log_size].d;
+	}
 	inline long long at() { return index; }
 protected:
 	long long index;
@@ -17,6 +17,7 @@
  */
 #include "OFluxRunTime.h"
 #include "flow/OFluxFlow.h"
+#include "flow/OFluxFlowNode.h"
 #include "xml/OFluxXML.h"
 #include "event/OFluxEventBase.h"
 #include "event/OFluxEventOperations.h"
@@ -60,8 +61,13 @@ RunTime::RunTime(const RunTimeConfiguration & rtc)
 	, _detached_count(0) 
 	, _doors(this)
 	, _door_thread(NULL)
+	, _worker_cpus(rtc.worker_cpus)
+	, _housekeeping_cpus(rtc.housekeeping_cpus)
+	, _metrics_wanted(NULL)
 {
 	oflux_log_info("oflux::runtime::classic::RunTime initializing\n");
+	oflux_mutex_init(&_metrics_lock);
+	oflux_cond_init(&_metrics_taken);
 	if(rtc.initAtomicMapsF) {
 		// create the AtomicMaps (guards)
 		(*(rtc.initAtomicMapsF))(atomics_style());
@@ -113,6 +119,8 @@ RunTime::~RunTime()
                 delete back;
         }
 	deinit_eminfo();
+	oflux_cond_destroy(&_metrics_taken);
+	oflux_mutex_destroy(&_metrics_lock);
 }
 
 void 
@@ -166,6 +174,16 @@ RunTime::load_flow(
 		, this->flow()
 		, atomics_style());
         flow->assignMagicNumbers(); // for guard ordering
+	// there are no timers here: a timed source runs back to back
+	std::vector<flow::Node *> & srcs = flow->sources();
+	for(size_t i = 0; i < srcs.size(); ++i) {
+		if(srcs[i]->period_ns() > 0) {
+			oflux_log_warn("RunTime::load_flow() source %s has a "
+				"period, which only the lock-free runtime "
+				"honours (it will run back to back)\n"
+				, srcs[i]->getName());
+		}
+	}
 	// push the sources (first time)
 	if(_running) {
 		std::vector<EventBasePtr> events_vec;
@@ -224,11 +242,13 @@ RunTime::start()
 	_thread_count++;
 	RunTime::thread_data_key.set(rtt);
 	oflux::lockfree::ThreadNumber::init();
+	rtt->place();
 	((RunTimeBase::initShim)(this));
 	// if doors, start up a service thread now
 	if(_doors.create_doors(RunTime_start_door_thread)) {
 		//START_DOORS;
 	}
+	_metrics.start(this,_rtc.stack_size);
 	// running phase
 	rtt->start();
 	// shutdown phase
@@ -242,6 +262,7 @@ RunTime::start()
 
 		sched_yield();
 	}
+	_metrics.stop();
 
         deinit_eminfo();
         oflux_log_info("RunTime::start() returning....\n");
@@ -288,6 +309,20 @@ RunTime::log_snapshot()
 		, _rtc.max_detached_threads);
 	oflux_log_info("Waiting to run count: %d\n", _waiting_to_run.count());
 	oflux_log_info("Waiting in pool: %d\n", _waiting_in_pool.count());
+	oflux_log_info("Placement: workers on cpus %s housekeeping on cpus %s\n"
+		, _worker_cpus.str().c_str()
+		, _housekeeping_cpus.str().c_str());
+	shimReadStatsFnType shimReadStats =
+		(shimReadStatsFnType)dlsym (RTLD_DEFAULT, "shimReadStats");
+	if(shimReadStats) {
+		unsigned long hits = 0;
+		unsigned long misses = 0;
+		(*shimReadStats)(&hits,&misses);
+		oflux_log_info("Shim regular file read()s resident: %lu "
+			"not resident: %lu\n"
+			, hits
+			, misses);
+	}
 #ifdef THREAD_COLLECTION
 	char watermark_str[400];
 	_waiting_in_pool.counter_implementation().log_snapshot(watermark_str,400);
@@ -298,6 +333,107 @@ RunTime::log_snapshot()
 	flow()->log_snapshot();
 }
 
+static void *
+__fold_count_wait_state(void * v_counts, RunTimeThread * rtt)
+{
+	reinterpret_cast<int *>(v_counts)[rtt->get_wait_state()]++;
+	return v_counts;
+}
+
+enum { Metrics_Poll_ms = 10, Metrics_Timeout_ms = 1000 };
+
+void
+RunTime::metrics_snapshot(metrics::Snapshot & s)
+{
+	AutoLock ml(&_metrics_lock);
+	_metrics_wanted = &s;
+	for(int waited_ms = 0; _metrics_wanted; waited_ms += Metrics_Poll_ms) {
+		if(oflux_mutex_trylock(&_manager_lock) == 0) {
+			// no thread is running (they are all in the pool)
+			_metrics_wanted = NULL;
+			metrics_snapshot_locked(s);
+			oflux_mutex_unlock(&_manager_lock);
+		} else if(waited_ms >= Metrics_Timeout_ms) {
+			_metrics_wanted = NULL;
+			oflux_log_warn("RunTime::metrics_snapshot() gave up waiting "
+				"for the runtime lock\n");
+		} else {
+			struct timespec rel = { 0, Metrics_Poll_ms * 1000000L };
+			oflux_cond_reltimedwait(&_metrics_taken,&_metrics_lock,&rel);
+		}
+	}
+}
+
+void
+RunTime::take_wanted_metrics()
+{
+	AutoLock ml(&_metrics_lock);
+	if(_metrics_wanted) {
+		metrics_snapshot_locked(*_metrics_wanted);
+		_metrics_wanted = NULL;
+		oflux_cond_signal(&_metrics_taken);
+	}
+}
+
+void
+RunTime::metrics_snapshot_locked(metrics::Snapshot & s)
+{
+	static const char * wait_state_label[] =
+		{ "running"
+		, "waiting_to_run"
+		, "waiting_in_pool"
+		, "blocking_call"
+		, "waiting_to_run_shim"
+		, "door_servicing"
+		, "door_waiting"
+		};
+	enum { Wait_States = sizeof(wait_state_label)/sizeof(wait_state_label[0]) };
+	int counts[Wait_States] = { 0 };
+	_thread_list.fold(counts,__fold_count_wait_state);
+	metrics::Family & f = s.gauge("oflux_runtime_threads"
+		, "runtime threads by state");
+	for(int i = 0; i < Wait_States; ++i) {
+		metrics::Labels l;
+		l.add("state",wait_state_label[i]);
+		f.add(l,counts[i]);
+	}
+	metrics::Labels l;
+	s.gauge("oflux_runtime_threads_detached"
+		, "threads running detached events").add(l,_detached_count);
+	s.gauge("oflux_runtime_threads_max"
+		, "thread pool limit (0 for none)")
+		.add(l,_rtc.max_thread_pool_size);
+	queue_metrics_snapshot(s);
+	shimReadStatsFnType shimReadStats =
+		(shimReadStatsFnType)dlsym (RTLD_DEFAULT, "shimReadStats");
+	if(shimReadStats) {
+		unsigned long hits = 0;
+		unsigned long misses = 0;
+		(*shimReadStats)(&hits,&misses);
+		s.counter("oflux_shim_reads_resident_total"
+			, "shimmed regular file read()s of resident pages")
+			.add(l,hits);
+		s.counter("oflux_shim_reads_not_resident_total"
+			, "shimmed regular file read()s that were not resident")
+			.add(l,misses);
+	}
+	if(flow()) {
+		flow()->metrics_snapshot(s);
+	}
+}
+
+void
+RunTime::queue_metrics_snapshot(metrics::Snapshot & s)
+{
+	metrics::Family & f = s.gauge("oflux_runtime_queue_depth"
+		, "events in the run queue by lane");
+	for(int lane = 0; lane < QueueLanes::Lanes; ++lane) {
+		metrics::Labels l;
+		l.add("lane",(long long)lane);
+		f.add(l,_queue.size(lane));
+	}
+}
+
 RunTimeThreadAbstractForShim * 
 RunTime::thread()
 {
@@ -369,7 +505,9 @@ RunTimeThread_start_thread(void *pthis)
 	RunTimeThread * rtt = static_cast<RunTimeThread*> (pthis);
 	RunTime::thread_data_key.set(rtt);
 	oflux::lockfree::ThreadNumber::init();
+	rtt->place();
 	rtt->start();
+	oflux::lockfree::ThreadNumber::release();
 	return NULL;
 }
 
@@ -413,6 +551,7 @@ RunTimeThread_start_door_thread(void * pthis)
 {
 	RunTimeThread * rtt = static_cast<RunTimeThread*> (pthis);
 	oflux::lockfree::ThreadNumber::init();
+	rtt->place(true);
 	SetTrue keep_true_during_lifetime(rtt->_thread_running);
 	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
 	OFLUX_DOOR_RETURN;
@@ -473,6 +612,9 @@ RunTimeThread::start()
 			_rt->_load_flow_next = false;
 			_rt->load_flow();
 		}
+		if(_rt->_metrics_wanted) {
+			_rt->take_wanted_metrics();
+		}
 
 #ifdef THREAD_COLLECTION
 		static int thread_collection_sample_counter = 0;
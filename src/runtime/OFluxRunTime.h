@@ -30,6 +30,8 @@
 #include "OFluxLinkedList.h"
 #include "OFluxSharedPtr.h"
 #include "OFluxDoor.h"
+#include "OFluxAffinity.h"
+#include "OFluxMetrics.h"
 
 namespace oflux {
 namespace runtime {
@@ -85,6 +87,12 @@ public:
 	 */
 	virtual void log_snapshot();
 	virtual void log_snapshot_guard(const char * guardname);
+	/**
+	 * @brief thread states, queue depths and the flow's metrics
+	 * (taken under the runtime lock: the running thread holds it while
+	 * it has work, so it is asked to fill s in between events)
+	 */
+	virtual void metrics_snapshot(metrics::Snapshot & s);
 
 	/**
 	 * @brief Number of threads the runtime has
@@ -114,6 +122,16 @@ protected:
 	virtual flow::Flow * flow() 
 	{ return _active_flows.size() ? _active_flows.front() : NULL; }
 	virtual void submitEvents(const std::vector<EventBasePtr> &);
+	/**
+	 * @brief the run queue part of metrics_snapshot()
+	 */
+	virtual void queue_metrics_snapshot(metrics::Snapshot & s);
+	void metrics_snapshot_locked(metrics::Snapshot & s);
+	/**
+	 * @brief fill a snapshot metrics_snapshot() is waiting on
+	 * (called with the runtime lock held)
+	 */
+	void take_wanted_metrics();
 protected:
 	inline flow::Flow * _flow() 
 	{ return _active_flows.size() ? _active_flows.front() : NULL; }
@@ -126,6 +144,12 @@ protected:
 	int                 _detached_count;
 	doors::ServerDoorsContainer _doors;
 	RunTimeThread *     _door_thread;
+	CpuSet              _worker_cpus; // all workers share the set
+	CpuSet              _housekeeping_cpus; // door thread
+	metrics::Server     _metrics; // see OFluxMetrics.h
+	oflux_mutex_t       _metrics_lock; // protects _metrics_wanted
+	oflux_cond_t        _metrics_taken;
+	metrics::Snapshot * volatile _metrics_wanted;
 };
 
 
@@ -186,7 +210,14 @@ public:
 	virtual TimerStartPausable * oflux_timer() { return _oflux_timer; }
 #endif
 	inline flow::Node * working_flow_node() { return _flow_node_working; }
+	/**
+	 * @brief pin the calling thread to the worker CPUs (or to the
+	 * housekeeping CPUs for the door thread)
+	 */
+	inline void place(bool housekeeping = false)
+	{ (housekeeping ? _rt->_housekeeping_cpus : _rt->_worker_cpus).pin(); }
 	virtual void wait_state(RTT_WaitState ws) { _wait_state = ws; }
+	inline RTT_WaitState get_wait_state() const { return _wait_state; }
 protected:
         inline void enqueue_list(std::vector<EventBasePtr > & events) { _rt->_queue.push_list(events); }
 protected:
@@ -29,11 +29,21 @@ namespace flow {
  class Flow;
  class FunctionMapsAbstract;
 } // namespace flow
+namespace metrics {
+ class Snapshot;
+} // namespace metrics
 
 struct EnvironmentVar {
 public:
 	EnvironmentVar(int = 0);
 
+	/**
+	 * @return rtc with the lock-free runtime settings given in
+	 * OFLUX_CONFIG (spin_budget, handoff_depth, wake_threshold,
+	 * worker_cpus and housekeeping_cpus) in place of its own
+	 */
+	static RunTimeConfiguration configured(const RunTimeConfiguration & rtc);
+
 	bool nostart;
 	int  runtime_number;
 };
@@ -56,6 +66,12 @@ public:
 
 	virtual void log_snapshot_guard(const char * guardname) = 0;
 
+	/**
+	 * @brief add the runtime's (and its flow's) metrics to s
+	 * (called from the metrics server thread -- see OFluxMetrics.h)
+	 */
+	virtual void metrics_snapshot(metrics::Snapshot & s) = 0;
+
         virtual void getPluginNames(std::vector<std::string> & result) = 0;
 
 	virtual int thread_count() = 0;
@@ -73,6 +89,7 @@ class Factory {
 public:
 	enum {    classic  = 0
 		, melding  = 1
+		, multiqueue = 2
 		, lockfree = 4 
 	};
 
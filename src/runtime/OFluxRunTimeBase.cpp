@@ -17,14 +17,28 @@
  */
 #include "OFluxRunTimeBase.h"
 #include "OFluxLogging.h"
+#include "OFluxTrace.h"
+#include "OFluxMetrics.h"
 #include <cstring>
 #include <cstdlib>
+#include <algorithm>
 
 namespace oflux {
 
 initShimFnType RunTimeBase::initShim = NULL;
 deinitShimFnType RunTimeBase::deinitShim = NULL;
 
+namespace {
+// lock-free runtime settings from OFLUX_CONFIG ("" when not given)
+struct Settings {
+	std::string spin_budget;
+	std::string handoff_depth;
+	std::string wake_threshold;
+	std::string worker_cpus;
+	std::string housekeeping_cpus;
+} env_settings;
+} // namespace
+
 EnvironmentVar::EnvironmentVar(int rt_number)
 	: nostart(false)
 	, runtime_number(rt_number)
@@ -32,7 +46,12 @@ EnvironmentVar::EnvironmentVar(int rt_number)
 	// Examples:
 	//  export OFLUX_CONFIG=nostart
 	//  export OFLUX_CONFIG=runtime_number=1
+	//  export OFLUX_CONFIG=runtime_number=2
 	//  export OFLUX_CONFIG=runtime_number=4
+	//  export OFLUX_CONFIG=runtime_number=4,trace=/tmp/app.trace
+	//  export OFLUX_CONFIG=runtime_number=4,metrics=/tmp/app.metrics
+	//  export OFLUX_CONFIG=runtime_number=4,worker_cpus=2-7,housekeeping_cpus=0-1
+	//  (CPU lists use ':' for ',' here: worker_cpus=2-3:6-7)
 	static const char * var_name = "OFLUX_CONFIG";
 	static const char * delim = ",=";
 	char * val = getenv(var_name);
@@ -56,10 +75,61 @@ EnvironmentVar::EnvironmentVar(int rt_number)
 					}
 				}
 			}
+		} else if(strcmp(s,"trace") == 0) {
+			const char * v = strtok(NULL,delim);
+			if(v) { // dumped on SIGHUP and when the runtime stops
+				trace::output(v);
+				trace::enable(true);
+			}
+		} else if(strcmp(s,"metrics") == 0) {
+			const char * v = strtok(NULL,delim);
+			if(v) { // served while the runtime runs
+				metrics::socket_path(v);
+			}
+		} else {
+			std::string * setting = NULL;
+			if(strcmp(s,"spin_budget") == 0) {
+				setting = &env_settings.spin_budget;
+			} else if(strcmp(s,"handoff_depth") == 0) {
+				setting = &env_settings.handoff_depth;
+			} else if(strcmp(s,"wake_threshold") == 0) {
+				setting = &env_settings.wake_threshold;
+			} else if(strcmp(s,"worker_cpus") == 0) {
+				setting = &env_settings.worker_cpus;
+			} else if(strcmp(s,"housekeeping_cpus") == 0) {
+				setting = &env_settings.housekeeping_cpus;
+			}
+			const char * v = (setting ? strtok(NULL,delim) : NULL);
+			if(v) {
+				*setting = v;
+				std::replace(setting->begin(),setting->end(),':',',');
+			}
 		}
 	}
 }
 
+RunTimeConfiguration
+EnvironmentVar::configured(const RunTimeConfiguration & rtc)
+{
+	RunTimeConfiguration res = rtc;
+	if(!env_settings.spin_budget.empty()) {
+		res.spin_budget = atoi(env_settings.spin_budget.c_str());
+	}
+	if(!env_settings.handoff_depth.empty()) {
+		res.handoff_depth = atoi(env_settings.handoff_depth.c_str());
+	}
+	if(!env_settings.wake_threshold.empty()) {
+		res.wake_threshold = atoi(env_settings.wake_threshold.c_str());
+	}
+	if(!env_settings.worker_cpus.empty()) {
+		res.worker_cpus = env_settings.worker_cpus.c_str();
+	}
+	if(!env_settings.housekeeping_cpus.empty()) {
+		res.housekeeping_cpus = env_settings.housekeeping_cpus.c_str();
+	}
+	return res;
+}
+
 namespace runtime {
 
 RunTimeAbstract *
@@ -71,6 +141,8 @@ Factory::create(int runtime_number, const RunTimeConfiguration & rtc)
 		return _create_lockfree_runtime(rtc);
 	} else if(runtime_number == Factory::melding) {
 		return _create_melding_runtime(rtc);
+	} else if(runtime_number == Factory::multiqueue) {
+		return _create_multiqueue_runtime(rtc);
 	} else { // classic case
 		return _create_classic_runtime(rtc);
 	}
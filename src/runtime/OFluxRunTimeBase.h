@@ -34,6 +34,7 @@ class Node;
 
 typedef void (*initShimFnType) (RunTimeAbstract *);
 typedef void (*deinitShimFnType) ();
+typedef void (*shimReadStatsFnType) (unsigned long *, unsigned long *);
 
 class RunTimeBase : public RunTimeAbstractForShim {
 public:
@@ -60,6 +61,7 @@ public:
 	virtual int atomics_style() const { return 1; }
         virtual void log_snapshot() = 0;
         virtual void log_snapshot_guard(const char * guardname) = 0;
+        virtual void metrics_snapshot(metrics::Snapshot & s) = 0;
         virtual void getPluginNames(std::vector<std::string> & result) = 0;
 	virtual int thread_count() = 0;
 	virtual const RunTimeConfiguration & config() const { return _rtc; }
@@ -73,6 +75,7 @@ protected:
 // list of runtime factory functions:
 extern RunTimeBase * _create_classic_runtime(const RunTimeConfiguration &);
 extern RunTimeBase * _create_melding_runtime(const RunTimeConfiguration &);
+extern RunTimeBase * _create_multiqueue_runtime(const RunTimeConfiguration &);
 extern RunTimeAbstract * _create_lockfree_runtime(const RunTimeConfiguration &);
 
 } // namespace oflux
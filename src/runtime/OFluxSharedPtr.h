@@ -141,6 +141,112 @@ private:
 	int * _pn;
 };
 
+/**
+ * @class intrusive_ptr
+ * @brief same interface as shared_ptr, but the count lives in the object
+ * T supplies (found by argument dependent lookup):
+ *   void intrusive_ptr_add_ref(T *);
+ *   int  intrusive_ptr_release(T *);  // returns the remaining count
+ *   int  intrusive_ptr_use_count(const T *);
+ * Adopting a raw pointer just bumps its count, so no separate counter
+ * is allocated and the count shares a cache line with the object.
+ */
+template<typename T>
+class intrusive_ptr {
+public:
+	explicit intrusive_ptr()
+		: _px(NULL)
+	{}
+	explicit intrusive_ptr(T *p)
+		: _px(p)
+	{
+		if(_px) {
+			intrusive_ptr_add_ref(_px);
+		}
+	}
+	intrusive_ptr(const intrusive_ptr<T> & sp)
+		: _px(sp._px)
+	{
+		if(_px) {
+			intrusive_ptr_add_ref(_px);
+		}
+	}
+	~intrusive_ptr()
+	{
+		unlink();
+	}
+	operator bool () const
+	{
+		return _px != 0;
+	}
+	inline intrusive_ptr<T> & operator=(const intrusive_ptr<T> &sp)
+	{
+		return (*this = sp._px);
+	}
+	T * operator->() const
+	{
+		assert(_px);
+		return _px;
+	}
+	inline intrusive_ptr<T> & operator=(T * p)
+	{
+		if(p) {
+			intrusive_ptr_add_ref(p); // before unlink (self assign)
+		}
+		unlink();
+		_px = p;
+		return *this;
+	}
+	inline void reset()
+	{
+		unlink();
+	}
+	inline void reset(T * p)
+	{
+		*this = p;
+	}
+	inline bool operator==(const intrusive_ptr<T> & sp) const
+	{
+		return _px == sp._px;
+	}
+	inline void swap(intrusive_ptr<T> & sp)
+	{
+		T * px = sp._px;
+		sp._px = _px;
+		_px = px;
+	}
+	inline T * get() const 
+	{ return _px; }
+	inline bool unique() const
+	{ return use_count() == 1; }
+	inline int use_count() const
+	{
+		return _px ? intrusive_ptr_use_count(_px) : 0;
+	}
+	inline T * recover()
+	{
+		T * tptr = NULL;
+		if(unique()) {
+			tptr = _px;
+			unlink(true);
+		}
+		return tptr;
+	}
+protected:
+	inline void unlink(bool no_delete = false)
+	{
+		if(_px) {
+			int r = intrusive_ptr_release(_px);
+			if(r == 0 && !no_delete) {
+				delete _px;
+			}
+		}
+		_px = NULL;
+	}
+private:
+	T * _px;
+};
+
 template<typename T>
 std::ostream& operator<<(std::ostream& o, const shared_ptr<T> & sp)
 {
@@ -148,6 +254,13 @@ std::ostream& operator<<(std::ostream& o, const shared_ptr<T> & sp)
 	return o;
 }
 
+template<typename T>
+std::ostream& operator<<(std::ostream& o, const intrusive_ptr<T> & sp)
+{
+	o << sp.get();
+	return o;
+}
+
 } // namespace oflux
 
 #endif // OFLUX_SHARED_POINTER
@@ -37,6 +37,7 @@ namespace oflux {
 # define oflux_mutex_destroy(X) mutex_destroy(X)
 # define oflux_mutex_lock(X) mutex_lock(X)
 # define oflux_mutex_unlock(X) mutex_unlock(X)
+# define oflux_mutex_trylock(X) mutex_trylock(X)
 # define oflux_rwlock_init(X) rwlock_init(X,USYNC_THREAD,0)
 # define oflux_rwlock_destroy(X) rwlock_destroy(X)
 # define oflux_rwlock_rdlock(X) rw_rdlock(X)
@@ -46,6 +47,7 @@ namespace oflux {
 # define oflux_cond_destroy(X) cond_destroy(X)
 # define oflux_self thr_self // function on ()
 # define oflux_cond_wait(X,Y) cond_wait(X,Y)
+# define oflux_cond_reltimedwait(X,Y,Z) cond_reltimedwait(X,Y,Z) // Z is a relative timespec *
 # define oflux_cond_signal(X) cond_signal(X)
 # define oflux_key_create(X,Y) thr_keycreate(X,Y)
 # define oflux_key_delete(X) 
@@ -77,6 +79,7 @@ namespace oflux {
 # define oflux_mutex_destroy(X) pthread_mutex_destroy(X)
 # define oflux_mutex_lock(X) pthread_mutex_lock(X)
 # define oflux_mutex_unlock(X) pthread_mutex_unlock(X)
+# define oflux_mutex_trylock(X) pthread_mutex_trylock(X)
 # define oflux_rwlock_init(X) pthread_rwlock_init(X,NULL)
 # define oflux_rwlock_destroy(X) pthread_rwlock_destroy(X)
 # define oflux_rwlock_rdlock(X) pthread_rwlock_rdlock(X)
@@ -88,6 +91,21 @@ namespace oflux {
 # define oflux_cond_wait(X,Y) pthread_cond_wait(X,Y)
 # define oflux_cond_signal(X) pthread_cond_signal(X)
 # define oflux_cond_broadcast(X) pthread_cond_broadcast(X)
+# include <sys/time.h>
+namespace oflux {
+  inline int oflux_cond_reltimedwait(pthread_cond_t * c, pthread_mutex_t * m, const struct timespec * rel) {
+	struct timeval now;
+	gettimeofday(&now,NULL);
+	struct timespec abs;
+	abs.tv_sec = now.tv_sec + rel->tv_sec;
+	abs.tv_nsec = now.tv_usec * 1000L + rel->tv_nsec;
+	if(abs.tv_nsec >= 1000000000L) {
+		abs.tv_sec += 1;
+		abs.tv_nsec -= 1000000000L;
+	}
+	return pthread_cond_timedwait(c,m,&abs);
+  }
+} // namespace
 # define oflux_testcancel() pthread_testcancel()
 # define oflux_key_create(X,Y) pthread_key_create(X,Y)
 # define oflux_key_delete(X) pthread_key_delete(X)
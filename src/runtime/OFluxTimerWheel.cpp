@@ -0,0 +1,208 @@
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "OFluxTimerWheel.h"
+#include <time.h>
+
+namespace oflux {
+
+long long
+TimerWheel::now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+TimerWheel::TimerWheel(int tick_shift)
+	: _tick_shift(tick_shift)
+	, _tick(0)
+	, _armed(0)
+{
+	for(int level = 0; level < Levels; ++level) {
+		for(int slot = 0; slot < Slots; ++slot) {
+			_slots[level][slot] = NULL;
+		}
+	}
+	_tick = tick_of(now_ns());
+}
+
+void
+TimerWheel::link(Entry * e, int level, int slot)
+{
+	e->level = level;
+	e->slot = slot;
+	e->prev = NULL;
+	e->next = _slots[level][slot];
+	if(e->next) {
+		e->next->prev = e;
+	}
+	_slots[level][slot] = e;
+}
+
+void
+TimerWheel::unlink(Entry * e)
+{
+	if(e->prev) {
+		e->prev->next = e->next;
+	} else {
+		_slots[e->level][e->slot] = e->next;
+	}
+	if(e->next) {
+		e->next->prev = e->prev;
+	}
+	e->prev = NULL;
+	e->next = NULL;
+	e->level = -1;
+}
+
+void
+TimerWheel::place(Entry * e)
+{
+	long long t = tick_of(e->deadline);
+	if(t < _tick) {
+		t = _tick; // already due: the next slot processed
+	}
+	long long delta = t - _tick;
+	int level = 0;
+	while(level < Levels-1
+			&& delta >= (1LL << (Slot_Bits * (level+1)))) {
+		++level;
+	}
+	if(delta >= (1LL << (Slot_Bits * Levels))) {
+		// beyond the span: park it at the far end, it cascades
+		// back here until it is close enough
+		t = _tick + (1LL << (Slot_Bits * Levels)) - 1;
+	}
+	link(e, level, (int)((t >> (Slot_Bits * level)) & (Slots-1)));
+}
+
+void
+TimerWheel::arm(Entry * e, long long deadline)
+{
+	if(e->armed()) {
+		unlink(e);
+	} else {
+		if(_armed == 0) {
+			// empty wheel: catch up instead of stepping the idle ticks
+			long long t = tick_of(now_ns());
+			_tick = (t > _tick ? t : _tick);
+		}
+		++_armed;
+	}
+	e->deadline = deadline;
+	place(e);
+}
+
+void
+TimerWheel::cancel(Entry * e)
+{
+	if(e->armed()) {
+		unlink(e);
+		--_armed;
+	}
+}
+
+void
+TimerWheel::cascade()
+{
+	// _tick starts a new lap of level 0: bring the matching slot of
+	// each coarser level down (as far as the laps line up)
+	for(int level = 1; level < Levels; ++level) {
+		int slot = (int)((_tick >> (Slot_Bits * level)) & (Slots-1));
+		Entry * e = _slots[level][slot];
+		_slots[level][slot] = NULL;
+		while(e) {
+			Entry * next = e->next;
+			e->level = -1;
+			place(e);
+			e = next;
+		}
+		if(slot != 0) {
+			break;
+		}
+	}
+}
+
+void
+TimerWheel::advance(long long now, std::vector<Entry *> & fired)
+{
+	long long target = tick_of(now);
+	while(_armed > 0 && _tick <= target) {
+		int slot = (int)(_tick & (Slots-1));
+		Entry * e = _slots[0][slot];
+		while(e) {
+			Entry * next = e->next;
+			if(_tick < target || e->deadline <= now) {
+				unlink(e);
+				--_armed;
+				fired.push_back(e);
+			}
+			e = next;
+		}
+		if(_tick == target) {
+			break; // the rest of this tick is still to come
+		}
+		++_tick;
+		if((_tick & (Slots-1)) == 0) {
+			cascade();
+		}
+	}
+	if(_armed == 0 && _tick < target) {
+		// idle wheel: skip ahead (the slots are all empty)
+		_tick = target;
+	}
+}
+
+void
+TimerWheel::clear(std::vector<Entry *> & all)
+{
+	for(int level = 0; level < Levels; ++level) {
+		for(int slot = 0; slot < Slots; ++slot) {
+			while(_slots[level][slot]) {
+				Entry * e = _slots[level][slot];
+				unlink(e);
+				all.push_back(e);
+			}
+		}
+	}
+	_armed = 0;
+}
+
+long long
+TimerWheel::next_deadline() const
+{
+	if(_armed == 0) {
+		return 0;
+	}
+	for(long long t = _tick; t < ((_tick | (Slots-1)) + 1); ++t) {
+		const Entry * e = _slots[0][t & (Slots-1)];
+		if(e) {
+			long long res = e->deadline;
+			for(; e; e = e->next) {
+				if(e->deadline < res) {
+					res = e->deadline;
+				}
+			}
+			return res;
+		}
+	}
+	// nothing left in this lap of level 0: wake for the cascade
+	return ((_tick | (Slots-1)) + 1) << _tick_shift;
+}
+
+} // namespace oflux
@@ -0,0 +1,109 @@
+#ifndef OFLUX_TIMER_WHEEL_H
+#define OFLUX_TIMER_WHEEL_H
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file OFluxTimerWheel.h
+ * @author Mark Pichora
+ * Hierarchical timing wheel (Varghese and Lauck) with nanosecond
+ * deadlines on CLOCK_MONOTONIC.  Levels of Slots slots each cover
+ * Slots times the span of the level below; level 0 slots are one tick
+ * (1 << tick_shift ns) wide.  An entry is kept in the coarsest level
+ * that still tells it apart and cascades down as its time approaches.
+ * Arming and cancelling are O(1) (the Entry is the handle).  A wheel
+ * is not thread-safe: one thread owns it.
+ */
+
+#include <vector>
+#include <stddef.h>
+
+namespace oflux {
+
+class TimerWheel {
+public:
+	enum
+		{ Slot_Bits = 6
+		, Slots = 1 << Slot_Bits
+		, Levels = 4
+		, Default_Tick_Shift = 16 // 65.5 us ticks (an 18 minute span)
+		};
+	/**
+	 * @class Entry
+	 * @brief intrusive list node (embed it or derive from it)
+	 */
+	struct Entry {
+		Entry()
+			: deadline(0)
+			, prev(NULL)
+			, next(NULL)
+			, level(-1)
+			, slot(0)
+		{}
+		inline bool armed() const { return level >= 0; }
+
+		long long deadline; // ns
+		Entry * prev;
+		Entry * next;
+		int level; // -1 when not armed
+		int slot;
+	};
+
+	TimerWheel(int tick_shift = Default_Tick_Shift);
+	/**
+	 * @brief fire e once deadline (ns, see now_ns()) has passed
+	 */
+	void arm(Entry * e, long long deadline);
+	/**
+	 * @brief take e off the wheel (no-op if it is not armed)
+	 */
+	void cancel(Entry * e);
+	/**
+	 * @brief collect the entries due at now (they are disarmed)
+	 */
+	void advance(long long now, std::vector<Entry *> & fired);
+	/**
+	 * @brief disarm everything (collected in all)
+	 */
+	void clear(std::vector<Entry *> & all);
+	/**
+	 * @return when advance() should be called next (0 if nothing is
+	 * armed).  Exact for entries within Slots ticks, otherwise the
+	 * time of the next cascade.
+	 */
+	long long next_deadline() const;
+	inline size_t armed() const { return _armed; }
+	inline long long tick_ns() const { return 1LL << _tick_shift; }
+
+	static long long now_ns();
+private:
+	inline long long tick_of(long long ns) const { return ns >> _tick_shift; }
+	void place(Entry * e);
+	void link(Entry * e, int level, int slot);
+	void unlink(Entry * e);
+	void cascade();
+private:
+	int        _tick_shift;
+	long long  _tick; // next tick to process
+	size_t     _armed;
+	Entry *    _slots[Levels][Slots];
+};
+
+} // namespace oflux
+
+#endif // OFLUX_TIMER_WHEEL_H
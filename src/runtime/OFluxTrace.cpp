@@ -0,0 +1,192 @@
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "OFluxTrace.h"
+#include "OFluxTimerWheel.h"
+#include "event/OFluxEventBase.h"
+#include "flow/OFluxFlow.h"
+#include "flow/OFluxFlowNode.h"
+#include "OFluxLogging.h"
+#include <string.h>
+#include <limits.h>
+#include <algorithm>
+#include <vector>
+
+namespace oflux {
+namespace trace {
+
+volatile bool _on = false;
+
+static const char * _output = NULL;
+static int _dumps = 0; // numbers the dump files
+static Ring * volatile _rings[Max_Rings];
+static int _ring_count = 0;
+
+static __thread Ring * _ring = NULL;
+static __thread int _label = -1;
+
+const char *
+kind_name(int k)
+{
+	static const char * names[] =
+		{ "?"
+		, "push"
+		, "pop"
+		, "steal"
+		, "exec"
+		, "exec"
+		, "guard_wait"
+		};
+	return (k > 0 && k < K_num_kinds ? names[k] : names[0]);
+}
+
+int
+Ring::write(FILE * f) const
+{
+	long long end = _done;
+	lockfree::load_load_barrier();
+	long long begin = std::max(1LL, end - (long long)log_size);
+	std::vector<Record> recs;
+	recs.reserve(end - begin);
+	for(long long i = begin; i < end; ++i) {
+		const S & s = log[i % log_size];
+		if(s.index != i) {
+			continue;
+		}
+		Record r = s.d;
+		lockfree::load_load_barrier();
+		if(s.index != i) {
+			continue; // overwritten while it was copied
+		}
+		recs.push_back(r);
+	}
+	int hdr[2] = { _label, (int)recs.size() };
+	fwrite(hdr,sizeof(int),2,f);
+	if(recs.size()) {
+		fwrite(&recs[0],sizeof(Record),recs.size(),f);
+	}
+	return (int)recs.size();
+}
+
+void
+attach(int label)
+{
+	_label = label;
+}
+
+static Ring *
+new_ring()
+{
+	int i = __sync_fetch_and_add(&_ring_count,1);
+	if(i >= Max_Rings) {
+		oflux_log_warn("trace::record() no ring left for thread %d\n"
+			, _label);
+		_label = -1;
+		return NULL;
+	}
+	_ring = new Ring(_label);
+	_rings[i] = _ring;
+	return _ring;
+}
+
+void
+record(int kind, EventBase * ev, int arg)
+{
+	Ring * r = _ring;
+	if(!r) {
+		if(_label < 0 || (r = new_ring()) == NULL) {
+			return; // not a traced thread
+		}
+	}
+	flow::Node * fn = (ev ? ev->flow_node() : NULL);
+	r->add(kind, ev, (fn ? fn->id() : -1), arg, TimerWheel::now_ns());
+}
+
+void
+enable(bool on)
+{
+	_on = on;
+}
+
+void
+output(const char * filename)
+{
+	_output = filename;
+}
+
+const char *
+output()
+{
+	return _output;
+}
+
+bool
+dump(flow::Flow * flow)
+{
+	if(!_output) {
+		return false;
+	}
+	char filename[PATH_MAX];
+	snprintf(filename,sizeof(filename),"%s.%d"
+		, _output
+		, __sync_add_and_fetch(&_dumps,1));
+	FILE * f = fopen(filename,"wb");
+	if(!f) {
+		oflux_log_error("trace::dump() could not open %s\n", filename);
+		return false;
+	}
+	fwrite(OFLUX_TRACE_MAGIC,1,8,f);
+	int hdr[2] = { (int)sizeof(Record), 0 };
+	if(flow) {
+		hdr[1] = (int)flow->nodes().size();
+	}
+	fwrite(hdr,sizeof(int),2,f);
+	if(flow) {
+		std::map<std::string, flow::Node *>::iterator itr =
+			flow->nodes().begin();
+		for(; itr != flow->nodes().end(); ++itr) {
+			int nd[2] = { itr->second->id(), (int)itr->first.size() };
+			fwrite(nd,sizeof(int),2,f);
+			fwrite(itr->first.c_str(),1,nd[1],f);
+		}
+	}
+	int num_rings = std::min(_ring_count,(int)Max_Rings);
+	std::vector<Ring *> rings;
+	for(int i = 0; i < num_rings; ++i) {
+		Ring * r = _rings[i];
+		if(r) { // NULL if not published yet
+			rings.push_back(r);
+		}
+	}
+	num_rings = (int)rings.size();
+	fwrite(&num_rings,sizeof(int),1,f);
+	int num_records = 0;
+	for(int i = 0; i < num_rings; ++i) {
+		num_records += rings[i]->write(f);
+	}
+	bool ok = !ferror(f);
+	fclose(f);
+	oflux_log_info("trace::dump() %d records from %d threads to %s%s\n"
+		, num_records
+		, num_rings
+		, filename
+		, (ok ? "" : " (write failed)"));
+	return ok;
+}
+
+} // namespace trace
+} // namespace oflux
@@ -0,0 +1,134 @@
+#ifndef OFLUX_TRACE_H
+#define OFLUX_TRACE_H
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file OFluxTrace.h
+ * @author Mark Pichora
+ * Binary event trace.  Each runtime thread that attach()es gets a
+ * fixed-size ring (a RollingLog it alone writes to) of timestamped
+ * records: queue pushes, pops and steals, node executions and guard
+ * waits.  Tracing is switched with enable() (or OFLUX_CONFIG=trace=file)
+ * and costs one flag test per site when it is off.  dump() writes the
+ * rings to a new file (file.1, file.2, ...) each time, which trace2json
+ * turns into Chrome/Perfetto JSON.
+ */
+
+#include "OFluxRollingLog.h"
+#include "lockfree/OFluxMachineSpecific.h"
+#include <stdio.h>
+
+namespace oflux {
+class EventBase;
+namespace flow {
+ class Flow;
+} // namespace flow
+namespace trace {
+
+enum Kind
+	{ K_push = 1     // arg: lane
+	, K_pop          // arg: lane
+	, K_steal        // arg: victim thread
+	, K_exec_begin
+	, K_exec_end     // arg: return code
+	, K_guard_wait
+	, K_num_kinds
+	};
+
+const char * kind_name(int k);
+
+struct Record { // POD
+	long long ts; // ns (see TimerWheel::now_ns())
+	const void * ev;
+	int node; // flow::Node::id() (-1 if none)
+	short kind;
+	int arg;
+};
+
+enum { Ring_Size = 16*1024, Max_Rings = 256 };
+
+#define OFLUX_TRACE_MAGIC "OFLXTRC2" // 8 bytes leading a dump()
+
+class Ring : public RollingLog<Record,Ring_Size> {
+public:
+	Ring(int label) : _label(label), _done(1LL) {}
+	inline void add(int kind, const void * ev, int node, int arg, long long ts)
+	{
+		Record & r = submit_local();
+		r.ts = ts;
+		r.ev = ev;
+		r.node = node;
+		r.kind = kind;
+		r.arg = arg;
+		lockfree::write_barrier();
+		_done = at(); // readers take records before this
+	}
+	int label() const { return _label; }
+	/**
+	 * @brief write the records still held (oldest first), skipping any
+	 * the owner overwrites meanwhile
+	 * @return the number written
+	 */
+	int write(FILE * f) const;
+private:
+	int _label;
+	volatile long long _done;
+};
+
+extern volatile bool _on;
+
+/**
+ * @brief label the calling thread's records (its ring is allocated
+ * once it records with tracing on)
+ */
+void attach(int label);
+/**
+ * @brief record ev at this thread (a no-op for unattached threads)
+ */
+void record(int kind, EventBase * ev, int arg = 0);
+
+inline bool enabled() { return _on; }
+void enable(bool on);
+/**
+ * @brief the file name dump() numbers its files after (NULL for
+ * nowhere)
+ */
+void output(const char * filename);
+const char * output();
+/**
+ * @brief write all the rings (and the node names of flow) to output()
+ * followed by the number of the dump (from 1), so an earlier dump is
+ * not overwritten.
+ * File layout (native byte order):
+ *   Magic, int sizeof(Record), int #nodes, #nodes x (int id, int len,
+ *   char name[len]), int #rings, #rings x (int label, int #records,
+ *   Record[#records])
+ * @return false if there is no output() or it could not be written
+ */
+bool dump(flow::Flow * flow);
+
+} // namespace trace
+} // namespace oflux
+
+#define OFLUX_TRACE(K,EVB,ARG) \
+	do { if(::oflux::trace::_on) { \
+		::oflux::trace::record(::oflux::trace::K,EVB,ARG); \
+	} } while(0)
+
+#endif // OFLUX_TRACE_H
@@ -27,6 +27,7 @@
 
 #include "OFlux.h"
 #include "OFluxThreads.h"
+#include <sys/time.h>
 #ifdef OFLUX_RT_DEBUG
 # include "OFluxLogging.h"
 #endif
@@ -128,6 +129,21 @@ public:
 		}
 		--_waiter_count;
 	}
+	/**
+	 * @return false if the wait timed out (rel is relative)
+	 */
+	bool timed_wait(const struct timespec * rel)
+	{
+		bool res = true;
+		++_waiter_count;
+		if(_allow_skip_cond) {
+			_allow_skip_cond = false;
+		} else {
+			res = oflux_cond_reltimedwait(&_cond, _lck, rel) == 0;
+		}
+		--_waiter_count;
+		return res;
+	}
 	void signal()
 	{
 #ifdef OFLUX_RT_DEBUG
@@ -195,6 +211,88 @@ private:
 };
 
 
+/**
+ * @class ThreadExit
+ * @brief lets the creator of a (detached, so not joinable) thread wait a
+ * bounded time for it to finish
+ * The thread calls done() as its last use of shared state
+ * (AutoThreadExit does this even when the thread is cancelled).
+ */
+class ThreadExit {
+public:
+	ThreadExit()
+		: _running(false)
+	{
+		oflux_mutex_init(&_lck);
+		oflux_cond_init(&_cond);
+	}
+	~ThreadExit()
+	{
+		oflux_cond_destroy(&_cond);
+		oflux_mutex_destroy(&_lck);
+	}
+	void started()
+	{
+		AutoLock al(&_lck);
+		_running = true;
+	}
+	void done()
+	{
+		AutoLock al(&_lck);
+		_running = false;
+		oflux_cond_broadcast(&_cond);
+	}
+	bool running()
+	{
+		AutoLock al(&_lck);
+		return _running;
+	}
+	/**
+	 * @return true if the thread is done (within timeout_ms)
+	 */
+	bool wait(long timeout_ms)
+	{
+		AutoLock al(&_lck);
+		struct timeval start;
+		gettimeofday(&start,NULL);
+		while(_running) {
+			struct timeval now;
+			gettimeofday(&now,NULL);
+			long left = timeout_ms
+				- (now.tv_sec - start.tv_sec) * 1000L
+				- (now.tv_usec - start.tv_usec) / 1000L;
+			if(left <= 0) {
+				return false;
+			}
+			struct timespec rel;
+			rel.tv_sec = left / 1000L;
+			rel.tv_nsec = (left % 1000L) * 1000000L;
+			oflux_cond_reltimedwait(&_cond,&_lck,&rel);
+		}
+		return true;
+	}
+private:
+	oflux_mutex_t _lck;
+	oflux_cond_t  _cond;
+	bool          _running;
+};
+
+/**
+ * @class AutoThreadExit
+ * @brief RAII call ThreadExit::done() when the thread function returns
+ * (or is unwound by cancellation)
+ */
+class AutoThreadExit {
+public:
+	AutoThreadExit(ThreadExit & te)
+		: _te(te)
+	{}
+	~AutoThreadExit() { _te.done(); }
+private:
+	ThreadExit & _te;
+};
+
+
 /**
  * @class ThreadLocalDataKey
  * @brief a container for a thread local data key
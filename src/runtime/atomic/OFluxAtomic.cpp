@@ -68,6 +68,24 @@ AtomicMapAbstract::log_snapshot(const char * guardname)
 	delete w;
 }
 
+void
+AtomicMapAbstract::counts(AtomicMapCounts & c)
+{
+	AtomicMapWalker * w = walker();
+	const void * k = NULL;
+	Atomic * a = NULL;
+	while(w->next(k,a)) {
+		++c.keys;
+		c.held += (a->held() ? 1 : 0);
+		if(a->waiter_count_safe()) {
+			c.waiters += a->waiter_count();
+		} else {
+			c.waiters_counted = false;
+		}
+	}
+	delete w;
+}
+
 void
 AtomicCommon::log_snapshot_waiters() const
 {
@@ -26,8 +26,11 @@
  */
 
 
+#include <algorithm>
 #include <deque>
 #include <map>
+#include <new>
+#include <stdint.h>
 
 #ifdef Darwin
 #include <boost/tr1/tr1/unordered_map>
@@ -38,6 +41,7 @@
 #include "OFlux.h"
 #include "event/OFluxEventBase.h"
 #include "OFluxLogging.h"
+#include "OFluxWrappers.h"
 
 namespace oflux {
 
@@ -90,6 +94,11 @@ public:
 	* @return the number of events in the waiting list
 	*/
 	virtual size_t waiter_count() = 0;
+	/**
+	* @return false if waiter_count() walks a list that only threads
+	*   holding a hazard pointer may (so not a metrics thread)
+	*/
+	virtual bool waiter_count_safe() const { return true; }
 
 	virtual bool has_no_waiters() { return waiter_count() == 0; }
 
@@ -308,6 +317,22 @@ private:
 };
 ****/
 
+/**
+ * @brief tallies over the atomics of an AtomicMapAbstract
+ */
+struct AtomicMapCounts {
+	AtomicMapCounts()
+		: keys(0)
+		, held(0)
+		, waiters(0)
+		, waiters_counted(true)
+	{}
+	size_t keys;
+	size_t held;    // atomics held (by at least one event)
+	size_t waiters; // events queued on them
+	bool waiters_counted; // false if some could not be (safely)
+};
+
 /**
  * @class AtomicMapAbstract
  * @brief Abstract class for an AtomicMap - which holds the key/Atomic relation
@@ -338,12 +363,30 @@ public:
 	 * @brief deallocate a key
 	 */
 	virtual void delete_key(void *) const = 0;
+	/**
+	 * @brief size of a key built with construct_key()
+	 * @return 0 if keys can only come from new_key()
+	 */
+	virtual size_t key_size() const { return 0; }
+	/**
+	 * @brief construct a new key in caller storage (no allocation)
+	 * @param buf is key_size() bytes suitably aligned for any type
+	 */
+	virtual void * construct_key(void * buf) const { return buf; }
+	/**
+	 * @brief destroy a key made by construct_key() (no deallocation)
+	 */
+	virtual void destroy_key(void *) const {}
 	/**
 	 * @brief get a walker for this map
 	 */
 	virtual AtomicMapWalker * walker() = 0;
 
 	virtual void log_snapshot(const char * guardname);
+	/**
+	 * @brief walk the map and add up its atomics' states
+	 */
+	void counts(AtomicMapCounts & c);
 
 	virtual bool garbage_collect(const void *, Atomic *) { return false; } 
 		// no gc by default
@@ -607,6 +650,15 @@ public:
 	{ return new typename MapPolicy::keytype(); }
 	virtual void delete_key(void * k) const
         { delete (reinterpret_cast<const typename MapPolicy::keytype *>(k)); }
+	virtual size_t key_size() const
+	{ return sizeof(typename MapPolicy::keytype); }
+	virtual void * construct_key(void * buf) const
+	{ return new (buf) typename MapPolicy::keytype(); }
+	virtual void destroy_key(void * k) const
+	{
+		typedef typename MapPolicy::keytype keytype;
+		reinterpret_cast<keytype *>(k)->~keytype();
+	}
 	virtual AtomicMapWalker * walker() 
         { return new AtomicMapStdWalker<MapPolicy>(_map); }
 	virtual bool garbage_collect(const void * key, Atomic * a)
@@ -632,6 +684,294 @@ private:
 	typename MapPolicy::maptype _map;
 };
 
+/**
+ * @class AtomicMapSharded
+ * @brief open-addressing atom map split into Shards by key hash
+ * Each entry holds its key and atomic inline.  Entries live in
+ * fixed-size chunks which are never moved (the runtime keeps pointers
+ * to both), so a shard only rebuilds its small probe index when it
+ * grows.  Garbage collected entries are recycled through a free list.
+ * walker() visits keys in operator< order when Ordered.
+ * (flux: exclusive/sharded G(...) => ...; add /unordered to skip the sort)
+ * It pays off over the std maps for guards with many live keys or much
+ * key churn: no allocation per key, and a lookup touches one short
+ * probe run instead of a tree path.  Like the other maps it relies on
+ * the runtime to serialize get() and garbage_collect() (the runtimes
+ * that use these maps do so under their manager lock), so the shard
+ * locks are only taken when Locked (for a map used outside of that).
+ */
+template< typename K
+	, typename A=AtomicExclusive
+	, bool Ordered=true
+	, size_t Shards=16
+	, bool Locked=false >
+class AtomicMapSharded : public AtomicMapAbstract {
+public:
+	enum { Chunk_Entries = 256, Initial_Cells = 64 };
+
+	AtomicMapSharded() {}
+	virtual ~AtomicMapSharded() {}
+	virtual const void * get(Atomic * & atomic, const void * key)
+	{
+		const K * k = reinterpret_cast<const K *>(key);
+		size_t h = mix(*k);
+		Shard & s = _shards[shard_index(h)];
+		ShardLock sl(s);
+		Entry * e = s.find(*k,h);
+		if(!e) {
+			e = s.insert(*k,h);
+		}
+		atomic = &(e->atomic);
+		return reinterpret_cast<const void *>(&(e->key));
+	}
+	virtual int compare(const void * v_k1, const void * v_k2) const
+	{ return k_compare<K>(v_k1,v_k2); }
+	virtual void * new_key() const { return new K(); }
+	virtual void delete_key(void * k) const
+	{ delete (reinterpret_cast<const K *>(k)); }
+	virtual size_t key_size() const { return sizeof(K); }
+	virtual void * construct_key(void * buf) const { return new (buf) K(); }
+	virtual void destroy_key(void * k) const
+	{ reinterpret_cast<K *>(k)->~K(); }
+	virtual AtomicMapWalker * walker();
+	virtual bool garbage_collect(const void * key, Atomic * a)
+	{
+		const K * k = reinterpret_cast<const K *>(key);
+		size_t h = mix(*k);
+		Shard & s = _shards[shard_index(h)];
+		ShardLock sl(s);
+		Entry * e = s.find(*k,h);
+		if(e) {
+			assert((&(e->atomic) == a)
+				&& "garbage_collect detected that atom object "
+				   "does not match what is in the map");
+			assert((&(e->key) == k)
+				&& "garbage_collect detected that key object "
+				   "does not match what is in the map");
+			s.erase(e);
+			return true;
+		}
+		return false;
+	}
+private:
+	struct Entry {
+		Entry(const K & k, size_t h)
+			: key(k)
+			, atomic(NULL)
+			, hash(h)
+			{}
+		K key;
+		A atomic;
+		size_t hash;
+	};
+	struct Cell {
+		size_t hash;
+		Entry * entry; // NULL: empty, tombstone(): erased
+	};
+	static inline Entry * tombstone()
+	{ return reinterpret_cast<Entry *>(1); }
+	static inline size_t mix(const K & k)
+	{
+		// spread weak hashes (tr1::hash<int> is the identity)
+		uint64_t h = hash<K>()(k);
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return static_cast<size_t>(h);
+	}
+	static inline size_t shard_index(size_t h)
+	{ return (h >> 16) % Shards; }
+
+	struct Shard {
+		Shard()
+			: cells(new Cell[Initial_Cells])
+			, capacity(Initial_Cells)
+			, live(0)
+			, used(0)
+			, chunk_fill(Chunk_Entries)
+			, free_list(NULL)
+		{
+			oflux_mutex_init(&lck);
+			clear_cells(cells,capacity);
+		}
+		~Shard()
+		{
+			for(size_t i = 0; i < capacity; ++i) {
+				if(cells[i].entry > tombstone()) {
+					cells[i].entry->~Entry();
+				}
+			}
+			for(size_t i = 0; i < chunks.size(); ++i) {
+				::operator delete(chunks[i]);
+			}
+			delete [] cells;
+			oflux_mutex_destroy(&lck);
+		}
+		static void clear_cells(Cell * cs, size_t n)
+		{
+			for(size_t i = 0; i < n; ++i) {
+				cs[i].hash = 0;
+				cs[i].entry = NULL;
+			}
+		}
+		Entry * find(const K & k, size_t h) const
+		{
+			size_t mask = capacity-1;
+			for(size_t i = h & mask; cells[i].entry; i = (i+1) & mask) {
+				if(cells[i].hash == h
+						&& cells[i].entry != tombstone()
+						&& cells[i].entry->key == k) {
+					return cells[i].entry;
+				}
+			}
+			return NULL;
+		}
+		void place(Cell * cs, size_t cap, Entry * e)
+		{
+			size_t mask = cap-1;
+			size_t i = e->hash & mask;
+			while(cs[i].entry > tombstone()) {
+				i = (i+1) & mask;
+			}
+			if(cs[i].entry == NULL) {
+				++used;
+			}
+			cs[i].hash = e->hash;
+			cs[i].entry = e;
+		}
+		void rebuild(size_t new_capacity)
+		{
+			Cell * old_cells = cells;
+			size_t old_capacity = capacity;
+			cells = new Cell[new_capacity];
+			capacity = new_capacity;
+			clear_cells(cells,capacity);
+			used = 0;
+			for(size_t i = 0; i < old_capacity; ++i) {
+				if(old_cells[i].entry > tombstone()) {
+					place(cells,capacity,old_cells[i].entry);
+				}
+			}
+			delete [] old_cells;
+		}
+		void * allocate()
+		{
+			if(free_list) {
+				void * res = free_list;
+				free_list = *reinterpret_cast<void **>(free_list);
+				return res;
+			}
+			if(chunk_fill == Chunk_Entries) {
+				chunks.push_back(::operator new(
+					sizeof(Entry) * Chunk_Entries));
+				chunk_fill = 0;
+			}
+			return reinterpret_cast<Entry *>(chunks.back())
+				+ (chunk_fill++);
+		}
+		Entry * insert(const K & k, size_t h)
+		{
+			if((used+1)*4 > capacity*3) { // keep load under 3/4
+				rebuild((live+1)*2 > capacity
+					? capacity*2
+					: capacity);
+			}
+			Entry * e = new (allocate()) Entry(k,h);
+			place(cells,capacity,e);
+			++live;
+			return e;
+		}
+		void erase(Entry * e)
+		{
+			size_t mask = capacity-1;
+			size_t i = e->hash & mask;
+			while(cells[i].entry != e) {
+				i = (i+1) & mask;
+			}
+			cells[i].entry = tombstone();
+			--live;
+			e->~Entry();
+			*reinterpret_cast<void **>(e) = free_list;
+			free_list = e;
+		}
+
+		oflux_mutex_t lck;
+		Cell * cells;
+		size_t capacity; // power of 2
+		size_t live;     // entries in the map
+		size_t used;     // cells not empty (live + tombstones)
+		size_t chunk_fill;
+		void * free_list;
+		std::vector<void *> chunks;
+	private:
+		Shard(const Shard &); // not implemented
+		Shard & operator=(const Shard &); // not implemented
+	};
+
+	class ShardLock {
+	public:
+		ShardLock(Shard & s)
+			: _lck(Locked ? &s.lck : NULL)
+		{ if(_lck) oflux_mutex_lock(_lck); }
+		~ShardLock()
+		{ if(_lck) oflux_mutex_unlock(_lck); }
+	private:
+		oflux_mutex_t * _lck;
+	};
+
+	class Walker : public AtomicMapWalker {
+	public:
+		typedef std::pair<const K *, Atomic *> pairtype;
+
+		Walker(Shard * shards)
+			: _at(0)
+		{
+			for(size_t si = 0; si < Shards; ++si) {
+				Shard & s = shards[si];
+				ShardLock sl(s);
+				for(size_t i = 0; i < s.capacity; ++i) {
+					Entry * e = s.cells[i].entry;
+					if(e > tombstone()) {
+						_snapshot.push_back(
+							pairtype(&(e->key),&(e->atomic)));
+					}
+				}
+			}
+			if(Ordered) {
+				std::sort(_snapshot.begin(),_snapshot.end(),less);
+			}
+		}
+		virtual ~Walker() {}
+		virtual bool next(const void * & key,Atomic * &atom)
+		{
+			bool res = _at < _snapshot.size();
+			if(res) {
+				key = _snapshot[_at].first;
+				atom = _snapshot[_at].second;
+				++_at;
+			}
+			return res;
+		}
+	private:
+		static bool less(const pairtype & p1, const pairtype & p2)
+		{ return *(p1.first) < *(p2.first); }
+
+		std::vector<pairtype> _snapshot;
+		size_t _at;
+	};
+private:
+	Shard _shards[Shards];
+};
+
+template<typename K, typename A, bool Ordered, size_t Shards, bool Locked>
+AtomicMapWalker *
+AtomicMapSharded<K,A,Ordered,Shards,Locked>::walker()
+{
+	return new Walker(_shards);
+}
+
 } // namespace atomic
 } // namespace oflux
 
@@ -176,6 +176,10 @@ AtomicsHolder::acquire_all_or_wait(
 	PUBLIC_NODE_ACQUIREGUARDS(
 		  ev_bptr
 		, ev_name);
+	if(_number > 0 && !ev_bptr->guard_wait_since()) {
+		// stamped now: ev is not ours after a failed acquire
+		ev_bptr->guard_wait_since(CycleClock::now());
+	}
 	const void * node_in = ev_bptr->input_type();
 	if(!_is_sorted_and_keyed) {
 		get_keys_sort(node_in);
@@ -273,6 +277,14 @@ AtomicsHolder::acquire_all_or_wait(
 		PUBLIC_NODE_HAVEALLGUARDS(
 			  static_cast<void *>(ev_bptr)
 			, ev_name);
+		unsigned long long since = ev_bptr->guard_wait_since();
+		if(since) {
+			unsigned long long now = CycleClock::now();
+			latency::record(ev_bptr->flow_node()->id()
+				, latency::M_guard_wait
+				, (now > since ? now - since : 0));
+			ev_bptr->guard_wait_since(0);
+		}
 	}
 	oflux_log_trace2("[" PTHREAD_PRINTF_FORMAT "] AH::aaow: return %d\n"
 		, oflux_self()
@@ -3,7 +3,7 @@ $(info Reading contents.mk $(COMPONENT_DIR))
 OFLUX_LIB_COMPONENT_DIR:=$(COMPONENT_DIR)
 
 LIBRARIES += liboflux.so libofshim.so
-APPS += exercise
+APPS += exercise trace2json
 
 OFLUX_SHIMOBJS := OFluxRunTimeAbstractForShim.pic.o OFluxIOShim.pic.o
 
@@ -14,6 +14,11 @@ OFLUX_LF_SRC := \
   OFluxLockfreeRunTime.cpp \
   OFluxThreadNumber.cpp \
   OFluxLockfreeRunTimeThread.cpp \
+  OFluxEventCount.cpp \
+  OFluxLockfreeOffload.cpp \
+  OFluxLockfreeReactor.cpp \
+  OFluxLockfreeVictims.cpp \
+  OFluxLockfreeTimers.cpp \
   OFluxLFAtomic.cpp \
   OFluxLFAtomicReadWrite.cpp \
   OFluxLFAtomicPooled.cpp \
@@ -27,13 +32,20 @@ OFLUX_OBJS = \
         OFluxExceptionsDTrace.o \
         OFluxLogging.o \
         OFluxProfiling.o \
+        OFluxAffinity.o \
+        OFluxTimerWheel.o \
+        OFluxTrace.o \
+        OFluxLatency.o \
+        OFluxMetrics.o \
         OFluxQueue.o \
         OFluxOrderable.o \
         OFluxFlow.o \
         OFluxFlowNode.o \
         OFluxFlowNodeIncr.o \
+        OFluxFlowNodePool.o \
         OFluxFlowCase.o \
         OFluxFlowGuard.o \
+        OFluxFlowAdmission.o \
         OFluxFlowFunctions.o \
         OFluxFlowExerciseFunctions.o \
         OFluxFlowLibrary.o \
@@ -50,6 +62,7 @@ OFLUX_OBJS = \
         OFluxRunTime.o \
         OFluxDoor.o \
         OFluxMeldingRunTime.o \
+        OFluxMultiQueueRunTime.o \
 	$(OFLUX_LF_OBJS) \
         OFluxXML.o \
         OFluxStats.o \
@@ -92,7 +105,7 @@ $(DTRACE_SHIM_PROBE_HEADER): ofluxshimprobe.d
 ifeq ($(_ARCH),SunOS)
 OFLUXRTLIBS= -lposix4 -lexpat -lm -lc -lpthread
 else ifeq ($(_ARCH),Linux)
-OFLUXRTLIBS= -lexpat
+OFLUXRTLIBS= -lexpat $(if $(LIBURING),-luring,)
 else ifeq ($(_ARCH),Darwin)
 OFLUXRTLIBS= -lexpat -lm -lc -lpthread
 endif
@@ -132,6 +145,9 @@ exercise : LIBS += $(UMEMLIB)
 
 oflux_exercise.o: $(OFLUXPROBEHEADER)
 
+trace2json : oflux_trace2json.o liboflux.so
+	$(CXX) $(CXXOPTS) $(CXXFLAGS) $(INCS) $(LIBDIRS) $^ $(LIBS) -o $@
+
 OFLUX_DOCUMENTATION += doc/runtime
 
 doc/runtime: oflux.dox $(OFLUX_OBJS) oflux_vers.cpp
@@ -32,6 +32,7 @@
 #include "OFluxIOConversion.h"
 #include "flow/OFluxFlowNode.h"
 #include "flow/OFluxFlowFunctions.h"
+#include "OFluxAllocator.h"
 
 #include "OFluxLogging.h"
 
@@ -133,7 +134,9 @@ public:
 	virtual int execute()
 	{ 
 		EventBaseTyped<Detail>::atomics_argument()->fill(&(this->atomics()));
-		EventBase::flow_node()->_executions++;
+		if(EventBase::start_run()) {
+			EventBase::flow_node()->_executions++;
+		}
 		const char * ev_name __attribute__((unused)) = 
 			EventBase::flow_node()->getName();
 		PUBLIC_NODE_START(
@@ -141,11 +144,15 @@ public:
 			, ev_name
 			, EventBase::flow_node()->getIsSource()
 			, EventBase::flow_node()->getIsDetached());
+		int node_id = EventBase::flow_node()->id();
+		unsigned long long started = EventBase::latency_start(node_id);
 		int res = (*Detail::nfunc)(
 			  EventBaseTyped<Detail>::pr_input_type()
 			, EventBaseTyped<Detail>::pr_output_type()
 			, EventBaseTyped<Detail>::atomics_argument()); 
-		if (!res) EventBase::release();
+		EventBase::latency_done(node_id,started);
+		if (!res && !EventBase::waiting()) EventBase::release();
+		if (!EventBase::waiting()) EventBase::done_in_flight();
 		PUBLIC_NODE_DONE(this,ev_name);
 		return res;
 	}
@@ -171,7 +178,9 @@ public:
 	virtual int execute()
 	{ 
 		EventBaseTyped<Detail>::atomics_argument()->fill(&(this->atomics()));
-		EventBase::flow_node()->_executions++;
+		if(EventBase::start_run()) {
+			EventBase::flow_node()->_executions++;
+		}
 		const char * ev_name __attribute__((unused)) = 
 			EventBase::flow_node()->getName();
 		PUBLIC_NODE_START(
@@ -179,12 +188,16 @@ public:
 			, ev_name
 			, EventBase::flow_node()->getIsSource()
 			, EventBase::flow_node()->getIsDetached());
+		int node_id = EventBase::flow_node()->id();
+		unsigned long long started = EventBase::latency_start(node_id);
 		int res = (*Detail::nfunc)(
 			  &_error_im
 			, convert<typename Detail::Out_>(EventBaseTyped<Detail>::pr_output_type())
 			, EventBaseTyped<Detail>::atomics_argument()
 			, EventBase::error_code()); 
-		if (!res) EventBase::release();
+		EventBase::latency_done(node_id,started);
+		if (!res && !EventBase::waiting()) EventBase::release();
+		if (!EventBase::waiting()) EventBase::done_in_flight();
 		PUBLIC_NODE_DONE(this,EventBase::flow_node()->getName());
 		return res;
 	}
@@ -203,7 +216,7 @@ typename Detail::In_ ErrorEvent<Detail>::_dont_care_im;
  * @param fn  flow node
  * @param im_io_convert  a converter for the input to this event
  *
- * @return smart pointer to the new event (heap allocated)
+ * @return smart pointer to the new event (from the node's event pool)
  **/
 template< typename Detail >
 EventBasePtr
@@ -211,10 +224,17 @@ create(   EventBaseSharedPtr pred_node_ptr
 	, const void * im_io_convert
 	, flow::Node *fn)
 {
-	return mk_EventBasePtr(new Event<Detail>(
+	typedef const IOConversionBase<typename Detail::In_> * IOConvPtr;
+	Allocator<Event<Detail> > allocator(
+		fn->event_pool().sized(sizeof(Event<Detail>)));
+	Event<Detail> * ev = allocator.template get<
+		  EventBaseSharedPtr &
+		, IOConvPtr
+		, flow::Node *>(
 		  pred_node_ptr
-		, reinterpret_cast<const IOConversionBase<typename Detail::In_> *>(im_io_convert)
-		, fn));
+		, reinterpret_cast<IOConvPtr>(im_io_convert)
+		, fn);
+	return mk_EventBasePtr(ev);
 }
 
 /**
@@ -224,7 +244,7 @@ create(   EventBaseSharedPtr pred_node_ptr
  * @param fn  flow node
  * @param im_io_convert  a converter for the input to this event
  *
- * @return smart pointer to the new error event (heap allocated)
+ * @return smart pointer to the new error event (from the node's event pool)
  **/
 template< typename Detail >
 EventBasePtr 
@@ -233,10 +253,17 @@ create_error(
 	, const void * im_io_convert
 	, flow::Node * fn)
 {
-	return mk_EventBasePtr(new ErrorEvent<Detail>(
+	typedef const IOConversionBase<typename Detail::In_> * IOConvPtr;
+	Allocator<ErrorEvent<Detail> > allocator(
+		fn->event_pool().sized(sizeof(ErrorEvent<Detail>)));
+	ErrorEvent<Detail> * ev = allocator.template get<
+		  EventBaseSharedPtr &
+		, IOConvPtr
+		, flow::Node *>(
 		  pred_node_ptr
-		, reinterpret_cast<const IOConversionBase<typename Detail::In_> *>(im_io_convert)
-		, fn));
+		, reinterpret_cast<IOConvPtr>(im_io_convert)
+		, fn);
+	return mk_EventBasePtr(ev);
 }
 
 
@@ -17,6 +17,7 @@
  */
 #include "event/OFluxEventBase.h"
 #include "flow/OFluxFlowNode.h"
+#include "flow/OFluxFlowNodePool.h"
 #include "OFluxLogging.h"
 #include "OFluxLibDTrace.h"
 #include "atomic/OFluxAtomicHolder.h"
@@ -54,6 +55,15 @@ EventBase::EventBase( EventBaseSharedPtr & predecessor
 		, atomic::AtomicsHolder & atomics)
 	: flow::NodeCounterIncrementer(flow_node)
 	, _predecessor(predecessor)
+	, _ref_count(0)
+	, _wait_fd(-1)
+	, _wait_events(0)
+	, _wait_deadline(0)
+	, _runs(0)
+	, _exec_ticks(0)
+	, _not_before(0)
+	, _queued_at(CycleClock::now())
+	, _guard_wait_since(0)
 	, _error_code(0)
 	, _atomics_ref(atomics)
 	, state(0)
@@ -66,6 +76,18 @@ EventBase::~EventBase()
 	PUBLIC_EVENT_DEATH(this,flow_node()->getName());
 }
 
+void *
+EventBase::operator new(size_t sz)
+{
+	return flow::NodeEventPool::heap_get(sz);
+}
+
+void
+EventBase::operator delete(void * p)
+{
+	flow::NodeEventPool::release(p);
+}
+
 
 bool
 EventBase::getIsDetached()
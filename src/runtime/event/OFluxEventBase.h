@@ -29,7 +29,10 @@
 
 #include "OFlux.h"
 #include "flow/OFluxFlowNodeIncr.h"
+#include "OFluxLatency.h"
+#include "OFluxTimerWheel.h"
 #include <vector>
+#include <cstddef>
 
 
 namespace oflux {
@@ -58,6 +61,14 @@ public:
 			, flow::Node *flow_node
 			, atomic::AtomicsHolder & atomics);
 	virtual ~EventBase();
+	/**
+	 * @brief event memory carries a small header naming the flow node
+	 *   pool it came from (see flow::NodeEventPool)
+	 */
+	static void * operator new(size_t sz);
+	static void * operator new(size_t, void * p) { return p; }
+	static void operator delete(void * p);
+	static void operator delete(void *, void *) {}
 	virtual OutputWalker output_type() = 0;
 	virtual const void * input_type() = 0;
 	void release() { _predecessor = no_event; }
@@ -74,8 +85,98 @@ public:
 	inline EventBaseSharedPtr & get_predecessor()
 	{ return _predecessor; }
 	bool getIsDetached();
+	/**
+	 * @brief ask to be suspended until fd is ready (lock-free reactor)
+	 * The predecessor (and so the input) is kept for the re-run.
+	 */
+	inline void wait_on(int fd, int events)
+	{ _wait_fd = fd; _wait_events = events; }
+	/**
+	 * @brief ask to be suspended until deadline (ns on CLOCK_MONOTONIC)
+	 */
+	inline void wait_until(long long deadline) { _wait_deadline = deadline; }
+	inline bool waiting() const { return _wait_fd >= 0 || _wait_deadline > 0; }
+	inline int wait_fd() const { return _wait_fd; }
+	inline int wait_events() const { return _wait_events; }
+	inline long long wait_deadline() const { return _wait_deadline; }
+	inline void clear_wait() 
+	{ _wait_fd = -1; _wait_events = 0; _wait_deadline = 0; }
+	/**
+	 * @brief note that execute() has been entered
+	 * @return true on the first run (not when resumed after a wait)
+	 */
+	inline bool start_run() { return _runs++ == 0; }
+	/**
+	 * @brief a timed source launch: not to be run (or to acquire its
+	 * guards) before this time (0 when it may run now)
+	 */
+	inline long long not_before() const { return _not_before; }
+	inline void not_before(long long t) { _not_before = t; }
+	/**
+	 * @class TimerEntry
+	 * @brief the event's handle on a TimerWheel: it holds the event
+	 * while armed (so arming allocates nothing)
+	 */
+	struct TimerEntry : public TimerWheel::Entry {
+		TimerEntry() : owner(NULL) {}
+		EventBasePtr ev;
+		const void * owner; // who armed it (while armed)
+	};
+	inline TimerEntry & timer_entry() { return _timer_entry; }
+	/**
+	 * @brief CycleClock stamps for the latency histograms: when the
+	 * event started waiting to run (0 once it has started) and when
+	 * it started waiting on its guards (0 when it is not)
+	 */
+	inline unsigned long long queued_at() const { return _queued_at; }
+	inline void queued_at(unsigned long long t) { _queued_at = t; }
+	inline unsigned long long guard_wait_since() const
+	{ return _guard_wait_since; }
+	inline void guard_wait_since(unsigned long long t)
+	{ _guard_wait_since = t; }
+	/**
+	 * @brief record the queue wait (on the first run only) as the node
+	 * starts
+	 * @return the start stamp to hand to latency_done()
+	 */
+	inline unsigned long long latency_start(int node_id)
+	{
+		unsigned long long now = CycleClock::now();
+		if(_queued_at) {
+			latency::record(node_id, latency::M_queue_wait
+				, (now > _queued_at ? now - _queued_at : 0));
+			_queued_at = 0;
+		}
+		return now;
+	}
+	/**
+	 * @brief add this run to the execution time, which is recorded
+	 * once the event is done (not each time a suspended one resumes)
+	 */
+	inline void latency_done(int node_id, unsigned long long started)
+	{
+		unsigned long long now = CycleClock::now();
+		_exec_ticks += (now > started ? now - started : 0);
+		if(!waiting()) {
+			latency::record(node_id, latency::M_exec, _exec_ticks);
+			_exec_ticks = 0;
+		}
+	}
+	friend void intrusive_ptr_add_ref(EventBase *);
+	friend int intrusive_ptr_release(EventBase *);
+	friend int intrusive_ptr_use_count(const EventBase *);
 private:
 	EventBaseSharedPtr _predecessor;
+	int _ref_count; // EventBaseSharedPtr references
+	int _wait_fd; // >= 0 when suspended on an fd
+	int _wait_events;
+	long long _wait_deadline; // > 0 when suspended until a time
+	unsigned int _runs; // times execute() was entered
+	unsigned long long _exec_ticks; // over the runs so far
+	long long _not_before;
+	TimerEntry _timer_entry;
+	unsigned long long _queued_at;
+	unsigned long long _guard_wait_since;
 protected:
 	int _error_code;
 	atomic::AtomicsHolder & _atomics_ref;
@@ -83,6 +184,27 @@ public:
 	int state;
 };
 
+/**
+ * @brief reference counting hooks for EventBaseSharedPtr (intrusive_ptr)
+ */
+inline void 
+intrusive_ptr_add_ref(EventBase * ev)
+{
+	__sync_fetch_and_add(&(ev->_ref_count),1);
+}
+
+inline int 
+intrusive_ptr_release(EventBase * ev)
+{
+	return __sync_add_and_fetch(&(ev->_ref_count),-1);
+}
+
+inline int 
+intrusive_ptr_use_count(const EventBase * ev)
+{
+	return ev->_ref_count;
+}
+
 
 } // namespace oflux
 
@@ -22,6 +22,8 @@
 #include "flow/OFluxFlowNode.h"
 #include "flow/OFluxFlow.h"
 #include "atomic/OFluxAtomicHolder.h"
+#include "OFluxTimerWheel.h"
+#include "OFluxTrace.h"
 #include "OFluxLogging.h"
 
 
@@ -41,6 +43,7 @@ __acquire_guards(
 		  ev
 		, pred_ev);
 	if(!res) {
+		OFLUX_TRACE(K_guard_wait,evb,0);
 		oflux_log_trace2("[%d] event::acquire_guards() failure for "
 			"%s %p on guards acquisition\n"
 			, oflux_self()
@@ -50,6 +53,55 @@ __acquire_guards(
 	return res;
 }
 
+static inline bool
+__admit_source(flow::Node * fn)
+{
+	flow::Admission * adm = fn->admission();
+	return adm == NULL || adm->admit(fn);
+}
+
+static void
+__resume_sources(
+	  std::vector<EventBasePtr> & successor_events
+	, flow::Node * done_fn)
+{
+	// done_fn's event finished: parked sources may be let go
+	flow::Admission * adm = done_fn->admission();
+	if(adm == NULL || !adm->has_parked()) {
+		return;
+	}
+	std::vector<flow::Node *> srcs;
+	adm->resume(srcs);
+	for(size_t i = 0; i < srcs.size(); ++i) {
+		flow::Node * fn = srcs[i];
+		if(!fn->getIsSource()) {
+			continue; // turned off by a flow reload
+		}
+		CreateNodeFn createfn = fn->getCreateFn();
+		EventBasePtr ev_src = 
+			(*createfn)(EventBase::no_event_shared,NULL,fn);
+		ev_src->error_code(0);
+		if(event::__acquire_guards(ev_src)) {
+			successor_events.push_back(ev_src);
+		}
+	}
+}
+
+static inline bool
+__delay_source(
+	  std::vector<EventBasePtr> * delayed
+	, EventBasePtr & ev_src)
+{
+	// a timed source waits for its period before taking its guards
+	flow::Node * fn = ev_src->flow_node();
+	if(delayed == NULL || fn->period_ns() <= 0) {
+		return false;
+	}
+	ev_src->not_before(fn->next_due(TimerWheel::now_ns()));
+	delayed->push_back(ev_src);
+	return true;
+}
+
 int
 acquire_guards(
 	  EventBasePtr & ev
@@ -61,10 +113,11 @@ acquire_guards(
 void
 successors_on_no_error(
 	  std::vector<EventBasePtr> & successor_events
-	, EventBaseSharedPtr & ev)
+	, EventBaseSharedPtr & ev
+	, std::vector<EventBasePtr> * delayed)
 {
 	enum { return_code = 0 };
-	std::vector<flow::Case *> fsuccessors;
+	std::vector<const flow::SuccessorRecord *> fsuccessors;
 	OutputWalker ev_ow = ev->output_type();
 	void * ev_output = NULL;
 	bool saw_source = false;
@@ -84,6 +137,9 @@ successors_on_no_error(
 				// even with splaying
 			}
 			saw_source = saw_source || is_source;
+			if(is_source && !__admit_source(fn)) {
+				continue; // parked: downstream is saturated
+			}
 			CreateNodeFn createfn = fn->getCreateFn();
 			EventBasePtr ev_succ = 
 				( is_source
@@ -91,6 +147,9 @@ successors_on_no_error(
 				: (*createfn)(ev,iocon->convert(ev_output),fn)
 				);
 			ev_succ->error_code(0);
+			if(is_source && __delay_source(delayed,ev_succ)) {
+				continue;
+			}
 			EventBasePtr from_ev =
 				is_source 
 				? EventBase::no_event 
@@ -101,15 +160,17 @@ successors_on_no_error(
 			}
 		}
 	}
+	__resume_sources(successor_events,ev->flow_node());
 }
 
 void
 successors_on_error(
 	  std::vector<EventBasePtr> & successor_events
 	, EventBaseSharedPtr & ev
-	, int return_code)
+	, int return_code
+	, std::vector<EventBasePtr> * delayed)
 {
-	std::vector<flow::Case *> fsuccessors;
+	std::vector<const flow::SuccessorRecord *> fsuccessors;
 	void * ev_output = ev->output_type().next();
 	ev->flow_node()->get_successors(fsuccessors, 
 			ev_output, return_code);
@@ -118,16 +179,24 @@ successors_on_error(
 		flow::IOConverter * iocon = fsuccessors[i]->ioConverter();
 		CreateNodeFn createfn = fn->getCreateFn();
 		bool was_source = ev->flow_node()->getIsSource();
+		if(was_source && fn == ev->flow_node() && !__admit_source(fn)) {
+			continue; // re-launch parked: downstream is saturated
+		}
 		EventBasePtr ev_succ = 
 			( was_source
 			? (*createfn)(EventBase::no_event_shared,NULL,fn)
 			: (*createfn)(ev->get_predecessor(),iocon->convert(ev->input_type()),fn));
 		ev_succ->error_code(return_code);
+		if(was_source && fn == ev->flow_node()
+				&& __delay_source(delayed,ev_succ)) {
+			continue;
+		}
 		EventBasePtr from_ev = get_EventBaseSharedPtr(ev);
 		if(event::__acquire_guards(ev_succ,from_ev)) {
 			successor_events.push_back(ev_succ);
 		}
 	}
+	__resume_sources(successor_events,ev->flow_node());
 }
 
 void
@@ -172,5 +241,21 @@ push_initials_and_sources(
 	}
 }
 
+void
+drop_unrun(std::vector<EventBaseSharedPtr> & evs)
+{
+	std::vector<EventBasePtr> released;
+	while(!evs.empty()) {
+		EventBaseSharedPtr ev = evs.back(); // freed with the last ref
+		evs.pop_back();
+		EventBasePtr evb = get_EventBaseSharedPtr(ev);
+		released.clear();
+		ev->atomics().release(released,evb);
+		for(size_t i = 0; i < released.size(); ++i) {
+			evs.push_back(mk_EventBaseSharedPtr(released[i]));
+		}
+	}
+}
+
 } // namespace event
 } // namespace oflux
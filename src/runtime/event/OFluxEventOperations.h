@@ -51,11 +51,15 @@ acquire_guards(
  *    no error was encountered (predecessor's function returned 0).
  * @param successor_events is the vector where results are appended
  * @param ev is the predecessor event
+ * @param delayed (when given) gets the re-launch of a timed source
+ *    instead: marked not_before() and without its guards acquired.
+ *    Runtimes without timers pass NULL and run it right away.
  */
 void
 successors_on_no_error(
 	  std::vector<EventBasePtr> & successor_events
-	, EventBaseSharedPtr & ev);
+	, EventBaseSharedPtr & ev
+	, std::vector<EventBasePtr> * delayed = NULL);
 
 
 /**
@@ -63,12 +67,14 @@ successors_on_no_error(
  *    an error was encountered (predecessor's function returned non-0).
  * @param successor_events is the vector where results are appended
  * @param ev is the predecessor event
+ * @param delayed as for successors_on_no_error()
  */
 void
 successors_on_error(
 	  std::vector<EventBasePtr> & successor_events
 	, EventBaseSharedPtr & ev
-	, int return_code);
+	, int return_code
+	, std::vector<EventBasePtr> * delayed = NULL);
 
 /**
  * @brief push onto the events_vec the set of initial events and source events
@@ -84,6 +90,14 @@ push_initials_and_sources(
 	, flow::Flow * flow
 	, bool lifo = false);
 
+/**
+ * @brief events that will never run (but hold all their guards) give
+ *    them back.  Waiters that get those guards are dropped the same way.
+ * @param evs is emptied
+ */
+void
+drop_unrun(std::vector<EventBaseSharedPtr> & evs);
+
 } // namespace event
 } // namespace oflux
 
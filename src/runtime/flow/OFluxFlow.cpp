@@ -21,6 +21,7 @@
 #include "flow/OFluxFlowNode.h"
 #include "flow/OFluxFlowLibrary.h"
 #include "flow/OFluxFlowCommon.h"
+#include "OFluxMetrics.h"
 #include "OFluxLogging.h"
 #include <cstdlib>
 #include <algorithm>
@@ -91,6 +92,42 @@ Flow::log_snapshot()
                 (*mitr).second->log_snapshot();
                 mitr++;
         }
+        _admission.log_snapshot();
+}
+
+void
+Flow::counter_snapshot(std::vector<NodeCounterSnapshot> & result)
+{
+        result.resize(_nodes.size());
+        std::map<std::string, Node *>::const_iterator mitr = _nodes.begin();
+        for(size_t i = 0; mitr != _nodes.end(); ++i, ++mitr) {
+                (*mitr).second->counter_snapshot(result[i]);
+        }
+}
+
+void
+Flow::latency_snapshot(std::vector<NodeLatencySnapshot> & result)
+{
+        result.resize(_nodes.size());
+        std::map<std::string, Node *>::const_iterator mitr = _nodes.begin();
+        for(size_t i = 0; mitr != _nodes.end(); ++i, ++mitr) {
+                result[i].node = (*mitr).second;
+                (*mitr).second->latency_snapshot(result[i].latency);
+        }
+}
+
+void
+Flow::metrics_snapshot(metrics::Snapshot & s)
+{
+        std::map<std::string, Node *>::iterator mitr = _nodes.begin();
+        for(; mitr != _nodes.end(); ++mitr) {
+                (*mitr).second->metrics_snapshot(s);
+        }
+        std::map<std::string, Guard *>::iterator gitr = _guards.begin();
+        for(; gitr != _guards.end(); ++gitr) {
+                (*gitr).second->metrics_snapshot(s);
+        }
+        _admission.metrics_snapshot(s);
 }
 
 void 
@@ -170,6 +207,27 @@ Flow::assignMagicNumbers()
         }
 }
 
+void
+Flow::compile_successors()
+{
+        std::map<std::string, Node *>::iterator nitr = _nodes.begin();
+        while(nitr != _nodes.end()) {
+                (*nitr).second->compile_successors();
+                nitr++;
+        }
+        _admission.compile(*this);
+}
+
+void
+Flow::bind_guards()
+{
+        std::map<std::string,Guard *>::iterator itr = _guards.begin();
+        while(itr != _guards.end()) {
+                (*itr).second->bind();
+                itr++;
+        }
+}
+
 
 MagicNumberable * GuardMagicSorter::getMagicNumberable(const char * c)
 { 
@@ -27,17 +27,23 @@
 
 
 #include "OFluxOrderable.h"
+#include "flow/OFluxFlowAdmission.h"
 #include <map>
 #include <vector>
 #include <string>
 
 namespace oflux {
+namespace metrics {
+ class Snapshot;
+} // namespace metrics
 namespace flow {
 
 class Flow;
 class Node;
 class Guard;
 class Library;
+struct NodeCounterSnapshot;
+struct NodeLatencySnapshot;
 
 class GuardMagicSorter : public MagicSorter {
 public:
@@ -72,6 +78,7 @@ public:
         std::vector<Node *> & sources() { return _sources; }
         std::vector<Node *> & doors() { return _doors; }
         std::map<std::string, Node *> & nodes() { return _nodes; }
+        std::map<std::string, Guard *> & guards() { return _guards; }
 
         /**
          * @brief add a flow node
@@ -98,6 +105,20 @@ public:
          */
         void log_snapshot();
         void log_snapshot_guard(const char * gname);
+        /**
+         * @brief read the counters of every node in this flow (one pass)
+         * @param result is filled with one entry per node (name order)
+         */
+        void counter_snapshot(std::vector<NodeCounterSnapshot> & result);
+        /**
+         * @brief merge the latency histograms of every node in this flow
+         * @param result is filled with one entry per node (name order)
+         */
+        void latency_snapshot(std::vector<NodeLatencySnapshot> & result);
+        /**
+         * @brief add the node, guard and admission metrics to s
+         */
+        void metrics_snapshot(metrics::Snapshot & s);
         /**
          * @brief log a "pretty printed" flow DAG (graph) showing the flow
          */
@@ -128,6 +149,16 @@ public:
          * @brief [internal use] -- total ordering of guards is determined
          */
         void assignMagicNumbers();
+        /**
+         * @brief compile the successor tables of every node
+         * (and set up admission control on them)
+         */
+        void compile_successors();
+        /**
+         * @brief bind each guard to its (now built) atomic map
+         */
+        void bind_guards();
+        inline Admission & admission() { return _admission; }
         /**
          * @brief add an ordering constraint on the acquisition of two
          *   guards in this flow
@@ -147,6 +178,7 @@ private:
         std::vector<Library *>         _libraries;
         std::vector<Library *>         _prev_libraries;
 	mutable bool                   _gaveup_libraries;
+        Admission                      _admission;
 };
 
 /**
@@ -0,0 +1,220 @@
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "flow/OFluxFlowAdmission.h"
+#include "flow/OFluxFlow.h"
+#include "flow/OFluxFlowNode.h"
+#include "OFluxWrappers.h"
+#include "OFluxMetrics.h"
+#include "OFluxLogging.h"
+#include <set>
+#include <time.h>
+
+namespace oflux {
+namespace flow {
+
+Admission::Admission()
+	: _in_flight(0)
+	, _max_in_flight(0)
+	, _parked_count(0)
+	, _parks(0)
+	, _resumes(0)
+	, _throttled_ns(0)
+{
+	oflux_mutex_init(&_lck);
+}
+
+Admission::~Admission()
+{
+	oflux_mutex_destroy(&_lck);
+}
+
+long long
+Admission::now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void
+Admission::compile(Flow & f)
+{
+	std::map<std::string, Node *> & nodes = f.nodes();
+	std::map<std::string, Node *>::iterator nitr = nodes.begin();
+	for(; nitr != nodes.end(); ++nitr) {
+		Node * n = (*nitr).second;
+		if(!n->getIsDoor()
+				&& (_max_in_flight > 0 || n->max_in_flight() > 0)) {
+			n->admission(this,true);
+		}
+	}
+	std::vector<Node *> & sources = f.sources();
+	for(size_t i = 0; i < sources.size(); ++i) {
+		Node * src = sources[i];
+		Gate g;
+		// limited nodes reachable from src (before the next source)
+		std::set<Node *> visited;
+		std::vector<Node *> todo;
+		src->get_targets(todo);
+		while(!todo.empty()) {
+			Node * n = todo.back();
+			todo.pop_back();
+			if(n->getIsSource() || !visited.insert(n).second) {
+				continue;
+			}
+			if(n->max_in_flight() > 0) {
+				g.limited.push_back(n);
+			}
+			n->get_targets(todo);
+		}
+		if(_max_in_flight > 0 || !g.limited.empty()) {
+			_gates[src] = g;
+			src->admission(this,false);
+		}
+	}
+}
+
+static inline bool
+over(long count, long limit, bool resuming)
+{
+	// park at the limit, but only re-launch at 3/4 of it
+	return resuming ? count > (limit * 3) / 4 : count >= limit;
+}
+
+bool
+Admission::saturated(const Gate & g, bool resuming) const
+{
+	if(_max_in_flight > 0 && over(_in_flight,_max_in_flight,resuming)) {
+		return true;
+	}
+	for(size_t i = 0; i < g.limited.size(); ++i) {
+		Node * n = g.limited[i];
+		if(over(n->in_flight(),n->max_in_flight(),resuming)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool
+Admission::admit(Node * src)
+{
+	std::map<Node *, Gate>::iterator itr = _gates.find(src);
+	if(itr == _gates.end() || !saturated((*itr).second,false)) {
+		return true;
+	}
+	Gate & g = (*itr).second;
+	AutoLock al(&_lck);
+	if(g.parked) {
+		return false; // already waiting to be re-launched
+	}
+	__sync_fetch_and_add(&_parked_count,1); // pairs with counted()
+	if(!saturated(g,false)) {
+		// the events holding it up finished as we parked
+		__sync_fetch_and_sub(&_parked_count,1);
+		return true;
+	}
+	g.parked = true;
+	g.parked_since = now_ns();
+	++g.parks;
+	++_parks;
+	oflux_log_debug("Admission::admit() parked source %s (%ld in flight)\n"
+		, src->getName()
+		, _in_flight);
+	return false;
+}
+
+void
+Admission::resume(std::vector<Node *> & srcs)
+{
+	if(_parked_count == 0) {
+		return;
+	}
+	AutoLock al(&_lck);
+	long long now = now_ns();
+	std::map<Node *, Gate>::iterator itr = _gates.begin();
+	for(; itr != _gates.end(); ++itr) {
+		Gate & g = (*itr).second;
+		if(g.parked && !saturated(g,true)) {
+			long long throttled = now - g.parked_since;
+			g.parked = false;
+			g.throttled_ns += throttled;
+			_throttled_ns += throttled;
+			++_resumes;
+			__sync_fetch_and_sub(&_parked_count,1);
+			srcs.push_back((*itr).first);
+		}
+	}
+}
+
+void
+Admission::log_snapshot()
+{
+	if(_gates.empty()) {
+		return;
+	}
+	AutoLock al(&_lck);
+	oflux_log_info("admission: %ld in flight (max %ld) %d parked %lu parks %lu resumes %lld ms throttled\n"
+		, _in_flight
+		, _max_in_flight
+		, _parked_count
+		, _parks
+		, _resumes
+		, _throttled_ns / 1000000);
+	std::map<Node *, Gate>::iterator itr = _gates.begin();
+	for(; itr != _gates.end(); ++itr) {
+		Gate & g = (*itr).second;
+		oflux_log_info("admission: source %s %s %lu parks %lld ms throttled\n"
+			, (*itr).first->getName()
+			, g.parked ? "parked" : "      "
+			, g.parks
+			, g.throttled_ns / 1000000);
+		for(size_t i = 0; i < g.limited.size(); ++i) {
+			oflux_log_info("admission:   downstream %s %ld in flight (max %ld)\n"
+				, g.limited[i]->getName()
+				, g.limited[i]->in_flight()
+				, g.limited[i]->max_in_flight());
+		}
+	}
+}
+
+void
+Admission::metrics_snapshot(metrics::Snapshot & s)
+{
+	if(_gates.empty()) {
+		return;
+	}
+	AutoLock al(&_lck);
+	metrics::Labels l;
+	s.gauge("oflux_admission_in_flight"
+		, "events in flight over the counted nodes").add(l,_in_flight);
+	s.gauge("oflux_admission_max_in_flight"
+		, "flow limit on events in flight (0 for none)")
+		.add(l,_max_in_flight);
+	s.gauge("oflux_admission_parked_sources"
+		, "sources parked by admission control").add(l,_parked_count);
+	s.counter("oflux_admission_parks_total"
+		, "times sources were parked").add(l,_parks);
+	s.counter("oflux_admission_resumes_total"
+		, "times parked sources were re-launched").add(l,_resumes);
+	s.counter("oflux_admission_throttled_seconds_total"
+		, "time sources sat parked").add(l,_throttled_ns / 1e9);
+}
+
+} // namespace flow
+} // namespace oflux
@@ -0,0 +1,106 @@
+#ifndef OFLUX_FLOW_ADMISSION
+#define OFLUX_FLOW_ADMISSION
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file OFluxFlowAdmission.h
+ * @author Mark Pichora
+ * Admission control for sources.  The flow XML may limit the number of
+ * events in flight (created but not yet executed) for the whole flow
+ * (maxinflight on the flow element) and for single nodes (maxinflight
+ * on a node element).  A source which finishes while the flow, or a
+ * limited node downstream of it, is at its limit is parked instead of
+ * being re-launched.  It is re-launched once the counts have dropped
+ * to 3/4 of their limits, so that events no longer pile up behind
+ * guards (and in memory) under overload.
+ */
+
+#include "OFluxThreads.h"
+#include <vector>
+#include <map>
+
+namespace oflux {
+namespace metrics {
+ class Snapshot;
+} // namespace metrics
+namespace flow {
+
+class Flow;
+class Node;
+
+class Admission {
+public:
+	Admission();
+	~Admission();
+	inline void max_in_flight(long m) { _max_in_flight = m; }
+	inline long max_in_flight() const { return _max_in_flight; }
+	inline long in_flight() const { return _in_flight; }
+	/**
+	 * @brief decide which nodes are counted and which sources are
+	 * gated (called once the successors of the flow are compiled)
+	 */
+	void compile(Flow & f);
+	/**
+	 * @brief an event of a counted node was created (by = 1) or
+	 * finished executing (by = -1)
+	 */
+	inline void counted(long by) { __sync_fetch_and_add(&_in_flight,by); }
+	/**
+	 * @brief may source src be re-launched now?
+	 * @return false if it was parked instead (see resume())
+	 */
+	bool admit(Node * src);
+	inline bool has_parked() const { return _parked_count > 0; }
+	/**
+	 * @brief take the parked sources which may be re-launched now
+	 */
+	void resume(std::vector<Node *> & srcs);
+	void log_snapshot();
+	void metrics_snapshot(metrics::Snapshot & s);
+private:
+	struct Gate { // per gated source
+		Gate()
+			: parked(false)
+			, parked_since(0)
+			, parks(0)
+			, throttled_ns(0)
+		{}
+		std::vector<Node *> limited; // limited nodes downstream
+		bool parked;
+		long long parked_since;
+		unsigned long parks;
+		long long throttled_ns;
+	};
+	bool saturated(const Gate & g, bool resuming) const;
+	static long long now_ns();
+private:
+	volatile long        _in_flight; // over the counted nodes
+	long                 _max_in_flight; // 0 if the flow has no limit
+	oflux_mutex_t        _lck; // guards the parked state of _gates
+	std::map<Node *, Gate> _gates;
+	volatile int         _parked_count;
+	unsigned long        _parks;
+	unsigned long        _resumes;
+	long long            _throttled_ns; // total time sources sat parked
+};
+
+} // namespace flow
+} // namespace oflux
+
+#endif // OFLUX_FLOW_ADMISSION
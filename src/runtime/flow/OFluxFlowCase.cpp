@@ -18,6 +18,7 @@
 #include "flow/OFluxFlowNode.h"
 #include "flow/OFluxFlowCase.h"
 #include "flow/OFluxFlowCommon.h"
+#include <cassert>
 
 namespace oflux {
 namespace flow {
@@ -59,7 +60,82 @@ Case::pretty_print(int depth, std::set<std::string> * visited)
 }
 
 
+SuccessorTable::SuccessorTable()
+	: _successor_start(0)
+	, _case_start(0)
+	, _successor_closed(false)
+{
+}
+
+void
+SuccessorTable::clear()
+{
+	_records.clear();
+	_successor_start = 0;
+	_case_start = 0;
+	_successor_closed = false;
+}
+
+void
+SuccessorTable::begin_successor()
+{
+	_successor_start = _records.size();
+	_case_start = _successor_start;
+	_successor_closed = false;
+}
 
+void
+SuccessorTable::push(Case * fc, ConditionFn condfn, bool is_negated, bool completes)
+{
+	SuccessorRecord r;
+	r.condfn = condfn;
+	r.is_negated = is_negated;
+	r.completes_case = completes;
+	r.on_success = _records.size() + 1; // fixed up in end_successor()
+	r.on_failure = 0; // fixed up when the next case starts
+	r.target = fc->_targetnode;
+	r.converter = fc->_io_converter;
+	_records.push_back(r);
+	assert(_records.size() < 0xffff && "SuccessorTable too large");
+}
+
+void
+SuccessorTable::add_case(Case * fc)
+{
+	if(_successor_closed) {
+		return; // follows a default case: never reached
+	}
+	size_t start = _records.size();
+	for(size_t i = _case_start; i < start; ++i) {
+		_records[i].on_failure = start;
+	}
+	_case_start = start;
+	size_t n = fc->_conditions.size();
+	if(n == 0) {
+		push(fc,NULL,false,true);
+		_successor_closed = true;
+	}
+	for(size_t i = 0; i < n; ++i) {
+		Condition * cond = fc->_conditions[i];
+		push(fc,cond->_condfn,cond->_is_negated,i+1 == n);
+	}
+}
+
+void
+SuccessorTable::end_successor()
+{
+	size_t end = _records.size();
+	for(size_t i = _case_start; i < end; ++i) {
+		_records[i].on_failure = end;
+	}
+	for(size_t i = _successor_start; i < end; ++i) {
+		if(_records[i].completes_case) {
+			_records[i].on_success = end;
+		}
+	}
+	_successor_start = end;
+	_case_start = end;
+}
 
 } // namespace flow
 } // namespace oflux
@@ -38,6 +38,7 @@ namespace flow {
 
 
 class Case;
+class SuccessorTable;
 
 /**
  * @class Condition
@@ -51,6 +52,7 @@ public:
         inline bool satisfied(const void * a) 
         { return ((*_condfn)(a) ? !_is_negated : _is_negated); }
 private:
+	friend class SuccessorTable;
         ConditionFn _condfn;
         bool        _is_negated;
 };
@@ -107,6 +109,7 @@ public:
         void pretty_print(int depth, std::set<std::string> * visited);
         inline bool isDefault() { return _conditions.size() == 0; }
 private:
+	friend class SuccessorTable;
 	std::string              _targetname;
         Node *                   _targetnode;
         IOConverter *            _io_converter;
@@ -115,6 +118,87 @@ private:
 
 
 
+/**
+ * @class SuccessorRecord
+ * @brief one condition of one case within a flattened SuccessorTable
+ * Every record of a case carries the case's target node and io converter,
+ * so a satisfied record can be handed out directly without visiting the Case.
+ * A record with no condition function is always satisfied (default case).
+ */
+struct SuccessorRecord {
+	ConditionFn     condfn;
+	bool            is_negated;
+	bool            completes_case; // last condition of its case
+	unsigned short  on_success;     // next record to test when satisfied
+	unsigned short  on_failure;     // next record to test otherwise
+	Node *          target;
+	IOConverter *   converter;
+
+	inline bool satisfied(const void * a) const
+	{ 
+		return condfn == NULL 
+			|| ((*condfn)(a) ? !is_negated : is_negated); 
+	}
+        inline Node * targetNode() const { return target; }
+        inline IOConverter * ioConverter() const { return converter; }
+};
+
+/**
+ * @class SuccessorTable
+ * @brief the successors of a node compiled into one contiguous array
+ * Cases of each successor are laid out in order (one record per condition)
+ * and linked by index, so resolving the successors of an output is a 
+ * linear scan.  Cases that follow a default case are unreachable and 
+ * are not compiled in.
+ */
+class SuccessorTable {
+public:
+	SuccessorTable();
+	void clear();
+	void begin_successor();
+	void add_case(Case * fc);
+	void end_successor();
+        inline void get_successors(
+		  std::vector<const SuccessorRecord *> & successor_nodes
+		, const void * a) const
+        {
+		const SuccessorRecord * records = 
+			(_records.empty() ? NULL : &_records[0]);
+		size_t sz = _records.size();
+		size_t i = 0;
+		while(i < sz) {
+			const SuccessorRecord & r = records[i];
+			if(r.satisfied(a)) {
+				if(r.completes_case) {
+					successor_nodes.push_back(&r);
+				}
+				i = r.on_success;
+			} else {
+				i = r.on_failure;
+			}
+		}
+        }
+	inline size_t size() const { return _records.size(); }
+	/**
+	 * @brief append the target of every compiled case
+	 */
+	void targets(std::vector<Node *> & nodes) const
+	{
+		for(size_t i = 0; i < _records.size(); ++i) {
+			if(_records[i].completes_case && _records[i].target) {
+				nodes.push_back(_records[i].target);
+			}
+		}
+	}
+private:
+	void push(Case * fc, ConditionFn condfn, bool is_negated, bool completes);
+private:
+	std::vector<SuccessorRecord> _records;
+	size_t                       _successor_start;
+	size_t                       _case_start;
+	bool                         _successor_closed;
+};
+
 } // namespace flow
 } // namespace oflux
 
@@ -16,6 +16,7 @@
  *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "flow/OFluxFlowGuard.h"
+#include "OFluxMetrics.h"
 #include "OFluxLogging.h"
 #include <vector>
 
@@ -48,5 +49,20 @@ Guard::drain()
         }
 }
 
+void
+Guard::metrics_snapshot(metrics::Snapshot & s)
+{
+	atomic::AtomicMapCounts c;
+	counts(c);
+	metrics::Labels l;
+	l.add("guard",_name.c_str());
+	s.gauge("oflux_guard_keys","atomics (keys) in the guard").add(l,c.keys);
+	s.gauge("oflux_guard_held","atomics of the guard held").add(l,c.held);
+	if(c.waiters_counted) { // (lock-free waiter lists are not walked)
+		s.gauge("oflux_guard_waiters","events waiting on the guard")
+			.add(l,c.waiters);
+	}
+}
+
 } // namespace flow
 } // namespace oflux
@@ -32,6 +32,9 @@
 #include <string>
 
 namespace oflux {
+namespace metrics {
+ class Snapshot;
+} // namespace metrics
 namespace flow {
 
 class Flow;
@@ -48,6 +51,7 @@ public:
                 : _amap(amap)
                 , _name(n)
 		, _is_gc(is_gc)
+		, _key_size(0)
                 {}
         /**
          * @brief acquire the atomic value if possible -- otherwise should wait
@@ -79,6 +83,29 @@ public:
          */
         inline void 
 	delete_key(void * k) const { _amap->delete_key(k); }
+        /**
+         * @brief ask the map its key size once it is built
+         * (called when the flow is finalized -- not yet when the
+         * guard is read -- and before any event uses the guard)
+         */
+        inline void
+	bind() { _key_size = _amap ? _amap->key_size() : 0; }
+        /**
+         * @brief size of a key constructed in place (0 if unsupported)
+         */
+        inline size_t
+	key_size() const { return _key_size; }
+        /**
+         * @brief construct a key in buf (key_size() bytes)
+         * @return the key pointer
+         */
+        inline void *
+	construct_key(void * buf) const { return _amap->construct_key(buf); }
+        /**
+         * @brief destroy a key made by construct_key()
+         */
+        inline void
+	destroy_key(void * k) const { _amap->destroy_key(k); }
         /**
          * @brief return the name of the guard
          * @return name of the guard
@@ -90,6 +117,8 @@ public:
          */
         void drain();
 	void log_snapshot() { if(_amap) _amap->log_snapshot(_name.c_str()); }
+	void counts(atomic::AtomicMapCounts & c) { if(_amap) _amap->counts(c); }
+	void metrics_snapshot(metrics::Snapshot & s);
 	inline bool garbage_collect(const void * key, atomic::Atomic * a)
  	{
  		bool res = false;
@@ -103,24 +132,46 @@ private:
         atomic::AtomicMapAbstract * _amap;
         std::string _name;
 	bool _is_gc;
+	size_t _key_size; // set by bind()
 };
 
 /**
  * @class GuardLocalKey
  * @brief hold a local guard key and dispose of it when done
+ * Keys small enough are built in an inline buffer (on the stack in
+ * GuardReference::get()) rather than on the heap.
  */
 class GuardLocalKey {
 public:
+	enum { Inline_Key_Size = 128 };
+
 	GuardLocalKey(Guard *g)
-		: _local_key(g->new_key())
-		, _guard(g)
+		: _guard(g)
+		, _in_place(g->key_size() > 0
+			&& g->key_size() <= Inline_Key_Size)
+		, _local_key(_in_place
+			? g->construct_key(_buf.bytes)
+			: g->new_key())
 	{}
 	~GuardLocalKey()
-	{ _guard->delete_key(_local_key); }
+	{
+		if(_in_place) {
+			_guard->destroy_key(_local_key);
+		} else {
+			_guard->delete_key(_local_key);
+		}
+	}
 	void * get() { return _local_key; }
 private:
-	void * _local_key;
 	Guard * _guard;
+	bool _in_place;
+	void * _local_key;
+	union {
+		char bytes[Inline_Key_Size];
+		long double align_ld;
+		void * align_ptr;
+		long long align_ll;
+	} _buf;
 };
 
 class Node;
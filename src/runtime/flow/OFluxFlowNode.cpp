@@ -19,8 +19,11 @@
 #include "flow/OFluxFlowCase.h"
 #include "flow/OFluxFlowGuard.h"
 #include "flow/OFluxFlowCommon.h"
+#include "OFluxWrappers.h"
+#include "OFluxMetrics.h"
 #include "OFluxLogging.h"
 #include <algorithm>
+#include <map>
 #include <string.h>
 
 namespace oflux {
@@ -103,19 +106,16 @@ Successor::getByTargetNode(const Node *n)
 		: *itr );
 }
 
-Case * 
-Successor::get_successor(const void * a)
+void
+Successor::compile(SuccessorTable & table)
 {
-	Case * res = NULL;
+	table.begin_successor();
 	std::deque<Case *>::iterator itr = _cases.begin();
-	while(itr != _cases.end() && res == NULL) {
-		Case * flowcase = *itr;
-		if(flowcase->satisfied(a)) {
-			res = flowcase;
-		}
-		itr++;
+	while(itr != _cases.end()) {
+		table.add_case(*itr);
+		++itr;
 	}
-	return res;
+	table.end_successor();
 }
 
 std::string 
@@ -184,6 +184,16 @@ SuccessorList::remove(Successor * fs)
 	delete fs;
 }
 
+void
+SuccessorList::compile(SuccessorTable & table)
+{
+        std::map<std::string, Successor *>::iterator itr = _successorlist.begin();
+        while(itr != _successorlist.end()) { 
+                itr->second->compile(table);
+                ++itr;
+        }
+}
+
 void 
 SuccessorList::pretty_print(int depth, std::set<std::string> * visited)
 {
@@ -196,7 +206,28 @@ SuccessorList::pretty_print(int depth, std::set<std::string> * visited)
         oflux_log_info("%s.\n", create_indention(depth+1).c_str());
 }
 
-int Node::_last_id=0;
+/**
+ * @brief node ids by node name: the node of a reloaded flow takes over
+ * the id (and so the latency histograms) of the node it replaces, and
+ * ids stay below the number of node names ever loaded
+ */
+static int
+id_of(const char * name)
+{
+	static struct Ids {
+		Ids() { oflux_mutex_init(&lock); }
+		oflux_mutex_t lock;
+		std::map<std::string, int> by_name;
+	} ids;
+	AutoLock al(&ids.lock);
+	std::map<std::string, int>::iterator itr = ids.by_name.find(name);
+	if(itr != ids.by_name.end()) {
+		return itr->second;
+	}
+	int id = (int)ids.by_name.size();
+	ids.by_name[name] = id;
+	return id;
+}
 
 Node::Node(       const char * name
 		, const char * function_name
@@ -207,10 +238,11 @@ Node::Node(       const char * name
                 , bool is_door
                 , bool is_detached
                 , const char * input_unionhash
-                , const char * output_unionhash)
+                , const char * output_unionhash
+                , int priority)
         : _instances(0)
         , _executions(0)
-	, _id(__sync_fetch_and_add(&_last_id,1))
+	, _id(id_of(name))
         , _name(name)
 	, _function_name(function_name)
         , _createfn(createfn)
@@ -220,6 +252,16 @@ Node::Node(       const char * name
         , _is_door(is_door)
 	, _is_initial(-1) // unknown
         , _is_detached(is_detached)
+        , _priority(priority)
+        , _lane(priority <= 0
+                ? 0
+                : (priority >= Priority_Lanes ? Priority_Lanes-1 : priority))
+        , _admission(NULL)
+        , _in_flight_counted(false)
+        , _in_flight(0)
+        , _max_in_flight(0)
+        , _period_ns(0)
+        , _period_due(0)
 	, _successor_list(NULL)
 	, _error_handler_case(new Case())
         , _this_case(new Case(name,this,NULL))
@@ -271,23 +313,54 @@ Node::setErrorHandler(Node *fn)
         _error_handler_case->setTargetNode(fn);
 }
 
+void
+Node::compile_successors()
+{
+	_successor_table.clear();
+	if(_successor_list) {
+		_successor_list->compile(_successor_table);
+	}
+	_error_table.clear();
+	if(_error_handler_case->targetNode() != NULL) {
+		_error_table.begin_successor();
+		_error_table.add_case(_error_handler_case);
+		_error_table.end_successor();
+	}
+	_this_table.clear();
+	_this_table.begin_successor();
+	_this_table.add_case(_this_case);
+	_this_table.end_successor();
+}
+
 void 
-Node::get_successors(std::vector<Case *> & successor_nodes, 
+Node::get_successors(std::vector<const SuccessorRecord *> & successor_nodes, 
 		const void * a,
 		int return_code)
 {
 	if(return_code != 0) {
-		if(_error_handler_case->targetNode() != NULL) {
-			successor_nodes.push_back(_error_handler_case);
-		}
+		_error_table.get_successors(successor_nodes,a);
 		if(_is_source && !getIsInitial()) { // even on errors
-			successor_nodes.push_back(_this_case);
+			_this_table.get_successors(successor_nodes,a);
 		}
 	} else {
-		_successor_list->get_successors(successor_nodes,a);
+		_successor_table.get_successors(successor_nodes,a);
 	}
 }
 
+void
+Node::get_targets(std::vector<Node *> & targets) const
+{
+	_successor_table.targets(targets);
+	_error_table.targets(targets);
+}
+
+void
+Node::admission(Admission * a, bool counted)
+{
+	_admission = a;
+	_in_flight_counted = _in_flight_counted || counted;
+}
+
 bool
 Node::getIsInitial()
 {
@@ -308,30 +381,109 @@ Node::add(GuardReference * fgr)
 	_guard_refs.push_back(fgr); 
 }
 
+void
+Node::counter_snapshot(NodeCounterSnapshot & ncs) const
+{
+	ncs.node = this;
+	ncs.instances = _instances.value();
+	ncs.executions = _executions.value();
+	ncs.pool_hits = _event_pool.hits();
+	ncs.pool_misses = _event_pool.misses();
+}
+
+void
+Node::latency_snapshot(latency::NodeLatency & nl) const
+{
+	latency::snapshot(_id,nl);
+}
+
+void
+Node::metrics_snapshot(metrics::Snapshot & s)
+{
+	static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+	static const char * quantile_strs[] = { "0.5", "0.9", "0.99", "0.999" };
+	NodeCounterSnapshot ncs;
+	counter_snapshot(ncs);
+	metrics::Labels l;
+	l.add("node",_name.c_str());
+	s.counter("oflux_node_instances_total","events created")
+		.add(l,ncs.instances);
+	s.counter("oflux_node_executions_total","events executed")
+		.add(l,ncs.executions);
+	s.counter("oflux_node_pool_hits_total"
+		, "event allocations recycled from the node's pool")
+		.add(l,ncs.pool_hits);
+	s.counter("oflux_node_pool_misses_total"
+		, "event allocations that went to the heap")
+		.add(l,ncs.pool_misses);
+	latency::NodeLatency nl;
+	latency_snapshot(nl);
+	double ns_per_tick = CycleClock::ns_per_tick();
+	metrics::Family & f = s.family("oflux_node_latency_seconds"
+		, metrics::T_summary
+		, "node exec time, queue wait (birth to start) and guard wait");
+	for(int m = 0; m < latency::M_num_metrics; ++m) {
+		const Histogram & h = nl.h[m];
+		if(h.count() == 0) {
+			continue;
+		}
+		metrics::Labels lm(l);
+		lm.add("metric",latency::metric_name(m));
+		for(size_t q = 0; q < sizeof(quantiles)/sizeof(quantiles[0]); ++q) {
+			metrics::Labels lq(lm);
+			lq.add("quantile",quantile_strs[q]);
+			f.add(lq,nl.percentile_ns(m,quantiles[q]) / 1e9);
+		}
+		f.add(lm,h.sum() * ns_per_tick / 1e9,"_sum");
+		f.add(lm,h.count(),"_count");
+	}
+}
+
 void 
 Node::log_snapshot()
 {
+        NodeCounterSnapshot ncs;
+        counter_snapshot(ncs);
 #ifdef PROFILING
-        oflux_log_info("%s (%c%c%c) %lld instances %lld executions (time real:avg %lf max %lf oflux:avg %lf max %lf)\n", 
+        oflux_log_info("%s (%c%c%c) %lld instances %lld executions (pool %lld hits %lld misses) (time real:avg %lf max %lf oflux:avg %lf max %lf)\n", 
                 _name.c_str(),
                 (_is_source ? 's' : '-'),
                 (_is_detached ? 'd' : '-'),
                 (_is_error_handler ? 'e' : '-'),
-                _instances.value(),
-                _executions.value(),
+                ncs.instances,
+                ncs.executions,
+                ncs.pool_hits,
+                ncs.pool_misses,
                 _real_timer_stats.avg_usec(),
                 _real_timer_stats.max_usec(),
                 _oflux_timer_stats.avg_usec(),
                 _oflux_timer_stats.max_usec());        
 #else
-        oflux_log_info("%s (%c%c%c) %lld instances %lld executions\n",
+        oflux_log_info("%s (%c%c%c) %lld instances %lld executions (pool %lld hits %lld misses)\n",
                 _name.c_str(),
                 (_is_source ? 's' : '-'),
                 (_is_detached ? 'd' : '-'),
                 (_is_error_handler ? 'e' : '-'),
-                _instances.value(),
-                _executions.value());
+                ncs.instances,
+                ncs.executions,
+                ncs.pool_hits,
+                ncs.pool_misses);
 #endif
+        latency::NodeLatency nl;
+        latency_snapshot(nl);
+        for(int m = 0; m < latency::M_num_metrics; ++m) {
+                if(nl.h[m].count() == 0) {
+                        continue;
+                }
+                oflux_log_info("  %s %s (usec) count %llu p50 %.1lf p99 %.1lf p999 %.1lf max %.1lf\n",
+                        _name.c_str(),
+                        latency::metric_name(m),
+                        nl.h[m].count(),
+                        nl.percentile_ns(m,0.5)/1000.0,
+                        nl.percentile_ns(m,0.99)/1000.0,
+                        nl.percentile_ns(m,0.999)/1000.0,
+                        nl.max_ns(m)/1000.0);
+        }
 }
 
 void 
@@ -28,7 +28,11 @@
 
 #include "OFlux.h"
 #include "OFluxProfiling.h"
+#include "OFluxLatency.h"
 #include "lockfree/OFluxDistributedCounter.h"
+#include "flow/OFluxFlowNodePool.h"
+#include "flow/OFluxFlowCase.h"
+#include "flow/OFluxFlowAdmission.h"
 #include <vector>
 #include <deque>
 #include <map>
@@ -60,7 +64,10 @@ public:
 	void remove(Case * fc);
 	Case * getByTargetName(const char *n);
 	Case * getByTargetNode(const Node *n);
-        Case * get_successor(const void * a);
+        /**
+         * @brief append the cases (in order) to a flat successor table
+         */
+        void compile(SuccessorTable & table);
         void pretty_print(int depth, std::set<std::string> * visited);
 private:
         std::string        _name;
@@ -86,17 +93,7 @@ public:
                 std::map<std::string, Successor *>::iterator itr = _successorlist.find(name);
                 return (itr ==  _successorlist.end() ? NULL : (*itr).second);
         }
-        inline void get_successors(std::vector<Case *> & successor_nodes, const void * a)
-        {
-                std::map<std::string, Successor *>::iterator itr = _successorlist.begin();
-                while(itr != _successorlist.end()) { 
-                        Case * s = itr->second->get_successor(a);
-                        if(s) {
-                                successor_nodes.push_back(s);
-                        }
-                        itr++;
-                }
-        }
+        void compile(SuccessorTable & table);
         void pretty_print(int depth, std::set<std::string> * visited);
 	bool has_successor_with_target(const Node * n) const;
 private:
@@ -104,6 +101,25 @@ private:
 };
 
 
+/**
+ * @brief copy of the distributed counters of one flow node
+ */
+struct NodeCounterSnapshot {
+	const Node * node;
+	long long    instances;
+	long long    executions;
+	long long    pool_hits;
+	long long    pool_misses;
+};
+
+/**
+ * @brief merged latency histograms of one flow node
+ */
+struct NodeLatencySnapshot {
+	const Node *          node;
+	latency::NodeLatency  latency;
+};
+
 /**
  * @class Node
  * @brief holds the programmatic information about a node (err handler, succ list)
@@ -114,6 +130,7 @@ private:
 class Node {
 public:
 	typedef Flow ParentObjType;
+	enum { Priority_Lanes = 3 }; // run queue lanes (see lane())
 
         friend class NodeCounterIncrementer;
         Node(   const char * name,
@@ -125,7 +142,8 @@ public:
 		bool is_door,
                 bool is_detached,
                 const char * input_unionhash,
-                const char * output_unionhash);
+                const char * output_unionhash,
+                int priority = 0);
         ~Node();
         void setErrorHandler(Node *fn);
         void successor_list(SuccessorList * sl) { _successor_list = sl; }
@@ -137,14 +155,85 @@ public:
         inline bool getIsDoor() const { return _is_door; }
         inline bool getIsErrorHandler() const { return _is_error_handler; }
         inline bool getIsDetached() const { return _is_detached; }
+        inline int getPriority() const { return _priority; }
+        /**
+         * @brief the run queue lane for this node's events
+         * Runtimes dispatch events from the highest lane first, so
+         * latency-critical nodes overtake bulk work.
+         */
+        inline int lane() const { return _lane; }
+        /**
+         * @brief admission control (see OFluxFlowAdmission.h)
+         * The in flight count is kept only for nodes that a limit
+         * covers (by = 1 on creation, -1 once executed).
+         */
+        inline void count_in_flight(long by)
+        {
+                if(_in_flight_counted) {
+                        __sync_fetch_and_add(&_in_flight,by);
+                        _admission->counted(by);
+                }
+        }
+        inline long in_flight() const { return _in_flight; }
+        inline long max_in_flight() const { return _max_in_flight; }
+        inline void max_in_flight(long m) { _max_in_flight = m; }
+        inline Admission * admission() { return _admission; }
+        void admission(Admission * a, bool counted);
+        /**
+         * @brief timed source: re-launched period_ns after its last
+         * scheduled run (0 for right away)
+         */
+        inline long long period_ns() const { return _period_ns; }
+        inline void period_ns(long long p) { _period_ns = p; }
+        /**
+         * @return when the next run of this timed source is due
+         * (ticks that were missed are skipped rather than bunched up).
+         * Safe to call from several threads (a source can be
+         * re-launched from a worker and an offload thread).
+         */
+        inline long long next_due(long long now)
+        {
+                long long due;
+                long long next;
+                do {
+                        due = _period_due;
+                        next = due + _period_ns;
+                        if(next <= now) {
+                                next = now + _period_ns;
+                        }
+                } while(!__sync_bool_compare_and_swap(&_period_due,due,next));
+                return next;
+        }
         inline CreateNodeFn & getCreateFn() { return _createfn; }
         inline CreateDoorFn & getCreateDoorFn() { return _createdoorfn; }
-        void get_successors(std::vector<Case *> & successor_nodes, 
+        /**
+         * @brief flatten the successor list and error cases into tables
+         * Must be called once the flow is fully linked (targets and 
+         * error handlers set) and before get_successors() is used.
+         */
+        void compile_successors();
+        void get_successors(std::vector<const SuccessorRecord *> & successor_nodes, 
                         const void * a,
                         int return_code);
+        /**
+         * @brief append every node this one may have as a successor
+         */
+        void get_targets(std::vector<Node *> & targets) const;
         inline std::vector<GuardReference *> & guards() { return _guard_refs; }
         void add(GuardReference * fgr);
         void log_snapshot();
+        /**
+         * @brief read all of this node's counters at once
+         */
+        void counter_snapshot(NodeCounterSnapshot & ncs) const;
+        /**
+         * @brief merge this node's latency histograms over all threads
+         */
+        void latency_snapshot(latency::NodeLatency & nl) const;
+        /**
+         * @brief add this node's counters and latency summaries to s
+         */
+        void metrics_snapshot(metrics::Snapshot & s);
         void pretty_print(int depth, char context, std::set<std::string> * visited);
 #ifdef PROFILING
         inline TimerStats * real_timer_stats() { return &_real_timer_stats; }
@@ -158,11 +247,14 @@ public:
         void sortGuards();
         bool isGuardsCompletelySorted() { return _is_guards_completely_sorted; }
 	int id() const { return _id; }
+	/**
+	 * @brief the memory pool used to allocate events of this node
+	 */
+	inline NodeEventPool & event_pool() { return _event_pool; }
 public:
         oflux::lockfree::Counter<long long> _instances; // cumulative created events
         oflux::lockfree::Counter<long long> _executions; // cumulative executed events
-	int                           _id;
-	static int		      _last_id;
+	int                           _id; // kept by its name over reloads
 private:
         std::string                   _name;
 	std::string                   _function_name;
@@ -173,13 +265,25 @@ private:
         bool                          _is_door;
         int                           _is_initial;
         bool                          _is_detached;
+        int                           _priority;
+        int                           _lane; // priority clamped to the lanes
+        Admission *                   _admission;
+        bool                          _in_flight_counted;
+        volatile long                 _in_flight;
+        long                          _max_in_flight; // 0 for no limit
+        long long                     _period_ns; // 0 unless a timed source
+        volatile long long            _period_due; // last deadline given out
         SuccessorList *               _successor_list;
         Case *                        _error_handler_case;
         Case *                        _this_case;
+        SuccessorTable                _successor_table;
+        SuccessorTable                _error_table; // error handler case
+        SuccessorTable                _this_table;  // source re-launch on error
         std::vector<GuardReference *> _guard_refs;
         std::string                   _input_unionhash;
         std::string                   _output_unionhash;
         bool                          _is_guards_completely_sorted;
+        NodeEventPool                 _event_pool;
 #ifdef PROFILING
         TimerStats                    _real_timer_stats;
         TimerStats                    _oflux_timer_stats;
@@ -29,15 +29,27 @@ get_node_name(const flow::Node *n)
 
 NodeCounterIncrementer::NodeCounterIncrementer(Node * flow_node)
 	: _flow_node(flow_node)
+	, _in_flight(flow_node != NULL)
 {
 	if(_flow_node) {
 		_flow_node->_instances++;
+		_flow_node->count_in_flight(1);
 	}
 }
 
 NodeCounterIncrementer::~NodeCounterIncrementer()
 {
     //_flow_node->_instances--;   Now cumulative number
+	done_in_flight();
+}
+
+void
+NodeCounterIncrementer::done_in_flight()
+{
+	if(_in_flight) {
+		_in_flight = false;
+		_flow_node->count_in_flight(-1);
+	}
 }
 
 
@@ -37,8 +37,14 @@ public:
         NodeCounterIncrementer(Node * flow_node);
         virtual ~NodeCounterIncrementer();
         inline Node * flow_node() { return _flow_node; }
+        /**
+         * @brief the event leaves the in flight count of its node
+         * (once: events destroyed before they finish leave it here)
+         */
+        void done_in_flight();
 protected:
         Node * _flow_node;
+        bool   _in_flight;
 };
 
 
@@ -0,0 +1,230 @@
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "flow/OFluxFlowNodePool.h"
+#include "OFluxWrappers.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+/**
+ * @file OFluxFlowNodePool.cpp
+ * @author Mark Pichora
+ * @brief thread local free list caches for per-node event memory
+ */
+
+namespace oflux {
+namespace flow {
+
+namespace {
+
+struct CacheSlot {
+	size_t                  pool_id; // 0 for unclaimed
+	size_t                  count;
+	NodeEventPool::Header * head;
+};
+
+struct ThreadCache {
+	size_t      size;
+	CacheSlot * slots; // indexed by NodeEventPool::index()
+};
+
+void
+evict(CacheSlot & slot)
+{
+	NodeEventPool::Header * h = slot.head;
+	while(h) {
+		NodeEventPool::Header * hn = h->next;
+		free(h);
+		h = hn;
+	}
+	slot.head = NULL;
+	slot.count = 0;
+	slot.pool_id = 0;
+}
+
+__thread ThreadCache * _thread_cache = NULL;
+
+void
+thread_cache_destroy(void * v)
+{
+	ThreadCache * tc = reinterpret_cast<ThreadCache *>(v);
+	// later key destructors on this thread may still free events
+	// (a fresh cache is made for them)
+	_thread_cache = NULL;
+	for(size_t i = 0; i < tc->size; ++i) {
+		evict(tc->slots[i]);
+	}
+	free(tc->slots);
+	free(tc);
+}
+
+void
+grow(ThreadCache * tc, size_t index)
+{
+	size_t sz = std::max(tc->size * 2, index + 1);
+	CacheSlot * slots = reinterpret_cast<CacheSlot *>(
+		realloc(tc->slots, sz * sizeof(CacheSlot)));
+	if(!slots) throw std::bad_alloc();
+	memset(slots + tc->size, 0, (sz - tc->size) * sizeof(CacheSlot));
+	tc->slots = slots;
+	tc->size = sz;
+}
+
+inline CacheSlot &
+thread_cache_slot(size_t index)
+{
+	if(!_thread_cache) {
+		// key is only needed so the cache is freed on thread exit
+		static ThreadLocalDataKey<ThreadCache> key(thread_cache_destroy);
+		ThreadCache * tc = reinterpret_cast<ThreadCache *>(
+			malloc(sizeof(ThreadCache)));
+		if(!tc) throw std::bad_alloc();
+		memset(tc,0,sizeof(ThreadCache));
+		key.set(tc);
+		_thread_cache = tc;
+		grow(tc, NodeEventPool::Thread_Cache_Slots - 1);
+	}
+	if(index >= _thread_cache->size) {
+		grow(_thread_cache, index);
+	}
+	return _thread_cache->slots[index];
+}
+
+/**
+ * @brief dense pool indices: the index of a destroyed pool is handed to 
+ * the next pool created
+ */
+struct Indices {
+	Indices() : next(0) { oflux_mutex_init(&lock); }
+	oflux_mutex_t       lock;
+	size_t              next;
+	std::vector<size_t> unused;
+};
+
+Indices &
+indices()
+{
+	// never destroyed: pools may outlive static destruction
+	static Indices * ids = new Indices();
+	return *ids;
+}
+
+size_t
+acquire_index()
+{
+	Indices & ids = indices();
+	AutoLock al(&ids.lock);
+	if(ids.unused.empty()) {
+		return ids.next++;
+	}
+	size_t index = ids.unused.back();
+	ids.unused.pop_back();
+	return index;
+}
+
+void
+release_index(size_t index)
+{
+	Indices & ids = indices();
+	AutoLock al(&ids.lock);
+	ids.unused.push_back(index);
+}
+
+} // namespace
+
+
+size_t NodeEventPool::_last_pool_id = 1;
+
+NodeEventPool::NodeEventPool()
+	: _el_sz(0)
+	, _index(acquire_index())
+	, _pool_id(__sync_fetch_and_add(&_last_pool_id,1))
+	, _hits(0)
+	, _misses(0)
+{}
+
+NodeEventPool::~NodeEventPool()
+{
+	// blocks still cached for this pool are evicted when the index
+	// is reused (or when their thread exits)
+	release_index(_index);
+}
+
+void *
+NodeEventPool::get()
+{
+	CacheSlot & slot = thread_cache_slot(_index);
+	Header * h = NULL;
+	if(slot.pool_id == _pool_id && slot.head) {
+		h = slot.head;
+		slot.head = h->next;
+		--slot.count;
+		++_hits;
+	} else {
+		h = reinterpret_cast<Header *>(malloc(sizeof(Header) + _el_sz));
+		if(!h) throw std::bad_alloc();
+		++_misses;
+	}
+	h->pool = this;
+	return element(h);
+}
+
+void
+NodeEventPool::put(void * m)
+{
+	if(!m) return;
+	Header * h = header(m);
+	CacheSlot & slot = thread_cache_slot(_index);
+	if(slot.pool_id != _pool_id) {
+		// a destroyed pool had this index before
+		evict(slot);
+		slot.pool_id = _pool_id;
+	}
+	if(slot.count >= Thread_Cache_Max_Elements) {
+		free(h);
+	} else {
+		h->next = slot.head;
+		slot.head = h;
+		++slot.count;
+	}
+}
+
+void *
+NodeEventPool::heap_get(size_t sz)
+{
+	Header * h = reinterpret_cast<Header *>(malloc(sizeof(Header) + sz));
+	if(!h) throw std::bad_alloc();
+	h->pool = NULL;
+	return element(h);
+}
+
+void
+NodeEventPool::release(void * m)
+{
+	if(!m) return;
+	Header * h = header(m);
+	if(h->pool) {
+		h->pool->put(m);
+	} else {
+		free(h);
+	}
+}
+
+} // namespace flow
+} // namespace oflux
@@ -0,0 +1,110 @@
+#ifndef OFLUX_FLOW_NODE_POOL
+#define OFLUX_FLOW_NODE_POOL
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file OFluxFlowNodePool.h
+ * @author Mark Pichora
+ * Per flow node event memory pool.  All of the events created for a
+ * particular node have the same concrete type (hence the same size), so
+ * the memory of a retired event is kept on a thread local free list and
+ * recycled for the next event created on that node.
+ */
+
+#include <cstdlib>
+#include <algorithm>
+#include "OFluxAllocator.h"
+#include "lockfree/OFluxDistributedCounter.h"
+
+namespace oflux {
+namespace flow {
+
+/**
+ * @class NodeEventPool
+ * @brief free list allocator for the events of a single flow node
+ * Each block carries a small header which names its owning pool (NULL
+ * for blocks which came straight from the heap), so that 
+ * EventBase::operator delete can return the memory to the right place.
+ * Each thread caches the free blocks of every pool it touches (one slot
+ * per pool, indexed by the pool's dense index so that no two live pools
+ * share a slot) and only falls back to malloc/free on a miss or when its
+ * cache for that pool is full.
+ */
+class NodeEventPool : public AllocatorImplementation {
+public:
+	enum    { Thread_Cache_Slots = 64 // initial slots (grown on demand)
+		, Thread_Cache_Max_Elements = 256
+		};
+	union Header {
+		NodeEventPool * pool; // when handed out
+		Header *        next; // when on a free list
+		char            _align[2*sizeof(void *)];
+	};
+
+	NodeEventPool();
+	virtual ~NodeEventPool();
+
+	/**
+	 * @brief set the element size this pool hands out (fixed per node)
+	 * @return this pool (suitable for constructing an Allocator<T>)
+	 */
+	inline AllocatorImplementation * sized(size_t el_sz)
+	{
+		_el_sz = el_sz;
+		return this;
+	}
+	virtual void * get();
+	virtual void put(void *);
+
+	/**
+	 * @brief allocate a block (with a NULL pool header) from the heap
+	 */
+	static void * heap_get(size_t sz);
+	/**
+	 * @brief return a block to its owner pool (or the heap)
+	 */
+	static void release(void * m);
+
+	inline long long hits() const { return _hits.value(); }
+	inline long long misses() const { return _misses.value(); }
+	/**
+	 * @brief the slot of this pool in each thread's cache
+	 * Indices of destroyed pools are reused, so they stay below the 
+	 * number of pools alive at once (not the number ever created).
+	 */
+	inline size_t index() const { return _index; }
+protected:
+	static inline Header * header(void * m)
+	{ return reinterpret_cast<Header *>(m) - 1; }
+	static inline void * element(Header * h)
+	{ return h + 1; }
+private:
+	size_t _el_sz;
+	size_t _index;   // dense, reused once this pool is destroyed
+	size_t _pool_id; // unique (tells a reused slot from its last owner)
+	oflux::lockfree::Counter<long long> _hits; // recycled from a free list
+	oflux::lockfree::Counter<long long> _misses; // went to the heap
+
+	static size_t _last_pool_id;
+};
+
+} // namespace flow
+} // namespace oflux
+
+#endif // OFLUX_FLOW_NODE_POOL
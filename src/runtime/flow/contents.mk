@@ -1 +1,3 @@
 $(info Reading contents.mk $(COMPONENT_DIR))
+
+OFluxFlowNodePool.o OFluxFlowNodePool.pic.o : CXXFLAGS += $(GCC_G_DEBUG_OPT_TLSUSER)
@@ -25,9 +25,15 @@
  * whose sum represents the overall value of the counter.  This is done
  * so that each thread can quickly increment the counter, and not pay
  * any contention penalty on the changes.
+ * Threads with an index below num_threads (by default the 
+ * Max_Threads_Conserve threads which the lock-free runtime supports) each
+ * own a cache line padded slot.  The other runtimes do not cap their 
+ * thread counts, so threads with a larger index share a few extra slots
+ * which they update atomically.
  */
 
 #include <cstdlib>
+#include <algorithm>
 #include "lockfree/OFluxThreadNumber.h"
 #include "lockfree/OFluxMachineSpecific.h"
 
@@ -36,53 +42,88 @@ namespace oflux {
 namespace lockfree {
 
 template< typename CT
-	, size_t num_threads=MachineSpecific::Max_Threads_Liberal>
+	, size_t num_threads=MachineSpecific::Max_Threads_Conserve>
 class Counter {
 public:
+	enum { Shared_Slots = 8 };
+
 	Counter()
 	{
-		for(size_t i = 0; i < num_threads; ++i) {
-			_v[i] = 0;
+		for(size_t i = 0; i < num_threads + Shared_Slots; ++i) {
+			_v[i].v = 0;
 		}
 	}
 	Counter(const CT & ct)
 	{
-		for(size_t i = 0; i < num_threads; ++i) {
-			_v[i] = 0;
+		for(size_t i = 0; i < num_threads + Shared_Slots; ++i) {
+			_v[i].v = 0;
 		}
-		_v[0] = ct;
+		_v[0].v = ct;
 	}	
 	CT operator+=(CT by) { // add by
-		return _v[_tn.index] += by;
+		return owned() 
+			? slot().v += by 
+			: __sync_add_and_fetch(&slot().v,by);
 	}
 	CT operator-=(CT by) { // subtract by
-		return _v[_tn.index] -= by;
+		return owned() 
+			? slot().v -= by 
+			: __sync_sub_and_fetch(&slot().v,by);
 	}
 	CT operator++(int) { // pre inc
-		return ++_v[_tn.index];
+		return owned() 
+			? ++slot().v 
+			: __sync_add_and_fetch(&slot().v,1);
 	}
 	CT operator++() { // post inc
-		return _v[_tn.index]++;
+		return owned() 
+			? slot().v++ 
+			: __sync_fetch_and_add(&slot().v,1);
 	}
 	CT operator--(int) { // pre dec
-		return --_v[_tn.index];
+		return owned() 
+			? --slot().v 
+			: __sync_sub_and_fetch(&slot().v,1);
 	}
 	CT operator--() { // post dec
-		return _v[_tn.index]--;
+		return owned() 
+			? slot().v-- 
+			: __sync_fetch_and_sub(&slot().v,1);
 	}
 	volatile CT & operator[](size_t i) {
-		return _v[i];
+		return _v[i].v;
 	}
 	CT value() const
 	{
 		CT res = 0;
 		for(size_t i = 0; i < std::min(ThreadNumber::num_threads,num_threads); ++i) {
-			res += _v[i];
+			res += _v[i].v;
+		}
+		for(size_t i = num_threads; i < num_threads + Shared_Slots; ++i) {
+			res += _v[i].v;
 		}
 		return res;
 	}
 private:
-	volatile CT _v[num_threads];
+	// each thread's slot gets a cache line of its own, so that 
+	// neighbouring threads do not false-share on increments
+	struct Slot {
+		volatile CT v;
+		char _pad[MachineSpecific::Cache_Line_Size 
+			- (sizeof(CT) % MachineSpecific::Cache_Line_Size)];
+	};
+	static inline bool owned()
+	{
+		return _tn.index < num_threads;
+	}
+	inline Slot & slot()
+	{
+		return _v[owned() 
+			? _tn.index 
+			: num_threads + (_tn.index % Shared_Slots)];
+	}
+
+	Slot _v[num_threads + Shared_Slots];
 };
 
 } // namespace lockfree
@@ -0,0 +1,119 @@
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "lockfree/OFluxEventCount.h"
+#include <time.h>
+#ifdef LINUX
+# include <unistd.h>
+# include <sys/syscall.h>
+# include <linux/futex.h>
+#endif // LINUX
+
+namespace oflux {
+namespace lockfree {
+
+#ifdef LINUX
+static inline long
+futex(volatile int * addr, int op, int val, const struct timespec * ts = NULL)
+{
+	return syscall(SYS_futex, addr, op, val, ts, NULL, 0);
+}
+#endif // LINUX
+
+EventCount::EventCount()
+	: _state(EC_Running)
+{
+#ifndef LINUX
+	oflux_mutex_init(&_lck);
+	oflux_cond_init(&_cond);
+#endif // LINUX
+}
+
+EventCount::~EventCount()
+{
+#ifndef LINUX
+	oflux_mutex_destroy(&_lck);
+	oflux_cond_destroy(&_cond);
+#endif // LINUX
+}
+
+void
+EventCount::wait()
+{
+#ifdef LINUX
+	while(_state == EC_Waiting) {
+		// returns on a wake, a signal or a changed _state
+		futex(&_state, FUTEX_WAIT_PRIVATE, EC_Waiting);
+	}
+#else // LINUX
+	oflux_mutex_lock(&_lck);
+	while(_state == EC_Waiting) {
+		oflux_cond_wait(&_cond, &_lck);
+	}
+	oflux_mutex_unlock(&_lck);
+#endif // LINUX
+	_state = EC_Running;
+}
+
+bool
+EventCount::wait(long long timeout_ns)
+{
+	struct timespec rel;
+	rel.tv_sec = timeout_ns / 1000000000LL;
+	rel.tv_nsec = timeout_ns % 1000000000LL;
+#ifdef LINUX
+	// a spurious return looks like a timeout to the caller
+	if(_state == EC_Waiting) {
+		futex(&_state, FUTEX_WAIT_PRIVATE, EC_Waiting, &rel);
+	}
+#else // LINUX
+	oflux_mutex_lock(&_lck);
+	if(_state == EC_Waiting) {
+		oflux_cond_reltimedwait(&_cond, &_lck, &rel);
+	}
+	oflux_mutex_unlock(&_lck);
+#endif // LINUX
+	// still waiting means the time ran out: withdraw before a notify()
+	return !cancel_wait();
+}
+
+bool
+EventCount::notify()
+{
+	if(!__sync_bool_compare_and_swap(&_state,EC_Waiting,EC_Notified)) {
+		return false;
+	}
+#ifdef LINUX
+	futex(&_state, FUTEX_WAKE_PRIVATE, 1);
+#else // LINUX
+	oflux_mutex_lock(&_lck);
+	oflux_cond_signal(&_cond);
+	oflux_mutex_unlock(&_lck);
+#endif // LINUX
+	return true;
+}
+
+IdleStack::IdleStack()
+	: _head(pack(0,Nil))
+{
+	for(size_t i = 0; i < Max_Entries; ++i) {
+		_next[i] = Nil;
+	}
+}
+
+} // namespace lockfree
+} // namespace oflux
@@ -0,0 +1,144 @@
+#ifndef OFLUX_EVENT_COUNT_H
+#define OFLUX_EVENT_COUNT_H
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file OFluxEventCount.h
+ * @author Mark Pichora
+ *  Parking for idle threads in the lock-free runtime.  A thread parks on
+ * its own EventCount (a futex word on Linux) and advertises itself on an
+ * IdleStack so that a waker finds a parked thread in O(1).
+ */
+
+#include "OFluxThreads.h"
+#include "lockfree/OFluxMachineSpecific.h"
+
+namespace oflux {
+namespace lockfree {
+
+/**
+ * @class EventCount
+ * @brief one thread parks here until another thread notifies it
+ * The waiter calls prepare_wait(), re-checks for work and then calls
+ * either cancel_wait() or wait().  A notify() that happens after 
+ * prepare_wait() is never lost.
+ */
+class EventCount {
+public:
+	enum 
+		{ EC_Running = 0
+		, EC_Waiting = 1
+		, EC_Notified = 2
+		};
+
+	EventCount();
+	~EventCount();
+	inline void prepare_wait()
+	{
+		_state = EC_Waiting;
+		store_load_barrier();
+	}
+	/**
+	 * @return false if a notify() got in first
+	 */
+	inline bool cancel_wait()
+	{
+		bool res = __sync_bool_compare_and_swap(
+			  &_state
+			, EC_Waiting
+			, EC_Running);
+		_state = EC_Running;
+		return res;
+	}
+	void wait();
+	/**
+	 * @brief wait() for at most timeout_ns
+	 * @return false if the time ran out first
+	 */
+	bool wait(long long timeout_ns);
+	/**
+	 * @return true if the waiter was parked (or about to park)
+	 */
+	bool notify();
+	inline bool waiting() const { return _state == EC_Waiting; }
+private:
+	volatile int _state;
+#ifndef LINUX
+	oflux_mutex_t _lck;
+	oflux_cond_t _cond;
+#endif // LINUX
+};
+
+/**
+ * @class IdleStack
+ * @brief lock-free (Treiber) stack of parked thread indices
+ * The head packs a modification tag with the top index so that a pop
+ * is not fooled when the same index is pushed back (ABA).  An index
+ * must be on the stack at most once.
+ */
+class IdleStack {
+public:
+	enum 
+		{ Max_Entries = MachineSpecific::Max_Threads_Conserve
+		, Nil = -1 
+		};
+
+	IdleStack();
+	inline void push(int i)
+	{
+		unsigned long long h;
+		unsigned long long nh;
+		do {
+			h = _head;
+			_next[i] = index(h);
+			nh = pack(tag(h)+1,i);
+		} while(!__sync_bool_compare_and_swap(&_head,h,nh));
+	}
+	inline int pop()
+	{
+		unsigned long long h;
+		unsigned long long nh;
+		int i;
+		do {
+			h = _head;
+			i = index(h);
+			if(i == Nil) {
+				return Nil;
+			}
+			nh = pack(tag(h)+1,_next[i]);
+		} while(!__sync_bool_compare_and_swap(&_head,h,nh));
+		return i;
+	}
+	inline bool empty() const { return index(_head) == Nil; }
+private:
+	static inline unsigned long long pack(unsigned int t, int i)
+	{ return (((unsigned long long)t) << 32) | (unsigned int)i; }
+	static inline int index(unsigned long long h)
+	{ return (int)(unsigned int)(h & 0xffffffffULL); }
+	static inline unsigned int tag(unsigned long long h)
+	{ return (unsigned int)(h >> 32); }
+private:
+	volatile unsigned long long _head;
+	volatile int _next[Max_Entries];
+};
+
+} // namespace lockfree
+} // namespace oflux
+
+#endif // OFLUX_EVENT_COUNT_H
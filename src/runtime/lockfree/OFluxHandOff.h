@@ -0,0 +1,86 @@
+#ifndef OFLUX_HAND_OFF_H
+#define OFLUX_HAND_OFF_H
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file OFluxHandOff.h
+ * @author Mark Pichora
+ *  When a handled event has exactly one ready successor, the worker
+ * may run it next itself instead of pushing it on its deque and
+ * popping it back (or waking a thread for it).  HandOff decides when
+ * that is allowed.
+ */
+
+#include "flow/OFluxFlowNode.h"
+#include <algorithm>
+
+namespace oflux {
+namespace lockfree {
+
+class HandOff {
+public:
+	enum { Default_Depth = 16 // successors run in a row
+	     , Critical_Execution_Gap = 100 // created but not yet run
+	     };
+
+	/**
+	 * @param depth from the configuration (0 = default, < 0 = off)
+	 */
+	HandOff(int depth)
+		: _depth(depth == 0 ? Default_Depth : std::max(depth,0))
+		, _run(0)
+	{}
+	inline int depth() const { return _depth; }
+	inline int run() const { return _run; }
+	/**
+	 * @brief may an event of fn (the only ready successor) be run next?
+	 * Not after depth() hand offs in a row (so queued events and
+	 * sources get their turn), not when a higher lane is queued here
+	 * (top_local_lane) or elsewhere (top_lane), and not when fn is over
+	 * its critical execution gap: then the event goes to the back of
+	 * the deque with the other gapped events.
+	 */
+	inline bool may(flow::Node * fn, int top_local_lane, int top_lane) const
+	{
+		if(_run >= _depth) {
+			return false;
+		}
+		if(fn->instances() - fn->executions() > Critical_Execution_Gap) {
+			return false;
+		}
+		int lane = fn->lane();
+		return lane >= top_local_lane && lane >= top_lane;
+	}
+	/**
+	 * @brief a handed off event is run
+	 */
+	inline void handed() { ++_run; }
+	/**
+	 * @brief a queued event is run
+	 */
+	inline void queued() { _run = 0; }
+private:
+	int _depth; // 0 when hand offs are off
+	int _run;   // hand offs since the last queued event ran
+};
+
+} // namespace lockfree
+} // namespace oflux
+
+#endif // OFLUX_HAND_OFF_H
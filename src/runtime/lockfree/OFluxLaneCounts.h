@@ -0,0 +1,89 @@
+#ifndef OFLUX_LANE_COUNTS_H
+#define OFLUX_LANE_COUNTS_H
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file OFluxLaneCounts.h
+ * @author Mark Pichora
+ *  Runtime-wide counts of the events queued (on any thread) in each
+ * priority lane above 0, so that a thread can tell a higher lane is
+ * waiting elsewhere.  Until a flow with prioritized nodes is loaded
+ * top() reads none of the (contended) counts.
+ */
+
+#include "flow/OFluxFlowNode.h"
+
+namespace oflux {
+namespace lockfree {
+
+class LaneCounts {
+public:
+	enum { Lanes = flow::Node::Priority_Lanes };
+
+	LaneCounts()
+		: _enabled(false)
+	{
+		for(int i = 0; i < Lanes; ++i) {
+			_queued[i].n = 0;
+		}
+	}
+	/**
+	 * @brief a flow with nodes above lane 0 is loaded
+	 * (before any of its events are queued)
+	 */
+	inline void enable() { _enabled = true; }
+	inline bool enabled() const { return _enabled; }
+	/**
+	 * @brief count events entering (n > 0) or leaving a lane
+	 * (lane 0 is not counted)
+	 */
+	inline void queued(int lane, long n)
+	{
+		if(lane > 0 && n) {
+			__sync_fetch_and_add(&(_queued[lane].n),n);
+		}
+	}
+	inline long queued(int lane) const { return _queued[lane].n; }
+	/**
+	 * @return the highest lane with events queued (0 if none)
+	 */
+	inline int top() const
+	{
+		if(_enabled) {
+			for(int lane = Lanes-1; lane > 0; --lane) {
+				if(_queued[lane].n > 0) {
+					return lane;
+				}
+			}
+		}
+		return 0;
+	}
+private:
+	bool _enabled; // read by every scheduler loop, rarely written
+	char _pad[64];
+	struct Count {
+		volatile long n;
+		char _pad[64 - sizeof(long)]; // one line per lane
+	} _queued[Lanes];
+};
+
+} // namespace lockfree
+} // namespace oflux
+
+#endif // OFLUX_LANE_COUNTS_H
@@ -0,0 +1,354 @@
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "lockfree/OFluxLockfreeOffload.h"
+#include "lockfree/OFluxLockfreeRunTime.h"
+#include "lockfree/OFluxThreadNumber.h"
+#include "lockfree/allocator/OFluxSMR.h"
+#include "event/OFluxEventBase.h"
+#include "event/OFluxEventOperations.h"
+#include "atomic/OFluxAtomicHolder.h"
+#include "flow/OFluxFlowNode.h"
+#include "OFluxWrappers.h"
+#include "OFluxTrace.h"
+#include "OFluxMetrics.h"
+#include "OFluxLogging.h"
+
+namespace oflux {
+namespace lockfree {
+
+OffloadThread::OffloadThread(OffloadPool & pool, int index)
+	: _tid(0)
+	, _pool(pool)
+	, _index(index)
+	, _evb(NULL)
+	, _executed(0)
+{
+}
+
+static void *
+OffloadThread_start_thread(void *pthis)
+{
+	OffloadThread * ot = static_cast<OffloadThread*>(pthis);
+	AutoThreadExit ate(ot->exit());
+	ThreadNumber::init(ot->index());
+	::oflux::lockfree::smr::DeferFree::init();
+	ot->start();
+	oflux_log_trace("offload thread index %d finished\n",ot->index());
+	return NULL;
+}
+
+int
+OffloadThread::create(size_t stack_size)
+{
+	_exit.started();
+	int rc = oflux_create_thread(
+		  stack_size
+		, OffloadThread_start_thread
+		, this
+		, &_tid);
+	if(rc != 0) {
+		_exit.done();
+	}
+	return rc;
+}
+
+void
+OffloadThread::start()
+{
+	RunTime::_thread = this; // thread local reference
+	trace::attach(_index); // indexed after the workers
+	_pool.runtime().housekeeping_cpus().pin();
+	EventBaseSharedPtr ev;
+	while(_pool.next(ev)) {
+		handle(ev);
+		ev.reset();
+		_pool.done();
+	}
+}
+
+void
+OffloadThread::handle(EventBaseSharedPtr & ev)
+{
+	_evb = ev.get();
+	_successor_events.clear();
+	_successor_events_released.clear();
+	oflux_log_trace("[" PTHREAD_PRINTF_FORMAT "] OffloadThread::handle() on %s %p\n"
+		, oflux_self()
+		, _evb->flow_node()->getName()
+		, _evb);
+	assert(ev->state != 5 && "detect double execution");
+	OFLUX_TRACE(K_exec_begin,_evb,0);
+	int return_code = ev->execute();
+	OFLUX_TRACE(K_exec_end,_evb,return_code);
+	++_executed;
+	if(!return_code && ev->waiting()) {
+		ev->state = 6;
+		if(ev->wait_fd() >= 0) {
+			// suspended on an fd: the reactor re-runs it on a worker
+			_pool.runtime().reactor().suspend(ev);
+		} else {
+			// suspended until a deadline: a worker's Timers hold it
+#ifdef SHARED_PTR_EVENTS
+			_successor_events.push_back(ev);
+			ev.reset();
+#else  // SHARED_PTR_EVENTS
+			_successor_events.push_back(ev.recover());
+			assert(_successor_events.back() && "suspended event should be held only here");
+#endif // SHARED_PTR_EVENTS
+			_pool.complete(_successor_events);
+			_successor_events.clear();
+		}
+		_evb = NULL;
+		return;
+	}
+	ev->clear_wait();
+	ev->state = 5;
+	// timed source launches go back as well (marked not_before()):
+	// the worker that takes them arms them on its Timers
+	if(return_code) {
+		event::successors_on_error(
+			  _successor_events
+			, ev
+			, return_code
+			, &_successor_events);
+	} else {
+		event::successors_on_no_error(
+			  _successor_events
+			, ev
+			, &_successor_events);
+	}
+#ifdef SHARED_PTR_EVENTS
+	ev->atomics().release(_successor_events_released,ev);
+#else  // SHARED_PTR_EVENTS
+	ev->atomics().release(_successor_events_released,_evb);
+#endif // SHARED_PTR_EVENTS
+	for(size_t i = 0; i < _successor_events_released.size(); ++i) {
+		EventBasePtr & succ_ev = _successor_events_released[i];
+		if(succ_ev->atomics().acquire_all_or_wait(succ_ev)) {
+			_successor_events.push_back(succ_ev);
+		} else {
+			OFLUX_TRACE(K_guard_wait,get_EventBasePtr(succ_ev),0);
+		}
+	}
+	_pool.complete(_successor_events);
+	_successor_events.clear();
+	_successor_events_released.clear();
+	_evb = NULL;
+}
+
+void
+OffloadThread::submitEvents(const std::vector<EventBasePtr> & evs)
+{
+	_pool.complete(evs);
+}
+
+void
+OffloadThread::log_snapshot()
+{
+	oflux_log_info("offload thread %d (pthread %lu) run:%lu %s %p\n"
+		, _index
+		, _tid
+		, _executed
+		, _evb ? _evb->flow_node()->getName() : "<null>"
+		, _evb);
+}
+
+void
+OffloadThread::metrics_snapshot(metrics::Snapshot & s)
+{
+	metrics::Labels l;
+	l.add("thread",(long long)_index).add("kind","offload");
+	s.counter("oflux_thread_events_run_total","events run by the thread")
+		.add(l,_executed);
+}
+
+OffloadPool::OffloadPool(RunTime & rt)
+	: _rt(rt)
+	, _completed_count(0)
+	, _in_flight(0)
+	, _request_stop(false)
+{
+	oflux_mutex_init(&_lck);
+	oflux_cond_init(&_cond);
+}
+
+OffloadPool::~OffloadPool()
+{
+	stop();
+	oflux_mutex_destroy(&_lck);
+	oflux_cond_destroy(&_cond);
+}
+
+void
+OffloadPool::start(int first_index, int num_threads, size_t stack_size)
+{
+	for(int i = 0; i < num_threads; ++i) {
+		OffloadThread * ot = new OffloadThread(*this,first_index+i);
+		_threads.push_back(ot);
+		if(ot->create(stack_size) != 0) {
+			oflux_log_error("OffloadPool::start() failed to create "
+				"offload thread %d\n"
+				, first_index+i);
+			_threads.pop_back();
+			delete ot;
+			break;
+		}
+	}
+}
+
+void
+OffloadPool::wait_for_exit(OffloadThread * ot)
+{
+	// cancelling a thread in arbitrary node code (holding guards, 
+	// mutexes or stdio/malloc locks) is not safe, and it uses this pool
+	// until it is done, so it is waited on however long that takes
+	while(!ot->exit().wait(Stop_Wait_Ms)) {
+		oflux_log_warn("OffloadPool::stop() offload thread %d is stuck "
+			"in %s, still waiting\n"
+			, ot->index()
+			, ot->thisEvent() 
+				? ot->thisEvent()->flow_node()->getName() 
+				: "<null>");
+	}
+}
+
+void
+OffloadPool::stop()
+{
+	std::vector<EventBaseSharedPtr> unrun;
+	{
+		AutoLock al(&_lck);
+		_request_stop = true;
+		unrun.insert(unrun.end(),_submitted.begin(),_submitted.end());
+		_submitted.clear();
+		oflux_cond_broadcast(&_cond);
+	}
+	__sync_fetch_and_sub(&_in_flight,(int)unrun.size());
+	// the threads are detached: wait on each to finish
+	for(size_t i = 0; i < _threads.size(); ++i) {
+		wait_for_exit(_threads[i]);
+		delete _threads[i];
+	}
+	_threads.clear();
+	{
+		AutoLock al(&_lck);
+		for(size_t i = 0; i < _completed.size(); ++i) {
+			unrun.push_back(mk_EventBaseSharedPtr(_completed[i]));
+		}
+		_completed.clear();
+		_completed_count = 0;
+	}
+	event::drop_unrun(unrun);
+}
+
+void
+OffloadPool::submit(const EventBaseSharedPtr & ev)
+{
+	__sync_fetch_and_add(&_in_flight,1);
+	AutoLock al(&_lck);
+	_submitted.push_back(ev);
+	++_stats.submitted;
+	if(_submitted.size() > _stats.max_queued) {
+		_stats.max_queued = _submitted.size();
+	}
+	oflux_cond_signal(&_cond);
+}
+
+bool
+OffloadPool::next(EventBaseSharedPtr & ev)
+{
+	AutoLock al(&_lck);
+	while(!_request_stop && _submitted.empty()) {
+		oflux_cond_wait(&_cond,&_lck);
+	}
+	if(_request_stop) {
+		return false;
+	}
+	ev = _submitted.front();
+	_submitted.pop_front();
+	return true;
+}
+
+void
+OffloadPool::complete(const std::vector<EventBasePtr> & evs)
+{
+	if(evs.empty()) {
+		return;
+	}
+	{
+		AutoLock al(&_lck);
+		_completed.insert(_completed.end(),evs.begin(),evs.end());
+		_completed_count = _completed.size();
+	}
+	_rt.wake_threads(1); // someone has to drain these
+}
+
+void
+OffloadPool::take_completions(std::vector<EventBasePtr> & evs)
+{
+	AutoLock al(&_lck);
+	evs.insert(evs.end(),_completed.begin(),_completed.end());
+	_completed.clear();
+	_completed_count = 0;
+}
+
+void
+OffloadPool::log_snapshot()
+{
+	size_t queued = 0;
+	{
+		AutoLock al(&_lck);
+		queued = _submitted.size();
+	}
+	oflux_log_info("offload nthrs:%zu queued:%zu in-flight:%d completed:%d submitted:%lu max-queued:%lu\n"
+		, _threads.size()
+		, queued
+		, _in_flight
+		, _completed_count
+		, _stats.submitted
+		, _stats.max_queued);
+	for(size_t i = 0; i < _threads.size(); ++i) {
+		_threads[i]->log_snapshot();
+	}
+}
+
+void
+OffloadPool::metrics_snapshot(metrics::Snapshot & s)
+{
+	metrics::Labels l;
+	size_t queued = 0;
+	{
+		AutoLock al(&_lck);
+		queued = _submitted.size();
+	}
+	s.gauge("oflux_offload_threads","offload threads").add(l,_threads.size());
+	s.gauge("oflux_offload_queued","detached events waiting for an "
+		"offload thread").add(l,queued);
+	s.gauge("oflux_offload_in_flight","detached events submitted and "
+		"not yet completed").add(l,_in_flight);
+	s.counter("oflux_offload_submitted_total","detached events submitted")
+		.add(l,_stats.submitted);
+	s.gauge("oflux_offload_max_queued","most detached events queued")
+		.add(l,_stats.max_queued);
+	for(size_t i = 0; i < _threads.size(); ++i) {
+		_threads[i]->metrics_snapshot(s);
+	}
+}
+
+} // namespace lockfree
+} // namespace oflux
@@ -0,0 +1,138 @@
+#ifndef OFLUX_LF_OFFLOAD
+#define OFLUX_LF_OFFLOAD
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file OFluxLockfreeOffload.h
+ * @author Mark Pichora
+ *   Offload pool for the lock-free runtime.  Events of detached nodes 
+ * (which may block) are run on these threads rather than on the 
+ * work-stealing workers.  Their successors are handed back to the 
+ * workers when the node completes.
+ */
+
+#include "OFlux.h"
+#include "OFluxThreads.h"
+#include "OFluxWrappers.h"
+#include "OFluxRunTimeThreadAbstract.h"
+#include <vector>
+#include <deque>
+
+namespace oflux {
+namespace metrics {
+ class Snapshot;
+} // namespace metrics
+namespace lockfree {
+
+class RunTime;
+class OffloadPool;
+
+/**
+ * @class OffloadThread
+ * @brief a thread which runs detached events for an OffloadPool
+ */
+class OffloadThread : public ::oflux::RunTimeThreadAbstract {
+public:
+	OffloadThread(OffloadPool & pool, int index);
+	void start();
+	int create(size_t stack_size);
+	virtual bool is_detached() { return true; }
+	virtual void set_detached(bool) {}
+	virtual void wait_state(RTT_WaitState) {}
+	virtual oflux_thread_t tid() { return _tid; }
+	virtual void submitEvents(const std::vector<EventBasePtr> &);
+	virtual EventBase * thisEvent() const { return _evb; }
+	int index() const { return _index; }
+	inline ThreadExit & exit() { return _exit; }
+	void log_snapshot();
+	void metrics_snapshot(metrics::Snapshot & s);
+private:
+	void handle(EventBaseSharedPtr & ev);
+public:
+	oflux_thread_t _tid;
+private:
+	OffloadPool & _pool;
+	int _index;
+	EventBase * _evb; // event being run
+	std::vector<EventBasePtr> _successor_events;
+	std::vector<EventBasePtr> _successor_events_released;
+	unsigned long _executed;
+	ThreadExit _exit;
+};
+
+/**
+ * @class OffloadPool
+ * @brief queue of detached events and the threads that run them
+ * Submission is guarded by a mutex and condition variable (offloaded
+ * work is expected to block anyway).  Completed successor events are 
+ * collected for the workers to drain into their own deques.
+ */
+class OffloadPool {
+public:
+	enum 
+		{ Default_Offload_Threads = 2
+		, Stop_Wait_Ms = 2000 // between reports of a stuck thread
+		};
+
+	OffloadPool(RunTime & rt);
+	~OffloadPool();
+	/**
+	 * @brief create num_threads offload threads (indexed from first_index)
+	 */
+	void start(int first_index, int num_threads, size_t stack_size);
+	void stop();
+	inline bool enabled() const { return _threads.size() > 0; }
+	void submit(const EventBaseSharedPtr & ev);
+	void complete(const std::vector<EventBasePtr> & evs);
+	inline bool has_completions() const { return _completed_count > 0; }
+	/**
+	 * @brief move all completed successor events into evs
+	 */
+	void take_completions(std::vector<EventBasePtr> & evs);
+	inline bool busy() const { return _in_flight > 0; }
+	inline RunTime & runtime() { return _rt; }
+	void log_snapshot();
+	void metrics_snapshot(metrics::Snapshot & s);
+protected:
+	friend class OffloadThread;
+	bool next(EventBaseSharedPtr & ev); // blocks; false means stop
+	void done() { __sync_fetch_and_sub(&_in_flight,1); }
+private:
+	void wait_for_exit(OffloadThread * ot);
+private:
+	RunTime & _rt;
+	oflux_mutex_t _lck;
+	oflux_cond_t _cond;
+	std::deque<EventBaseSharedPtr> _submitted;
+	std::vector<EventBasePtr> _completed;
+	volatile int _completed_count;
+	volatile int _in_flight; // submitted but not yet completed
+	bool _request_stop;
+	std::vector<OffloadThread *> _threads;
+	struct Stats {
+		Stats() : submitted(0), max_queued(0) {}
+		unsigned long submitted;
+		unsigned long max_queued;
+	} _stats;
+};
+
+} // namespace lockfree
+} // namespace oflux
+
+#endif // OFLUX_LF_OFFLOAD
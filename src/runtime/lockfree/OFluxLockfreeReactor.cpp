@@ -0,0 +1,507 @@
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "lockfree/OFluxLockfreeReactor.h"
+#include "lockfree/OFluxLockfreeRunTime.h"
+#include "lockfree/OFluxThreadNumber.h"
+#include "lockfree/allocator/OFluxSMR.h"
+#include "event/OFluxEventBase.h"
+#include "flow/OFluxFlowNode.h"
+#include "OFluxWrappers.h"
+#include "OFluxTimerWheel.h"
+#include "OFluxMetrics.h"
+#include "OFluxLogging.h"
+#include <unistd.h>
+#include <algorithm>
+#include <errno.h>
+#ifdef LINUX
+# include <sys/epoll.h>
+# include <sys/eventfd.h>
+#endif // LINUX
+#ifdef HAS_LIBURING
+# include <poll.h>
+# include <liburing.h>
+#endif // HAS_LIBURING
+
+namespace oflux {
+namespace lockfree {
+
+#ifdef LINUX
+
+/**
+ * @class EpollReactorBackend
+ * @brief arms each fd with EPOLLONESHOT and removes it once it fires
+ * (so a later suspension on the same fd can add it again).  Two events
+ * may not wait on the same fd at once: the second add() fails.
+ */
+class EpollReactorBackend : public ReactorBackend {
+public:
+	EpollReactorBackend()
+		: _epfd(epoll_create1(EPOLL_CLOEXEC))
+		, _wakefd(eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC))
+	{
+		struct epoll_event e;
+		e.events = EPOLLIN;
+		e.data.ptr = NULL; // the wakeup token
+		if(_epfd >= 0 && _wakefd >= 0) {
+			epoll_ctl(_epfd,EPOLL_CTL_ADD,_wakefd,&e);
+		}
+	}
+	virtual ~EpollReactorBackend()
+	{
+		if(_wakefd >= 0) close(_wakefd);
+		if(_epfd >= 0) close(_epfd);
+	}
+	bool ok() const { return _epfd >= 0 && _wakefd >= 0; }
+	virtual const char * name() const { return "epoll"; }
+	virtual bool add(int fd, int events, void * token)
+	{
+		struct epoll_event e;
+		e.events = EPOLLONESHOT
+			| (events & Reactor::Read ? (EPOLLIN|EPOLLRDHUP) : 0)
+			| (events & Reactor::Write ? (uint32_t)EPOLLOUT : 0);
+		e.data.ptr = token;
+		return epoll_ctl(_epfd,EPOLL_CTL_ADD,fd,&e) == 0;
+	}
+	virtual int wait(void ** tokens, int max_tokens)
+	{
+		struct epoll_event es[Reactor::Max_Ready_Batch];
+		int n = epoll_wait(_epfd,es
+			, std::min(max_tokens,(int)Reactor::Max_Ready_Batch)
+			, -1);
+		if(n < 0) {
+			return (errno == EINTR ? 0 : -1);
+		}
+		int nt = 0;
+		for(int i = 0; i < n; ++i) {
+			if(es[i].data.ptr == NULL) {
+				uint64_t dontcare;
+				ssize_t res __attribute__((unused)) =
+					read(_wakefd,&dontcare,sizeof(dontcare));
+			} else {
+				tokens[nt++] = es[i].data.ptr;
+			}
+		}
+		return nt;
+	}
+	virtual void fired(int fd)
+	{
+		struct epoll_event e; // non-NULL for old kernels
+		epoll_ctl(_epfd,EPOLL_CTL_DEL,fd,&e);
+	}
+	virtual void wakeup()
+	{
+		uint64_t one = 1;
+		ssize_t res __attribute__((unused)) =
+			write(_wakefd,&one,sizeof(one));
+	}
+private:
+	int _epfd;
+	int _wakefd;
+};
+
+#endif // LINUX
+
+#ifdef HAS_LIBURING
+
+/**
+ * @class UringReactorBackend
+ * @brief one-shot IORING_OP_POLL_ADD requests
+ * Submission is serialized with _lck; only the reactor thread reaps
+ * completions.
+ */
+class UringReactorBackend : public ReactorBackend {
+public:
+	enum { Ring_Entries = 256 };
+
+	UringReactorBackend()
+		: _ok(false)
+		, _wakefd(eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC))
+	{
+		oflux_mutex_init(&_lck);
+		_ok = (_wakefd >= 0
+			&& io_uring_queue_init(Ring_Entries,&_ring,0) == 0);
+		if(_ok) {
+			arm_wakeup();
+		}
+	}
+	virtual ~UringReactorBackend()
+	{
+		if(_ok) io_uring_queue_exit(&_ring);
+		if(_wakefd >= 0) close(_wakefd);
+		oflux_mutex_destroy(&_lck);
+	}
+	bool ok() const { return _ok; }
+	virtual const char * name() const { return "io_uring"; }
+	virtual bool add(int fd, int events, void * token)
+	{
+		AutoLock al(&_lck);
+		return submit_poll(fd
+			, (events & Reactor::Read ? (POLLIN|POLLRDHUP) : 0)
+			  | (events & Reactor::Write ? POLLOUT : 0)
+			, token);
+	}
+	virtual int wait(void ** tokens, int max_tokens)
+	{
+		struct io_uring_cqe * cqe = NULL;
+		int res = io_uring_wait_cqe(&_ring,&cqe);
+		if(res < 0) {
+			return (res == -EINTR ? 0 : -1);
+		}
+		int nt = 0;
+		do {
+			void * token = io_uring_cqe_get_data(cqe);
+			io_uring_cqe_seen(&_ring,cqe);
+			if(token == &_wakefd) {
+				uint64_t dontcare;
+				ssize_t rres __attribute__((unused)) =
+					read(_wakefd,&dontcare,sizeof(dontcare));
+				AutoLock al(&_lck);
+				arm_wakeup();
+			} else {
+				tokens[nt++] = token;
+			}
+		} while(nt < max_tokens
+			&& io_uring_peek_cqe(&_ring,&cqe) == 0);
+		return nt;
+	}
+	virtual void wakeup()
+	{
+		uint64_t one = 1;
+		ssize_t res __attribute__((unused)) =
+			write(_wakefd,&one,sizeof(one));
+	}
+private:
+	bool submit_poll(int fd, unsigned poll_mask, void * token)
+	{
+		struct io_uring_sqe * sqe = io_uring_get_sqe(&_ring);
+		if(!sqe) {
+			io_uring_submit(&_ring);
+			sqe = io_uring_get_sqe(&_ring);
+		}
+		if(!sqe) {
+			return false;
+		}
+		io_uring_prep_poll_add(sqe,fd,poll_mask);
+		io_uring_sqe_set_data(sqe,token);
+		return io_uring_submit(&_ring) >= 0;
+	}
+	inline void arm_wakeup() { submit_poll(_wakefd,POLLIN,&_wakefd); }
+private:
+	bool _ok;
+	int _wakefd;
+	oflux_mutex_t _lck;
+	struct io_uring _ring;
+};
+
+#endif // HAS_LIBURING
+
+ReactorBackend *
+ReactorBackend::create()
+{
+#ifdef HAS_LIBURING
+	UringReactorBackend * urb = new UringReactorBackend();
+	if(urb->ok()) {
+		return urb;
+	}
+	delete urb;
+#endif // HAS_LIBURING
+#ifdef LINUX
+	EpollReactorBackend * erb = new EpollReactorBackend();
+	if(erb->ok()) {
+		return erb;
+	}
+	delete erb;
+#endif // LINUX
+	return NULL;
+}
+
+Reactor * Reactor::_running = NULL;
+
+Reactor::Reactor(RunTime & rt)
+	: _rt(rt)
+	, _backend(NULL)
+	, _tid(0)
+	, _index(0)
+	, _thread_started(false)
+	, _request_stop(false)
+	, _waiters(NULL)
+	, _ready_count(0)
+	, _waiting(0)
+{
+	oflux_mutex_init(&_lck);
+}
+
+Reactor::~Reactor()
+{
+	stop();
+	oflux_mutex_destroy(&_lck);
+}
+
+static void *
+Reactor_start_thread(void * pthis)
+{
+	Reactor * r = static_cast<Reactor *>(pthis);
+	AutoThreadExit ate(r->exit());
+	ThreadNumber::init(r->index()); // own hazard pointer slots
+	::oflux::lockfree::smr::DeferFree::init();
+	r->run();
+	oflux_log_trace("reactor thread finished\n");
+	return NULL;
+}
+
+void
+Reactor::start(int index, size_t stack_size)
+{
+	if(index >= DEFAULT_MEMPOOL_MAX_THREADS) {
+		oflux_log_warn("Reactor::start() no thread index left for "
+			"the reactor (suspend_on_fd() is not available)\n");
+		return;
+	}
+	_index = index;
+	_backend = ReactorBackend::create();
+	if(!_backend) {
+		oflux_log_warn("Reactor::start() no reactor backend "
+			"(suspend_on_fd() is not available)\n");
+		return;
+	}
+	_request_stop = false;
+	_exit.started();
+	if(oflux_create_thread(
+			  stack_size
+			, Reactor_start_thread
+			, this
+			, &_tid) != 0) {
+		_exit.done();
+		oflux_log_error("Reactor::start() failed to create "
+			"the reactor thread\n");
+		delete _backend;
+		_backend = NULL;
+		return;
+	}
+	_thread_started = true;
+	_running = this;
+	oflux_log_info("Reactor::start() using %s\n",_backend->name());
+}
+
+void
+Reactor::stop()
+{
+	if(_running == this) {
+		_running = NULL;
+	}
+	if(_thread_started) {
+		_request_stop = true;
+		// the thread only blocks in the backend's wait(), which the
+		// wake up ends (it stays pending if the thread is not there
+		// yet); it uses this reactor and the runtime until it exits,
+		// so it is waited on however long that takes
+		_backend->wakeup();
+		while(!_exit.wait(Stop_Wait_Ms)) {
+			oflux_log_warn("Reactor::stop() reactor thread "
+				"has not finished, still waiting\n");
+			_backend->wakeup();
+		}
+		_thread_started = false;
+	}
+	AutoLock al(&_lck);
+	while(_waiters) { // still parked: never to be run
+		Waiter * w = _waiters;
+		unlink(w);
+		delete w;
+	}
+	_waiting = 0;
+	_ready.clear();
+	_ready_count = 0;
+	delete _backend;
+	_backend = NULL;
+}
+
+void
+Reactor::link(Waiter * w)
+{
+	w->prev = NULL;
+	w->next = _waiters;
+	if(_waiters) {
+		_waiters->prev = w;
+	}
+	_waiters = w;
+}
+
+void
+Reactor::unlink(Waiter * w)
+{
+	if(w->prev) {
+		w->prev->next = w->next;
+	} else {
+		_waiters = w->next;
+	}
+	if(w->next) {
+		w->next->prev = w->prev;
+	}
+}
+
+void
+Reactor::suspend(EventBaseSharedPtr & ev)
+{
+	int fd = ev->wait_fd();
+	int events = ev->wait_events();
+	Waiter * w = new Waiter();
+	w->ev.swap(ev);
+	{
+		AutoLock al(&_lck);
+		link(w); // before add(): it may fire right away
+		++_stats.suspended;
+		int n = __sync_add_and_fetch(&_waiting,1);
+		if(n > _stats.max_waiting) {
+			_stats.max_waiting = n;
+		}
+	}
+	oflux_log_trace("[" PTHREAD_PRINTF_FORMAT "] Reactor::suspend() %s %p on fd %d\n"
+		, oflux_self()
+		, w->ev->flow_node()->getName()
+		, w->ev.get()
+		, fd);
+	if(_backend && _backend->add(fd,events,w)) {
+		return;
+	}
+	int err = (_backend ? errno : 0); // 0: no backend to retry on
+	if(err == EEXIST) {
+		// another event waits on fd: re-run this one (from a
+		// worker's Timers) a little later rather than spin
+		oflux_log_trace("Reactor::suspend() fd %d is busy, "
+			"%s retries later\n"
+			, fd
+			, w->ev->flow_node()->getName());
+		__sync_fetch_and_add(&_stats.busy,1);
+		w->ev->clear_wait();
+		w->ev->wait_until(TimerWheel::now_ns() + Busy_Fd_Retry_Ns);
+	} else {
+		oflux_log_warn("Reactor::suspend() could not wait on "
+			"fd %d for %s (errno %d), re-running it\n"
+			, fd
+			, w->ev->flow_node()->getName()
+			, err);
+		__sync_fetch_and_add(&_stats.failed,1);
+	}
+	make_ready(&w,1);
+}
+
+void
+Reactor::make_ready(Waiter ** ws, int n)
+{
+	{
+		AutoLock al(&_lck);
+		for(int i = 0; i < n; ++i) {
+			Waiter * w = ws[i];
+			unlink(w);
+			if(w->ev->wait_fd() >= 0) {
+				w->ev->clear_wait();
+			} // else retried later (see suspend())
+#ifdef SHARED_PTR_EVENTS
+			EventBasePtr ev = w->ev;
+#else  // SHARED_PTR_EVENTS
+			EventBasePtr ev = w->ev.recover();
+			assert(ev && "suspended event should be held only here");
+#endif // SHARED_PTR_EVENTS
+			_ready.push_back(ev);
+			delete w;
+		}
+		_ready_count = _ready.size();
+	}
+	__sync_fetch_and_sub(&_waiting,n);
+	_rt.wake_threads(1); // someone has to drain these
+}
+
+void
+Reactor::take_ready(std::vector<EventBasePtr> & evs)
+{
+	AutoLock al(&_lck);
+	evs.insert(evs.end(),_ready.begin(),_ready.end());
+	_ready.clear();
+	_ready_count = 0;
+}
+
+void
+Reactor::run()
+{
+	void * tokens[Max_Ready_Batch];
+	_rt.housekeeping_cpus().pin();
+	while(!_request_stop) {
+		int n = _backend->wait(tokens,Max_Ready_Batch);
+		++_stats.wakeups;
+		if(n < 0) {
+			oflux_log_error("Reactor::run() %s wait failed (errno %d)\n"
+				, _backend->name()
+				, errno);
+			break;
+		}
+		for(int i = 0; i < n; ++i) {
+			_backend->fired(static_cast<Waiter *>(tokens[i])->ev->wait_fd());
+		}
+		if(n > 0) {
+			make_ready(reinterpret_cast<Waiter **>(tokens),n);
+		}
+	}
+}
+
+void
+Reactor::log_snapshot()
+{
+	oflux_log_info("reactor %s waiting:%d ready:%d suspended:%lu failed:%lu busy:%lu wakeups:%lu max-waiting:%d\n"
+		, _backend ? _backend->name() : "<none>"
+		, _waiting
+		, _ready_count
+		, _stats.suspended
+		, _stats.failed
+		, _stats.busy
+		, _stats.wakeups
+		, _stats.max_waiting);
+}
+
+void
+Reactor::metrics_snapshot(metrics::Snapshot & s)
+{
+	metrics::Labels l;
+	s.gauge("oflux_reactor_waiting","events suspended on an fd")
+		.add(l,_waiting);
+	s.gauge("oflux_reactor_ready","events whose fd is ready (not yet "
+		"taken by a worker)").add(l,_ready_count);
+	s.counter("oflux_reactor_suspended_total","events ever suspended on an fd")
+		.add(l,_stats.suspended);
+	s.counter("oflux_reactor_failed_total","fds that could not be armed")
+		.add(l,_stats.failed);
+	s.counter("oflux_reactor_busy_total","suspensions retried later "
+		"since another event waited on the fd").add(l,_stats.busy);
+	s.counter("oflux_reactor_wakeups_total","reactor backend wake ups")
+		.add(l,_stats.wakeups);
+}
+
+bool
+suspend_on_fd(int fd, int events)
+{
+	RunTimeThreadAbstract * rtt = RunTime::_thread;
+	EventBase * evb = (rtt ? rtt->thisEvent() : NULL);
+	if(fd < 0 || !evb || !Reactor::running()) {
+		return false;
+	}
+	evb->wait_on(fd,events);
+	return true;
+}
+
+} // namespace lockfree
+} // namespace oflux
@@ -0,0 +1,178 @@
+#ifndef OFLUX_LF_REACTOR
+#define OFLUX_LF_REACTOR
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file OFluxLockfreeReactor.h
+ * @author Mark Pichora
+ *   I/O reactor for the lock-free runtime.  A node which would block on
+ * a file descriptor calls suspend_on_fd() and returns 0.  Its event is
+ * parked here (still holding its guards and input) and is re-run on a
+ * worker once the descriptor is ready.  The backend is io_uring when
+ * built with HAS_LIBURING (and the kernel supports it) or epoll.
+ *
+ * Use case (node ReadRequest):
+ *
+ *   ssize_t n = read(in->fd, buf, sizeof(buf));
+ *   if(n < 0 && errno == EAGAIN
+ *       && oflux::lockfree::suspend_on_fd(in->fd,Reactor::Read)) {
+ *     return 0; // re-run once in->fd is readable
+ *   }
+ */
+
+#include "OFlux.h"
+#include "OFluxThreads.h"
+#include "OFluxWrappers.h"
+#include <vector>
+
+namespace oflux {
+namespace metrics {
+ class Snapshot;
+} // namespace metrics
+namespace lockfree {
+
+class RunTime;
+
+/**
+ * @class ReactorBackend
+ * @brief one-shot readiness notification for file descriptors
+ * add() may be called from any thread; wait() only from the reactor
+ * thread.
+ */
+class ReactorBackend {
+public:
+	virtual ~ReactorBackend() {}
+	virtual const char * name() const = 0;
+	/**
+	 * @brief arm fd once for events (Reactor::Read/Write)
+	 * @return false if the fd could not be armed
+	 */
+	virtual bool add(int fd, int events, void * token) = 0;
+	/**
+	 * @brief block until some armed fds fire (or wakeup() is called)
+	 * @return the number of tokens written (-1 on a hard error)
+	 */
+	virtual int wait(void ** tokens, int max_tokens) = 0;
+	/**
+	 * @brief fd's token came back from wait() (disarm it for good)
+	 */
+	virtual void fired(int) {}
+	virtual void wakeup() = 0;
+
+	/**
+	 * @return the best backend available here (NULL if none)
+	 */
+	static ReactorBackend * create();
+};
+
+/**
+ * @class Reactor
+ * @brief events suspended on file descriptors, and the thread that
+ * waits on them.  Ready events are collected for the workers to drain
+ * into their own deques (as with OffloadPool completions).
+ */
+class Reactor {
+public:
+	enum
+		{ Read = 0x1
+		, Write = 0x2
+		};
+	enum 
+		{ Max_Ready_Batch = 64
+		, Busy_Fd_Retry_Ns = 1000000 // fd has another waiter: retry later
+		, Stop_Wait_Ms = 2000 // between reports of a stuck reactor thread
+		};
+
+	Reactor(RunTime & rt);
+	~Reactor();
+	/**
+	 * @brief start the reactor thread (with thread index index)
+	 */
+	void start(int index, size_t stack_size);
+	void stop();
+	inline bool enabled() const { return _backend != NULL; }
+	inline int index() const { return _index; }
+	inline ThreadExit & exit() { return _exit; }
+	/**
+	 * @brief park ev until its wait_fd() is ready (ev is taken)
+	 * An event that cannot be armed is made ready right away, so the
+	 * node runs again and sees the error for itself.
+	 */
+	void suspend(EventBaseSharedPtr & ev);
+	inline bool has_ready() const { return _ready_count > 0; }
+	/**
+	 * @brief move all ready events into evs
+	 */
+	void take_ready(std::vector<EventBasePtr> & evs);
+	inline bool busy() const { return _waiting > 0; }
+	void log_snapshot();
+	void metrics_snapshot(metrics::Snapshot & s);
+
+	/**
+	 * @return the started reactor (NULL when there is none)
+	 */
+	static inline Reactor * running() { return _running; }
+
+	void run(); // reactor thread body
+private:
+	struct Waiter { // on _waiters until it fires
+		EventBaseSharedPtr ev;
+		Waiter * prev;
+		Waiter * next;
+	};
+	void link(Waiter * w);
+	void unlink(Waiter * w);
+	void make_ready(Waiter ** ws, int n);
+private:
+	RunTime & _rt;
+	ReactorBackend * _backend;
+	oflux_thread_t _tid;
+	int _index;
+	bool _thread_started;
+	ThreadExit _exit;
+	volatile bool _request_stop;
+	oflux_mutex_t _lck; // guards _ready and _waiters
+	std::vector<EventBasePtr> _ready;
+	Waiter * _waiters;
+	volatile int _ready_count;
+	volatile int _waiting; // suspended and not yet ready
+	struct Stats {
+		Stats() : suspended(0), failed(0), busy(0), wakeups(0), max_waiting(0) {}
+		unsigned long suspended;
+		unsigned long failed; // could not be armed
+		unsigned long busy; // fd already had a waiter (retried later)
+		unsigned long wakeups; // returns from backend wait()
+		int max_waiting;
+	} _stats;
+
+	static Reactor * _running;
+};
+
+/**
+ * @brief suspend the current event (called from a node function)
+ * @param fd the file descriptor to wait on
+ * @param events Reactor::Read and/or Reactor::Write
+ * @return false if there is no reactor here (the node should block)
+ */
+bool suspend_on_fd(int fd, int events);
+
+} // namespace lockfree
+} // namespace oflux
+
+#endif // OFLUX_LF_REACTOR
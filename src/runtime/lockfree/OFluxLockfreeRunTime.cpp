@@ -22,6 +22,7 @@
 #include "flow/OFluxFlow.h"
 #include "xml/OFluxXML.h"
 #include "OFluxLogging.h"
+#include "OFluxTrace.h"
 #include "OFluxWrappers.h"
 #include <dlfcn.h>
 #include <signal.h>
@@ -43,7 +44,7 @@ deinitShimFnType RunTime::deinitShim = NULL;
 
 RunTime::RunTime(const RunTimeConfiguration &rtc)
 	: _rtc_ref(rtc)
-	, _rtc(rtc)
+	, _rtc(EnvironmentVar::configured(rtc))
 	, _running(false)
 	, _request_death(false)
 	, _soft_load_flow(false)
@@ -52,6 +53,12 @@ RunTime::RunTime(const RunTimeConfiguration &rtc)
 	, _active_flow(NULL)
 	, _doors(this)
 	, _doors_thread(NULL)
+	, _offload(*this)
+	, _num_offload_threads(0)
+	, _reactor(*this)
+	, _timers_armed(0)
+	, _worker_cpus(_rtc.worker_cpus)
+	, _housekeeping_cpus(_rtc.housekeeping_cpus)
 {
 	_thread = NULL;
 	oflux_log_info("oflux::lockfree::RunTime initializing\n");
@@ -80,9 +87,28 @@ RunTime::RunTime(const RunTimeConfiguration &rtc)
 			, flow()->sources_count()+1);
 		_num_threads = flow()->sources_count()+1;
 	}
+	if(_num_threads > MachineSpecific::Max_Threads_Conserve) {
+		oflux_log_warn("RunTime::RunTime() capping thread count"
+			" from %u to %u (per-thread structures limit)\n"
+			, _num_threads
+			, MachineSpecific::Max_Threads_Conserve);
+		_num_threads = MachineSpecific::Max_Threads_Conserve;
+	}
+	_num_offload_threads = (_rtc.max_detached_threads > 0
+		? _rtc.max_detached_threads
+		: OffloadPool::Default_Offload_Threads);
+	// one more thread index is kept for the reactor
+	if(_num_threads + _num_offload_threads + 1 > MachineSpecific::Max_Threads_Conserve) {
+		_num_offload_threads = std::max(0
+			, MachineSpecific::Max_Threads_Conserve - 1 - _num_threads);
+		oflux_log_warn("RunTime::RunTime() only %d offload threads"
+			" (detached nodes run on workers otherwise)\n"
+			, _num_offload_threads);
+	}
 	RunTimeThread ** rtt = &_threads;
 	for(size_t i = 0; i < (size_t)_num_threads; ++i) {
 		*rtt = new RunTimeThread(*this,i,(i ? 0 : oflux_self()));
+		_threads_by_index.push_back(*rtt);
 		rtt = &((*rtt)->_next);
 	}
 	*rtt = NULL;
@@ -94,6 +120,7 @@ RunTime::~RunTime()
 	RunTimeThread * rtt = _threads;
 	RunTimeThread * rtt_next = NULL;
 	_threads = NULL;
+	_threads_by_index.clear();
 	while(rtt) {
 		rtt_next = rtt->_next;
 		rtt->_next = NULL;
@@ -114,6 +141,10 @@ RunTime::~RunTime()
 void
 RunTime::submitEvents(const std::vector<EventBasePtr> & evs)
 {
+	if(_thread) { // a worker or offload thread
+		_thread->submitEvents(evs);
+		return;
+	}
 	size_t t_ind = _tn.index;
 	RunTimeThread * thread_ptr = _threads;
 	while(thread_ptr && evs.size()) {
@@ -186,6 +217,13 @@ RunTime::load_flow(
 		, this->flow()
 		, atomics_style());
         flow->assignMagicNumbers(); // for guard ordering
+	std::map<std::string, flow::Node *>::iterator nitr = flow->nodes().begin();
+	for(; nitr != flow->nodes().end(); ++nitr) {
+		if((*nitr).second->lane() > 0) {
+			_lane_counts.enable(); // before its events are queued
+			break;
+		}
+	}
 	// push the sources (first time)
 	if(_running) {
 		std::vector<EventBasePtr> events_vec;
@@ -222,6 +260,48 @@ RunTime::decr_sleepers()
 	__sync_fetch_and_sub(&_sleep_count,1);
 }
 
+size_t
+RunTime::steal_batch_nearest(
+	  RunTimeThread & thief
+	, std::vector<EventBasePtr> & evs
+	, size_t max_n
+	, int min_lane)
+{
+	Victims & victims = thief._victims;
+	int self = thief.index();
+	int last = victims.last();
+	size_t n = 0;
+	victims.sweep();
+	if(last >= 0) {
+		n = _threads_by_index[last]->steal_batch(evs,max_n,min_lane);
+		if(n) {
+			victims.stole_last();
+			return n;
+		}
+		victims.missed_last();
+	}
+	int cpu = thief._cpu;
+	for(int d = 0; d < _topology.levels(); ++d) {
+		int start = victims.next_random() % _num_threads;
+		for(int k = 0; k < _num_threads; ++k) {
+			int i = (start + k) % _num_threads;
+			if(i == self || i == last) {
+				continue;
+			}
+			RunTimeThread * rtt = _threads_by_index[i];
+			if(_topology.distance(cpu,rtt->_cpu) != d) {
+				continue;
+			}
+			n = rtt->steal_batch(evs,max_n,min_lane);
+			if(n) {
+				victims.stole_from(i,d);
+				return n;
+			}
+		}
+	}
+	return n;
+}
+
 struct sigaction __oldsigaction;
 volatile bool __ignore_sig_int = false;
 
@@ -249,6 +329,7 @@ static void *
 RunTimeThread_start_door_thread(void * pthis)
 {
 	RunTimeThread * rtt = static_cast<RunTimeThread*> (pthis);
+	rtt->place();
 	SetTrue keep_true_during_lifetime(rtt->_running);
 	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
 	OFLUX_DOOR_RETURN;
@@ -312,12 +393,16 @@ RunTime::start()
 	OFLUX_SET_RT_FOR_DOORS;
 	if(_doors.create_doors(RunTime_start_door_thread)) {
 	}
+	// offload threads are indexed after the workers
+	_offload.start(_num_threads,_num_offload_threads,config().stack_size);
+	_reactor.start(_num_threads+_num_offload_threads,config().stack_size);
 	// start threads > 0
 	int res = 0;
 	while(rtt) {
 		res = res || rtt->create();
 		rtt = rtt->_next;
 	}
+	_metrics.start(this,config().stack_size);
 	// start thread 0
 	this_rtt->start();
 	oflux_log_trace("thread index %d finished\n",this_rtt->index());
@@ -331,29 +416,86 @@ RunTime::start()
 		}
 		rtt = rtt->_next;
 	}
+	_metrics.stop();
+	_offload.stop();
+	_reactor.stop();
+	trace::dump(flow());
 }
 
 void
 RunTime::log_snapshot()
 {
-	oflux_log_info("RT %s %s %s nthrs:%d slp:%d\n"
+	oflux_log_info("RT %s %s %s nthrs:%d slp:%d tmr:%ld\n"
 		, _running ? "running" : "       "
 		, _request_death ? "req-death" : "         "
 		, _soft_load_flow ? "s-ld-flow" : "         "
 		, _num_threads
-		, _sleep_count);
+		, _sleep_count
+		, _timers_armed);
+	oflux_log_info("placement: workers on cpus %s housekeeping on cpus %s\n"
+		, _worker_cpus.str().c_str()
+		, _housekeeping_cpus.str().c_str());
+	oflux_log_info("lock-free allocator: allocated:%lld retired:%lld reclaimed:%lld\n"
+		, smr::stats.allocated.value()
+		, smr::stats.retired.value()
+		, smr::stats.reclaimed.value());
 	RunTimeThread * rtt = _threads;
 	while(rtt) {
 		rtt->log_snapshot();
 		rtt = rtt->_next;
 	}
+	if(_offload.enabled()) {
+		_offload.log_snapshot();
+	}
+	if(_reactor.enabled()) {
+		_reactor.log_snapshot();
+	}
+	if(flow()) {
+		flow()->log_snapshot(); // nodes (counters, latencies) and admission
+	}
 	if(_doors_thread) {
 		oflux_log_info("doors thread:\n");
 		_doors_thread->log_snapshot();
 	}
+	trace::dump(flow());
 	oflux_log_info("RTend\n");
 }
 
+void
+RunTime::metrics_snapshot(metrics::Snapshot & s)
+{
+	metrics::Labels l;
+	s.gauge("oflux_runtime_threads","runtime worker threads")
+		.add(l,_num_threads);
+	s.gauge("oflux_runtime_threads_asleep","worker threads parked")
+		.add(l,_sleep_count);
+	s.gauge("oflux_runtime_timers_armed","timed events waiting")
+		.add(l,_timers_armed);
+	s.counter("oflux_lf_allocator_allocated_total"
+		, "blocks allocated for the lock-free waiter lists and atomics")
+		.add(l,smr::stats.allocated.value());
+	s.counter("oflux_lf_allocator_retired_total"
+		, "blocks freed (reclaimed once no hazard pointer covers them)")
+		.add(l,smr::stats.retired.value());
+	s.counter("oflux_lf_allocator_reclaimed_total"
+		, "retired blocks given back to their allocator")
+		.add(l,smr::stats.reclaimed.value());
+	RunTimeThread * rtt = _threads;
+	while(rtt) {
+		rtt->metrics_snapshot(s);
+		rtt = rtt->_next;
+	}
+	if(_offload.enabled()) {
+		_offload.metrics_snapshot(s);
+	}
+	if(_reactor.enabled()) {
+		_reactor.metrics_snapshot(s);
+	}
+	if(flow()) {
+		flow()->metrics_snapshot(s);
+	}
+}
+
 void
 RunTime::log_snapshot_guard(const char *guardname)
 { 
@@ -367,7 +509,7 @@ RunTime::getPluginNames(std::vector<std::string> & result)
         if(f) f->getLibraryNames(result);
 }
 
-__thread RunTimeThread * RunTime::_thread;
+__thread RunTimeThreadAbstract * RunTime::_thread;
 
 
 } // namespace lockfree
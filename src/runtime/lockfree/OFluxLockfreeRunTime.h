@@ -30,7 +30,14 @@
 #include "OFluxConfiguration.h"
 #include "lockfree/OFluxLockfreeRunTimeThread.h"
 #include "lockfree/OFluxThreadNumber.h"
+#include "lockfree/OFluxEventCount.h"
+#include "lockfree/OFluxLockfreeOffload.h"
+#include "lockfree/OFluxLockfreeReactor.h"
+#include "lockfree/OFluxLockfreeVictims.h"
+#include "lockfree/OFluxLaneCounts.h"
 #include "OFluxDoor.h"
+#include "OFluxAffinity.h"
+#include "OFluxMetrics.h"
 #include "OFluxThreads.h"
 #include <vector>
 
@@ -65,6 +72,7 @@ public:
 	virtual const RunTimeConfiguration & config() const { return _rtc; }
 	virtual void log_snapshot();
 	virtual void log_snapshot_guard(const char *);
+	virtual void metrics_snapshot(metrics::Snapshot & s);
 	virtual void getPluginNames(std::vector<std::string> & result);
 	virtual int atomics_style() const { return 2; }
 	//
@@ -74,45 +82,63 @@ public:
 	int nonsleepers() const { return _num_threads - _sleep_count; }
 	virtual void submitEvents(const std::vector<EventBasePtr> & evs);
 	void wake_threads(int num_to_wake)
-	{ // rouse threads from their slumber
-		if(_sleep_count == 0) return; // all awake already
-		RunTimeThread * rtt = _threads;
-		while(rtt && num_to_wake > 0) {
-			if(rtt->asleep()) {
-				rtt->wake();
-				--num_to_wake;
+	{ // rouse threads from their slumber (parked ones are on _idle)
+		if(num_to_wake <= 0) return;
+		store_load_barrier(); // queued events visible before we look
+		while(num_to_wake > 0) {
+			int i = _idle.pop();
+			if(i == IdleStack::Nil) {
+				break; // all awake already
 			}
-			rtt = rtt->_next;
+			RunTimeThread * rtt = _threads_by_index[i];
+			rtt->_on_idle_stack = false;
+			if(rtt->wake()) {
+				--num_to_wake;
+			} // otherwise it was a stale entry (thread did not park)
 		}
 	}
-	EventBasePtr steal_first_random()
-	{ // do a steal sweep
-		EventBasePtr ev(NULL);
+	void push_idle(RunTimeThread * rtt) { _idle.push(rtt->index()); }
+	bool has_work() const
+	{ // is there an event queued anywhere
 		RunTimeThread * rtt = _threads;
-		int start = rand() % _num_threads;
-		int local_index = _tn.index;
 		while(rtt) {
-			if((rtt->index() >= start)
-					&& rtt->index() != local_index) {
-				ev = rtt->steal();
-				if(get_EventBasePtr(ev)) {
-					return ev;
-				}
-			}
-			rtt = rtt->_next;
-		}
-		rtt = _threads;
-		while(rtt && rtt->index() < start) {
-			if(rtt->index() != local_index) {
-				ev = rtt->steal();
-				if(get_EventBasePtr(ev)) {
-					break;
-				}
+			if(rtt->queue_size() > 0) {
+				return true;
 			}
 			rtt = rtt->_next;
 		}
-		return ev;
+		return _offload.has_completions() || _reactor.has_ready();
 	}
+	OffloadPool & offload() { return _offload; }
+	const CpuSet & worker_cpus() const { return _worker_cpus; }
+	const CpuSet & housekeeping_cpus() const { return _housekeeping_cpus; }
+	Reactor & reactor() { return _reactor; }
+	/**
+	 * @brief count timed events armed (n > 0) or fired on any thread
+	 */
+	inline void timers_armed(long n)
+	{ if(n) __sync_fetch_and_add(&_timers_armed,n); }
+	inline bool timers_busy() const { return _timers_armed > 0; }
+	/**
+	 * @brief count events entering (n > 0) or leaving a lane
+	 * (only lanes above 0 are counted)
+	 */
+	inline void lane_queued(int lane, long n) { _lane_counts.queued(lane,n); }
+	/**
+	 * @return the highest lane with events queued on any thread
+	 * (0 without reading shared counts if no flow uses lanes)
+	 */
+	inline int top_lane() const { return _lane_counts.top(); }
+	/**
+	 * @brief do a steal sweep for thief, taking a batch from the first
+	 * non-empty victim: its last victim, then the nearest threads
+	 * (see Topology), each distance swept from a random start
+	 */
+	size_t steal_batch_nearest(
+		  RunTimeThread & thief
+		, std::vector<EventBasePtr> & evs
+		, size_t max_n
+		, int min_lane = 0);
 	void load_flow(const char * filename = "", 
                    PluginSourceAbstract * pluginxmldir = 0, 
                    const char * pluginlibdir = "",
@@ -144,11 +170,22 @@ private:
 	int _num_threads;
 	int _sleep_count;
 	RunTimeThread * _threads;
+	std::vector<RunTimeThread *> _threads_by_index;
+	IdleStack _idle;
 	ActiveFlow * _active_flow;
 	doors::ServerDoorsContainer _doors;
 	RunTimeThread * _doors_thread;
+	OffloadPool _offload; // runs detached nodes
+	int _num_offload_threads;
+	Reactor _reactor; // events suspended on fds
+	volatile long _timers_armed; // on the threads' Timers
+	LaneCounts _lane_counts; // see top_lane()
+	Topology _topology; // for steal victim selection
+	CpuSet _worker_cpus; // worker i is pinned to the i-th one
+	CpuSet _housekeeping_cpus; // doors, offload and reactor threads
+	metrics::Server _metrics; // see OFluxMetrics.h
 public:
-	static __thread RunTimeThread * _thread;
+	static __thread RunTimeThreadAbstract * _thread;
 };
 
 } // namespace lockfree
@@ -16,6 +16,7 @@
  *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <inttypes.h>
+#include <algorithm>
 #include "lockfree/OFluxLockfreeRunTimeThread.h"
 #include "lockfree/OFluxLockfreeRunTime.h"
 #include "OFluxWrappers.h"
@@ -26,6 +27,7 @@
 #include "atomic/OFluxAtomicHolder.h"
 #include "lockfree/allocator/OFluxLFMemoryPool.h"
 #include "lockfree/allocator/OFluxSMR.h"
+#include "OFluxMetrics.h"
 #include "OFluxLogging.h"
 
 #include "atomic/OFluxLFAtomic.h"
@@ -52,17 +54,27 @@ RunTimeThread::RunTimeThread(RunTime & rt, int index, oflux_thread_t tid)
 	, _asleep(false)
 	, _queue_allowance(0)
 	, _tid(tid)
+	, _on_idle_stack(false)
+	, _spin_budget(rt.config().spin_budget > 0 
+		? rt.config().spin_budget 
+		: Default_Spin_Budget)
+	, _steal_success(Steal_Success_Scale/2)
+	, _handoff(rt.config().handoff_depth)
+	, _wake_threshold(rt.config().wake_threshold == 0
+		? Default_Wake_Threshold
+		: std::max(rt.config().wake_threshold,0))
+	, _victims(index)
+	, _cpu(-1)
+	, _wake_stamp(0)
+	, _woken_at(0)
+	, _timers(rt)
 	, _context(NULL)
 {
-	oflux_mutex_init(&_lck);
-	oflux_cond_init(&_cond);
 }
 
 RunTimeThread::~RunTimeThread()
 {
-	oflux_mutex_destroy(&_lck);
-	oflux_cond_destroy(&_cond);
-	while(_queue.size()) {
+	while(queue_size()) {
 		EventBasePtr ev = popLocal();
 		EventBase * evb = get_EventBasePtr(ev);
 		if(!evb) {
@@ -81,6 +93,32 @@ RunTimeThread::WSQElement::~WSQElement()
 {}
 #endif // SHARED_PTR_EVENTS
 
+void
+RunTimeThread::lane_queued(int lane, long n)
+{
+	_rt.lane_queued(lane,n);
+}
+
+size_t
+RunTimeThread::array_bytes() const
+{
+	size_t res = 0;
+	for(int i = 0; i < Lanes; ++i) {
+		res += _lanes[i].array_bytes();
+	}
+	return res;
+}
+
+size_t
+RunTimeThread::array_bytes_high_water() const
+{
+	size_t res = 0;
+	for(int i = 0; i < Lanes; ++i) {
+		res += _lanes[i].array_bytes_high_water();
+	}
+	return res;
+}
+
 static void *
 RunTimeThread_start_thread(void *pthis)
 {
@@ -109,10 +147,7 @@ bool
 RunTimeThread::die()
 {
 	_request_stop = true;
-	if(asleep()) {
-		wake();
-	}
-	oflux_mutex_unlock(&_lck);
+	wake();
 	size_t retries = 4;
 	int res = 0;
 	__ignore_sig_int = true;
@@ -144,19 +179,20 @@ void
 RunTimeThread::start()
 {
 	_rt._thread = this; // thread local reference
-	AutoLock al(&_lck); 
+	trace::attach(_index);
 	oflux_log_trace("[" 
 			PTHREAD_PRINTF_FORMAT
 			"] RunTimeThread::start() called -- thread index %d\n"
 			, oflux_self()
 			, index());
-		// only this thread locks its own _lck
-		// this is only needed for the _cond (signalling)
 	SetTrue st(_running);
-	int no_ev_iterations = 0;
+	unsigned long spin_spent = 0; // pause iterations since last event
+	unsigned long spin_backoff = 1;
 	assert(_tn.index == (size_t)_index);
 	RunTimeThreadContext context;
 	_context = &context;
+	place();
+	_cpu = Topology::current_cpu();
 	while(!_request_stop && !_rt.was_soft_killed()) {
 		if(_rt.caught_soft_load_flow()) {
 			oflux_log_trace("[" 
@@ -166,11 +202,50 @@ RunTimeThread::start()
 				, index());
 			_rt.load_flow();
 		}
+		if(_rt.offload().has_completions() || _rt.reactor().has_ready()) {
+			// successors of offloaded (detached) events
+			// and events resumed by the reactor
+			context.handed_back.clear();
+			_rt.offload().take_completions(context.handed_back);
+			_rt.reactor().take_ready(context.handed_back);
+			int num_pushed = 0;
+			for(size_t i = 0; i < context.handed_back.size(); ++i) {
+				if(!arm_if_timed(context.handed_back[i])) {
+					pushLocal(context.handed_back[i]);
+					++num_pushed;
+				}
+			}
+			wake_for(num_pushed);
+			context.handed_back.clear();
+		}
+		if(_timers.armed()) {
+			long long now = TimerWheel::now_ns();
+			if(_timers.due(now)) {
+				run_timers(context,now);
+			}
+		}
 		enum Q_Stealing {
 			QS_Frequency = 100
 		};
 		
-		if((_queue_allowance%QS_Frequency) ==0) {
+		if(get_EventBasePtr(context.handoff)) {
+			// handed off by the last handle(): run it now
+			context.ev = mk_EventBaseSharedPtr(context.handoff);
+			context.handoff = EventBasePtr(NULL);
+			_handoff.handed();
+			++_stats.events.handed_off;
+		} else {
+			_handoff.queued();
+			int top = _rt.top_lane();
+			if(top > top_local_lane()) {
+				// a higher lane is queued on another thread: take it
+				// before running anything from this one
+				context.ev = mk_EventBaseSharedPtr(steal_run_first(context,top));
+			}
+		}
+		if(context.ev.get()) {
+			// handed off or stolen from a higher lane
+		} else if((_queue_allowance%QS_Frequency) ==0) {
 			// skip pop local now and then 
 			//   to contribute some stealing
 			--_queue_allowance;
@@ -179,61 +254,60 @@ RunTimeThread::start()
 		}
 		context.evb = context.ev.get();
 		if(!context.evb) {
-			++_stats.events.attempts_to_steal;
-			context.ev = mk_EventBaseSharedPtr(_rt.steal_first_random());
+			context.ev = mk_EventBaseSharedPtr(steal_run_first(context,0));
 			context.evb = context.ev.get();
-			_stats.events.stolen += (context.evb ? 1 : 0);
+		}
+		if(context.evb && _woken_at) {
+			record_wake_to_run();
 		}
 		if(!context.evb) {
-			++no_ev_iterations;
-#define SPIN_ITERATIONS 300
-#define NO_EV_CRITICAL  100
-			// spin for a while
-			for(size_t i = 0; i < SPIN_ITERATIONS; ++i) {
-				size_t isquared __attribute__((unused)) = i * i;
+			// back off exponentially between polls
+			for(size_t i = 0; i < spin_backoff; ++i) {
+				spin_pause();
 			}
+			spin_spent += spin_backoff;
+			spin_backoff = std::min(spin_backoff*2
+				, (unsigned long)Spin_Backoff_Max);
+		} else if(context.evb->getIsDetached() 
+				&& _rt.offload().enabled()) {
+			// may block: run it off the workers
+			spin_spent = 0;
+			spin_backoff = 1;
+			_rt.offload().submit(context.ev);
 		} else {
-			no_ev_iterations = 0;
+			spin_spent = 0;
+			spin_backoff = 1;
 			int num_new_evs = handle(context);
-			int num_alive_threads __attribute__((unused)) = _rt.nonsleepers();
-			int threads_to_wake = num_new_evs;
-			oflux_log_trace("[" 
+			oflux_log_trace2("[" 
 				PTHREAD_PRINTF_FORMAT
-				"] RunTimeThread::start() calling handle %d wt: %d\n"
+				"] RunTimeThread::start() calling handle %d new: %d\n"
 				, oflux_self()
 				, index()
-				, threads_to_wake);
-			_rt.wake_threads(threads_to_wake);
-			// attempt to avoid a thundering herd here
+				, num_new_evs);
+			wake_for(num_new_evs);
 		}
-		_asleep = true;
-		if(no_ev_iterations > NO_EV_CRITICAL && _rt.incr_sleepers()) {
+		unsigned long threshold = park_threshold();
+		if(spin_spent > threshold && _rt.incr_sleepers()) {
 			// have permission to sleep now
-			++_stats.sleeps;
-			oflux_log_trace("RunTimeThread::start() sleeping %d\n",index());
-			oflux_cond_wait(&_cond, &_lck);
-			_asleep = false;
-			oflux_log_trace("RunTimeThread::start() woke up  %d\n",index());
-			_rt.decr_sleepers();
-			no_ev_iterations = 0;
-		} else if(no_ev_iterations > NO_EV_CRITICAL*2
+			park(true);
+			spin_spent = 0;
+			spin_backoff = 1;
+		} else if(spin_spent > threshold*2
 				&& _rt.all_asleep_except_me()) {
 
 			//oflux::lockfree::atomic::AtomicPool::dump(ofluximpl::IntPool_map_ptr);
-			if(_rt.doorsThread()) {
-				oflux_log_trace("RunTimeThread::start() there is a doors thread\n");
-				oflux_log_trace("RunTimeThread::start() sleeping %d\n",index());
-				oflux_cond_wait(&_cond, &_lck);
-				_asleep = false;
-				oflux_log_trace("RunTimeThread::start() woke up  %d\n",index());
+			if(_rt.doorsThread() || _rt.offload().busy()
+					|| _rt.reactor().busy() || _rt.timers_busy()) {
+				oflux_log_trace("RunTimeThread::start() there is a doors thread, offloaded work, suspended or timed events\n");
+				park(false);
+				spin_spent = 0;
+				spin_backoff = 1;
 			} else {
-				_asleep = false;
 				oflux_log_warn("RunTimeThread::start() exiting... seem to be out of events to run\n");
 				_rt.soft_kill();
 				break;
 			}
 		}
-		_asleep = false;
 		oflux_log_trace2("RunTimeThread::start (about to reset) "
 			"ev %d %s ev.pred %d %s\n"
 			, context.ev.use_count()
@@ -247,13 +321,236 @@ RunTimeThread::start()
 		context.evb = NULL;
 		context.ev.reset();
 	}
+	if(get_EventBasePtr(context.handoff)) {
+		// discarded with the rest of the queue
+		pushLocal(context.handoff);
+		context.handoff = EventBasePtr(NULL);
+	}
+}
+
+bool
+RunTimeThread::can_hand_off(const EventBasePtr & ev) const
+{
+	return _handoff.may(ev->flow_node(),top_local_lane(),_rt.top_lane());
+}
+
+EventBasePtr
+RunTimeThread::steal_run_first(RunTimeThreadContext & context, int min_lane)
+{
+	EventBasePtr ev(NULL);
+	if(min_lane > 0) {
+		++_stats.events.lane_steal_attempts;
+	} else {
+		++_stats.events.attempts_to_steal;
+	}
+	context.stolen_events.clear();
+	_cpu = Topology::current_cpu(); // may have migrated
+	size_t n = _rt.steal_batch_nearest(
+		  *this
+		, context.stolen_events
+		, Steal_Batch_Max
+		, min_lane);
+	if(n) {
+		// run the oldest now, queue the rest so that
+		// they pop in the order the victim had them
+		ev = context.stolen_events[0];
+		for(size_t i = n-1; i > 0; --i) {
+			pushLocal(context.stolen_events[i]);
+		}
+		context.stolen_events.clear();
+		++_stats.events.steal_batches;
+		_stats.events.steal_batch_max = 
+			std::max(_stats.events.steal_batch_max
+				, (unsigned long)n);
+	}
+	if(min_lane == 0) {
+		record_steal(n > 0);
+	}
+	_stats.events.stolen += n;
+	return ev;
 }
 
 void
+RunTimeThread::place()
+{
+	if(_index < _rt.thread_count()) { // a worker
+		if(!_rt.worker_cpus().empty()) {
+			_rt.worker_cpus().pin_one(_index);
+			for(int lane = 0; lane < Lanes; ++lane) {
+				_lanes[lane].relocate();
+			}
+		}
+	} else { // the doors thread
+		_rt.housekeeping_cpus().pin();
+	}
+	_placement = CpuSet::current();
+}
+
+bool
 RunTimeThread::wake()
 { 
 	oflux_log_debug("RunTimeThread::wake() on %d\n",index());
-	oflux_cond_signal(&_cond); 
+	long long t = TimerWheel::now_ns();
+	_wake_stamp = t; // before the notify so the wakee sees it
+	bool res = _parker.notify();
+	if(!res) { // was not parked after all
+		__sync_bool_compare_and_swap(&_wake_stamp,t,0LL);
+	}
+	return res;
+}
+
+void
+RunTimeThread::wake_for(int num_new_evs)
+{
+	long surplus = queue_size() - _wake_threshold;
+	if(surplus < num_new_evs) {
+		num_new_evs = surplus;
+	}
+	_rt.wake_threads(num_new_evs);
+}
+
+void
+RunTimeThread::record_wake_to_run()
+{
+	long long lat = TimerWheel::now_ns() - _woken_at;
+	_woken_at = 0;
+	++_stats.wakes;
+	_stats.wake_ns += lat;
+	_stats.wake_ns_max = std::max(_stats.wake_ns_max,lat);
+}
+
+void
+RunTimeThread::park(bool count_as_sleeper)
+{
+	// advertise first, then look for work one last time:
+	// a waker that queued work after our look will find us on the stack
+	if(_woken_at) { // nothing ran since the last wake
+		_woken_at = 0;
+		++_stats.futile_wakes;
+	}
+	_parker.prepare_wait();
+	if(!_on_idle_stack) {
+		_on_idle_stack = true;
+		_rt.push_idle(this);
+	}
+	long long next = _timers.next_deadline(); // sleep no later
+	long long timeout = (next > 0 ? next - TimerWheel::now_ns() : 0);
+	if(_request_stop || _rt.was_soft_killed() || _rt.has_work()
+			|| (next > 0 && timeout <= 0)) {
+		_parker.cancel_wait();
+		__sync_lock_test_and_set(&_wake_stamp,0LL);
+	} else {
+		++_stats.sleeps;
+		_asleep = true;
+		oflux_log_trace("RunTimeThread::park() sleeping %d\n",index());
+		bool notified = true;
+		if(next > 0) {
+			notified = _parker.wait(timeout);
+		} else {
+			_parker.wait();
+		}
+		oflux_log_trace("RunTimeThread::park() woke up  %d\n",index());
+		_asleep = false;
+		// only the stamp of the wake that ended this sleep is timed
+		// (one left by a waker which found the thread running is not)
+		long long stamp = __sync_lock_test_and_set(&_wake_stamp,0LL);
+		_woken_at = (notified ? stamp : 0);
+	}
+	if(count_as_sleeper) {
+		_rt.decr_sleepers();
+	}
+}
+
+void
+RunTimeThread::metrics_snapshot(metrics::Snapshot & s)
+{
+	metrics::Labels l;
+	l.add("thread",(long long)_index).add("kind","worker");
+	s.gauge("oflux_thread_asleep","1 if the thread is parked")
+		.add(l,_asleep ? 1 : 0);
+	s.counter("oflux_thread_events_run_total","events run by the thread")
+		.add(l,_stats.events.run);
+	s.counter("oflux_thread_events_stolen_total"
+		, "events the thread stole from others")
+		.add(l,_stats.events.stolen);
+	s.counter("oflux_thread_steal_attempts_total"
+		, "steal attempts by the thread when out of work")
+		.add(l,_stats.events.attempts_to_steal);
+	s.counter("oflux_thread_lane_steal_attempts_total"
+		, "steal attempts by the thread for a higher lane queued elsewhere")
+		.add(l,_stats.events.lane_steal_attempts);
+	s.counter("oflux_thread_steal_batches_total","successful steals")
+		.add(l,_stats.events.steal_batches);
+	s.counter("oflux_thread_handoffs_total"
+		, "successors run without being queued")
+		.add(l,_stats.events.handed_off);
+	s.counter("oflux_thread_sleeps_total","times the thread parked")
+		.add(l,_stats.sleeps);
+	s.counter("oflux_thread_wakes_total"
+		, "times the thread was woken and ran an event")
+		.add(l,_stats.wakes);
+	s.counter("oflux_thread_futile_wakes_total"
+		, "times the thread was woken and parked again without an event")
+		.add(l,_stats.futile_wakes);
+	s.counter("oflux_thread_wake_latency_seconds_total"
+		, "time from being woken to running an event")
+		.add(l,_stats.wake_ns / 1e9);
+	s.gauge("oflux_thread_deque_bytes"
+		, "memory held by the thread's work stealing deques")
+		.add(l,array_bytes());
+	s.gauge("oflux_thread_deque_bytes_high_water"
+		, "most memory held by the thread's work stealing deques")
+		.add(l,array_bytes_high_water());
+	for(int lane = 0; lane < Lanes; ++lane) {
+		metrics::Labels ll(l);
+		ll.add("lane",(long long)lane);
+		s.gauge("oflux_thread_queue_depth","events queued on the thread")
+			.add(ll,_lanes[lane].size());
+		s.gauge("oflux_thread_queue_max_depth"
+			, "most events queued on the thread")
+			.add(ll,_stats.lanes[lane].max_depth);
+		s.counter("oflux_thread_pushed_total"
+			, "events pushed on the thread's queue")
+			.add(ll,_stats.lanes[lane].pushed);
+	}
+}
+
+bool
+RunTimeThread::arm_if_timed(const EventBasePtr & ev)
+{
+	if(ev->not_before() > 0 || ev->wait_deadline() > 0) {
+		_timers.arm(ev);
+		return true;
+	}
+	return false;
+}
+
+void
+RunTimeThread::run_timers(RunTimeThreadContext & context, long long now)
+{
+	context.timed_out.clear();
+	_timers.fire(now,context.timed_out);
+	int num_pushed = 0;
+	for(size_t i = 0; i < context.timed_out.size(); ++i) {
+		EventBasePtr & ev = context.timed_out[i];
+		if(ev->not_before() > 0) {
+			if(!ev->flow_node()->getIsSource()) {
+				continue; // turned off by a reload while armed
+			}
+			// a timed source launch: only now take its guards
+			ev->not_before(0);
+			ev->queued_at(CycleClock::now()); // not waiting before
+			if(!event::acquire_guards(ev,EventBase::no_event)) {
+				continue; // queued when the guard is released
+			}
+		} else {
+			ev->clear_wait(); // suspend_until(): guards still held
+		}
+		pushLocal(ev);
+		++num_pushed;
+	}
+	context.timed_out.clear();
+	wake_for(num_pushed);
 }
 
 int
@@ -262,29 +559,57 @@ RunTimeThread::handle(RunTimeThreadContext & context)
 	context.flow_node_working = context.ev->flow_node();
 	context.successor_events.clear();
 	context.successor_events_released.clear();
+	context.successor_delayed.clear();
 	for(size_t ct= 0; ct < RunTimeThreadContext::SC_num_categories; ++ct) {
 		context.successors_categorized[ct].clear();
 	}
-	oflux_log_trace("[" PTHREAD_PRINTF_FORMAT "] RunTimeThread::handle() on %s %p\n"
+	oflux_log_trace2("[" PTHREAD_PRINTF_FORMAT "] RunTimeThread::handle() on %s %p\n"
 		, oflux_self()
 		, context.flow_node_working->getName()
 		, context.evb);
 	// ---------------- Execution -------------------
 	assert(context.ev->state != 5 && "detect double execution");
+	OFLUX_TRACE(K_exec_begin,context.evb,0);
 	int return_code = context.ev->execute();
-	context.ev->state = 5;
+	OFLUX_TRACE(K_exec_end,context.evb,return_code);
 	++_stats.events.run;
+	if(!return_code && context.ev->waiting()) {
+		// suspended: guards and input are kept for the re-run
+		context.ev->state = 6;
+		if(context.ev->wait_fd() >= 0) {
+			_rt.reactor().suspend(context.ev);
+		} else { // until a deadline
+#ifdef SHARED_PTR_EVENTS
+			EventBasePtr ev = context.ev;
+			context.ev.reset();
+#else  // SHARED_PTR_EVENTS
+			EventBasePtr ev = context.ev.recover();
+			assert(ev && "suspended event should be held only here");
+#endif // SHARED_PTR_EVENTS
+			_timers.arm(ev);
+		}
+		context.evb = NULL;
+		context.flow_node_working = NULL;
+		return 0;
+	}
+	context.ev->clear_wait();
+	context.ev->state = 5;
         // ----------- Successor processing -------------
         if(return_code) { // error encountered
                 event::successors_on_error(
                           context.successor_events // output
                         , context.ev
-                        , return_code);
+                        , return_code
+                        , &context.successor_delayed);
         } else { // no error encountered
                 event::successors_on_no_error(
                           context.successor_events // output
-                        , context.ev);
+                        , context.ev
+                        , &context.successor_delayed);
         }
+	for(size_t i = 0; i < context.successor_delayed.size(); ++i) {
+		_timers.arm(context.successor_delayed[i]);
+	}
 #ifdef OFLUX_DEEP_LOGGING
 	for(size_t i = 0; i < context.successor_events.size(); ++i) {
 		oflux_log_trace2("[" PTHREAD_PRINTF_FORMAT "] successor of %s %p ---> %s %p\n"
@@ -308,6 +633,7 @@ RunTimeThread::handle(RunTimeThreadContext & context)
                 if(succ_ev->atomics().acquire_all_or_wait(succ_ev)) {
                         context.successor_events.push_back(succ_ev);
                 } else {
+			OFLUX_TRACE(K_guard_wait,get_EventBasePtr(succ_ev),0);
 			oflux_log_trace2("[" PTHREAD_PRINTF_FORMAT "] acquire_all_or_wait() failure for "
 				"%s %p on guards acquisition"
 				, oflux_self()
@@ -327,13 +653,31 @@ RunTimeThread::handle(RunTimeThreadContext & context)
 		, Q_Hot_size = 8 // 256
 		};
 	if(_queue_allowance<=0) {
-		_queue_allowance = Q_Critical_size - _queue.size();
+		_queue_allowance = Q_Critical_size - queue_size();
 	} else {
 		--_queue_allowance;
 	}
 	bool push_sources_first = (_queue_allowance < 0);
 	bool push_all_guards_last = (_queue_allowance < Q_Critical_size-Q_Hot_size);
 
+	// ---------- Direct hand off ---------
+	//  A lone ready successor (a linear chain) is run next by this
+	//  thread: no deque push/pop and no thread to wake for it.
+	if(context.successor_events.size() == 1
+			&& can_hand_off(context.successor_events[0])) {
+		take_EventBasePtr(context.handoff,context.successor_events[0]);
+		context.successor_events.clear();
+		oflux_log_trace2("[" PTHREAD_PRINTF_FORMAT "] %u handle: %s %p successor %s %p handed off\n"
+			, oflux_self()
+			, index()
+			, context.flow_node_working->getName()
+			, context.evb
+			, context.handoff->flow_node()->getName()
+			, get_EventBasePtr(context.handoff));
+		context.flow_node_working = NULL;
+		return 0;
+	}
+
 	// -------- Categorization of successors ---------
 	//  This will order them for pushing based on:
 	//  * queue allowance
@@ -364,7 +708,7 @@ RunTimeThread::handle(RunTimeThreadContext & context)
 #define PUSH_EVENTS_FOR(X) \
 	for(size_t i = 0; i < context.successors_categorized[X].size(); ++i) { \
 		EventBasePtr & ev_ptr = context.successors_categorized[X][i]; \
-		oflux_log_trace("[" PTHREAD_PRINTF_FORMAT "] %u handle: %s %p (%d) succcessor %s %p pushed %d\n" \
+		oflux_log_trace2("[" PTHREAD_PRINTF_FORMAT "] %u handle: %s %p (%d) succcessor %s %p pushed %d\n" \
 			, oflux_self() \
 			, index() \
 			, context.flow_node_working->getName() \
@@ -377,17 +721,14 @@ RunTimeThread::handle(RunTimeThreadContext & context)
 		++ind; \
 	}
 
-	const char * queue_temp = "cold";
 	if(push_sources_first) { // queue is critical
 		PUSH_EVENTS_FOR(RunTimeThreadContext::SC_source);
 		PUSH_EVENTS_FOR(RunTimeThreadContext::SC_no_guards);
 		PUSH_EVENTS_FOR(RunTimeThreadContext::SC_low_guards);
-		queue_temp = "crit";
 	} else if(push_all_guards_last) { // queue is hot
 		PUSH_EVENTS_FOR(RunTimeThreadContext::SC_no_guards);
 		PUSH_EVENTS_FOR(RunTimeThreadContext::SC_source);
 		PUSH_EVENTS_FOR(RunTimeThreadContext::SC_low_guards);
-		queue_temp = "hot ";
 	} else { // queue is cold
 		PUSH_EVENTS_FOR(RunTimeThreadContext::SC_no_guards);
 		PUSH_EVENTS_FOR(RunTimeThreadContext::SC_source);
@@ -395,15 +736,16 @@ RunTimeThread::handle(RunTimeThreadContext & context)
 	}
 	PUSH_EVENTS_FOR(RunTimeThreadContext::SC_high_guards);
 	PUSH_EVENTS_FOR(RunTimeThreadContext::SC_exec_gapped);
-	oflux_log_debug("[" PTHREAD_PRINTF_FORMAT "] push evs eg:%u hg:%u lg:%u sr:%u ng:%u %s %d\n"
+	oflux_log_trace2("[" PTHREAD_PRINTF_FORMAT "] push evs eg:%u hg:%u lg:%u sr:%u ng:%u %s %d\n"
 		, oflux_self()
 		, context.successors_categorized[RunTimeThreadContext::SC_exec_gapped].size()
 		, context.successors_categorized[RunTimeThreadContext::SC_high_guards].size()
 		, context.successors_categorized[RunTimeThreadContext::SC_low_guards].size()
 		, context.successors_categorized[RunTimeThreadContext::SC_source].size()
 		, context.successors_categorized[RunTimeThreadContext::SC_no_guards].size()
-		, queue_temp
-		, _queue.size()
+		, (push_sources_first ? "crit" // queue temperature
+			: (push_all_guards_last ? "hot " : "cold"))
+		, queue_size()
 		);
 
 	context.flow_node_working = NULL;
@@ -29,19 +29,29 @@
 #include "OFluxThreads.h"
 #include "OFluxRunTimeThreadAbstract.h"
 #include "lockfree/OFluxWorkStealingDeque.h"
+#include "lockfree/OFluxEventCount.h"
+#include "lockfree/OFluxLockfreeVictims.h"
+#include "lockfree/OFluxLockfreeTimers.h"
+#include "lockfree/OFluxHandOff.h"
 #include "OFluxSharedPtr.h"
 #include <signal.h>
+#include <algorithm>
+#include <string>
 
 #include "OFluxLogging.h"
 #include "event/OFluxEventBase.h"
 #include "flow/OFluxFlowNode.h"
 #include "OFluxLibDTrace.h"
+#include "OFluxTrace.h"
 
 
 namespace oflux {
 namespace flow {
  class Node;
 } //namespace flow
+namespace metrics {
+ class Snapshot;
+} // namespace metrics
 namespace lockfree {
 
 class RunTime;
@@ -56,8 +66,13 @@ struct RunTimeThreadContext {
 		, SC_num_categories = SC_exec_gapped+1
 		, SC_high_atomics_count = 3 // what is considered high
 		, SC_low_atomics_count = 1  // what is considered low
-		, SC_critical_execution_gap = 100
+		, SC_critical_execution_gap = HandOff::Critical_Execution_Gap
 		};
+	RunTimeThreadContext()
+		: evb(NULL)
+		, flow_node_working(NULL)
+		, handoff(NULL)
+	{}
 	// this is used to avoid re-creating variables and vectors within the runtime loop
 	// these are roughly in the order that they are used for one handle() iteration
 	EventBaseSharedPtr ev;
@@ -66,6 +81,11 @@ struct RunTimeThreadContext {
 	std::vector<EventBasePtr> successor_events;
 	std::vector<EventBasePtr> successor_events_released;
 	std::vector<EventBasePtr> successors_categorized[SC_num_categories];
+	std::vector<EventBasePtr> stolen_events;
+	std::vector<EventBasePtr> handed_back; // from offload pool and reactor
+	std::vector<EventBasePtr> successor_delayed; // timed source launches
+	std::vector<EventBasePtr> timed_out; // fired by the Timers
+	EventBasePtr handoff; // lone ready successor: run next, not queued
 };
 
 class RunTimeThread : public ::oflux::RunTimeThreadAbstract {
@@ -94,6 +114,16 @@ public:
 
 	typedef CircularWorkStealingDeque<WSQElement> WorkStealingDeque;
 
+	enum { Steal_Batch_Max = WorkStealingDeque::Steal_Claim_Max }; // most events taken in one steal
+	enum { Lanes = flow::Node::Priority_Lanes }; // one deque per lane
+
+	enum SpinParams
+		{ Default_Spin_Budget = 10000 // pause iterations before parking
+		, Spin_Backoff_Max = 256 // pause iterations per empty poll
+		, Steal_Success_Scale = 1024 // fixed point 1.0 for _steal_success
+		};
+	enum { Default_Wake_Threshold = 1 }; // kept for itself (see wake_for())
+
 	RunTimeThread(RunTime & rt, int index, oflux_thread_t tid);
 	~RunTimeThread();
 	void start();
@@ -110,46 +140,148 @@ public:
 	{
 		EventBasePtr ev(NULL);
 		EventBase * evb = NULL;
-		WSQElement * e = _queue.steal();
+		int lane = top_local_lane();
+		WSQElement * e = _lanes[lane].steal();
 		if(e && e != WorkStealingDeque::empty 
 				&& e != WorkStealingDeque::abort) {
+			lanes_taken(lane,1);
 			take_EventBasePtr(ev,get_ev_WSQElement(e));
 			evb = get_EventBasePtr(ev);
 			put_WSQElement(e);
 			evb->state = 3;
 			PUBLIC_FIFO_POP(evb,evb->flow_node()->getName());
+			OFLUX_TRACE(K_steal,evb,_index);
 		}
-		oflux_log_trace("[" PTHREAD_PRINTF_FORMAT "] steal  %s %p from thread [" PTHREAD_PRINTF_FORMAT "]\n"
+		oflux_log_trace2("[" PTHREAD_PRINTF_FORMAT "] steal  %s %p from thread [" PTHREAD_PRINTF_FORMAT "]\n"
 			, oflux_self()
 			, evb ? evb->flow_node()->getName() : "<null>"
 			, evb
 			, self());
 		return ev;
 	}
+	/**
+	 * @brief steal up to half of this thread's highest non-empty lane
+	 * (oldest first)
+	 * @param min_lane is the lowest lane worth taking from
+	 * @return the number of events appended to evs
+	 */
+	inline size_t steal_batch(std::vector<EventBasePtr> & evs, size_t max_n, int min_lane = 0)
+	{
+		int lane = top_local_lane();
+		if(lane < min_lane) {
+			return 0;
+		}
+		WSQElement * es[Steal_Batch_Max];
+		size_t n = _lanes[lane].steal_batch(es
+			, std::min(max_n,(size_t)Steal_Batch_Max));
+		lanes_taken(lane,n);
+		for(size_t i = 0; i < n; ++i) {
+			EventBasePtr ev(NULL);
+			take_EventBasePtr(ev,get_ev_WSQElement(es[i]));
+			EventBase * evb = get_EventBasePtr(ev);
+			put_WSQElement(es[i]);
+			evb->state = 3;
+			PUBLIC_FIFO_POP(evb,evb->flow_node()->getName());
+			OFLUX_TRACE(K_steal,evb,_index);
+			evs.push_back(ev);
+		}
+		oflux_log_trace2("[" PTHREAD_PRINTF_FORMAT "] steal_batch %u from thread [" PTHREAD_PRINTF_FORMAT "]\n"
+			, oflux_self()
+			, n
+			, self());
+		return n;
+	}
 	int index() const { return _index; }
-	void wake();
+	bool wake(); // true if the thread was parked
+	/**
+	 * @brief pin the calling thread (this one) where it belongs and
+	 * re-allocate its deques there
+	 */
+	void place();
+	/**
+	 * @brief wake parked threads for the num_new_evs events just queued
+	 * here, but only for those beyond the _wake_threshold this thread
+	 * will get to itself
+	 */
+	void wake_for(int num_new_evs);
 	bool die();
 	bool asleep() const { return _asleep; }
 	oflux_thread_t self() const { return _tid; }
+	long queue_size() const
+	{
+		long res = 0;
+		for(int i = 0; i < Lanes; ++i) {
+			res += _lanes[i].size();
+		}
+		return res;
+	}
+	/**
+	 * @return the highest lane holding events (0 if all are empty)
+	 */
+	inline int top_local_lane() const
+	{
+		for(int lane = Lanes-1; lane > 0; --lane) {
+			if(_lanes[lane].size() > 0) {
+				return lane;
+			}
+		}
+		return 0;
+	}
 	void log_snapshot()
 	{
 		flow::Node * fn = (_context ? _context->flow_node_working : NULL);
 		const char * fn_name = (fn ? fn->getName() : "<null>");
-		oflux_log_info("thread %d (pthread %lu) %s %s %s q_len:%ld q_alw:%ld slps:%lu e.run:%lu e.stl:%lu e.stl.at:%lu %s %p\n"
+		oflux_log_info("thread %d (pthread %lu) %s %s %s q_len:%ld q_mem:%lu q_mem.hw:%lu q_alw:%ld slps:%lu spin:%lu st.ok:%ld e.run:%lu e.stl:%lu e.stl.at:%lu e.stl.ln:%lu e.stl.b:%lu e.stl.bmx:%lu e.ho:%lu wk:%lu wk.fut:%lu wk.lat:%lldus wk.lat.mx:%lldus %s %p\n"
 			, _index
 			, _tid
 			, _running ? "running" : "       "
 			, _request_stop ? "req-stop" : "        "
 			, _asleep ? "asleep" : "      "
-			, _queue.size()
+			, queue_size()
+			, array_bytes()
+			, array_bytes_high_water()
 			, _queue_allowance
 			, _stats.sleeps
+			, park_threshold()
+			, _steal_success
 			, _stats.events.run
 			, _stats.events.stolen
 			, _stats.events.attempts_to_steal
+			, _stats.events.lane_steal_attempts
+			, _stats.events.steal_batches
+			, _stats.events.steal_batch_max
+			, _stats.events.handed_off
+			, _stats.wakes
+			, _stats.futile_wakes
+			, (_stats.wakes ? _stats.wake_ns / _stats.wakes : 0LL) / 1000
+			, _stats.wake_ns_max / 1000
 			, fn_name
 			, thisEvent());
+		oflux_log_info("thread %d cpu %d (cpus %s) steals: %lu%% of %lu sweeps last:%lu cache:%lu node:%lu remote:%lu\n"
+			, _index
+			, _cpu
+			, _placement.c_str()
+			, _victims.success_pct()
+			, _victims.sweeps()
+			, _victims.last_hits()
+			, _victims.hits(Topology::D_Cache)
+			, _victims.hits(Topology::D_Node)
+			, _victims.hits(Topology::D_Remote));
+		_timers.log_snapshot(_index);
+		for(int lane = Lanes-1; lane >= 0; --lane) {
+			oflux_log_info("thread %d lane %d: %ld queued %ld max depth %lu pushed\n"
+				, _index
+				, lane
+				, _lanes[lane].size()
+				, _stats.lanes[lane].max_depth
+				, _stats.lanes[lane].pushed);
+		}
 	}
+	/**
+	 * @brief add this thread's counters and queue depths to s
+	 * (read without synchronization from another thread)
+	 */
+	void metrics_snapshot(metrics::Snapshot & s);
 protected:
 	int create();
 	RunTimeThread * _next;
@@ -158,15 +290,29 @@ private:
 	{
 		EventBasePtr ebptr(NULL);
 		EventBase * ebb = NULL;
-		WSQElement * e = _queue.popBottom();
+		WSQElement * e = NULL;
+		int lane = Lanes-1;
+		for(; lane > 0; --lane) { // size() only errs high here
+			if(_lanes[lane].size() > 0) {
+				e = _lanes[lane].popBottom();
+				if(e && e != WorkStealingDeque::empty) {
+					break;
+				}
+			}
+		}
+		if(lane == 0) {
+			e = _lanes[0].popBottom();
+		}
 		if(e && e != WorkStealingDeque::empty) {
+			lanes_taken(lane,1);
 			take_EventBasePtr(ebptr,get_ev_WSQElement(e));
 			ebb = get_EventBasePtr(ebptr);
 			put_WSQElement(e);
 			ebptr->state = 2;
 			PUBLIC_FIFO_POP(ebb,ebb->flow_node()->getName());
+			OFLUX_TRACE(K_pop,ebb,lane);
 		}
-		oflux_log_trace("[" PTHREAD_PRINTF_FORMAT "] popLocal %s %p\n"
+		oflux_log_trace2("[" PTHREAD_PRINTF_FORMAT "] popLocal %s %p\n"
 			, self()
 			, (ebb ? ebb->flow_node()->getName() : "<null>")
 			, ebb);
@@ -175,19 +321,68 @@ private:
 	inline void pushLocal(const EventBasePtr & ev)
 	{
 		ev->state = 1;
-		const char * fn_name = (ev && ev->flow_node() 
-			? ev->flow_node()->getName() 
-			: "<null>");
-		oflux_log_trace("[" PTHREAD_PRINTF_FORMAT "] pushLocal %s %p\n"
+		oflux_log_trace2("[" PTHREAD_PRINTF_FORMAT "] pushLocal %s %p\n"
 			, self()
-			, fn_name
+			, ev->flow_node()->getName()
 			, get_EventBasePtr(ev));
+		int lane = ev->flow_node()->lane();
+		OFLUX_TRACE(K_push,get_EventBasePtr(ev),lane);
 		WSQElement * e = get_WSQElement(ev); 
-		_queue.pushBottom(e);
-		PUBLIC_FIFO_PUSH(get_EventBasePtr(ev),fn_name);
+		_lanes[lane].pushBottom(e);
+		if(lane > 0) {
+			lane_queued(lane,1);
+		}
+		++_stats.lanes[lane].pushed;
+		_stats.lanes[lane].max_depth = 
+			std::max(_stats.lanes[lane].max_depth,_lanes[lane].size());
+		PUBLIC_FIFO_PUSH(get_EventBasePtr(ev),ev->flow_node()->getName());
 	}
+	inline void lanes_taken(int lane, size_t n)
+	{
+		if(lane > 0 && n > 0) {
+			lane_queued(lane,-(long)n);
+		}
+	}
+	void lane_queued(int lane, long n); // runtime-wide count
+	size_t array_bytes() const;
+	size_t array_bytes_high_water() const;
 	int handle(RunTimeThreadContext & context);
+	/**
+	 * @brief steal a batch from another thread (lane min_lane or up)
+	 * Only steals made for lack of work (min_lane 0) feed the steal
+	 * success average behind park_threshold().
+	 * @return the oldest stolen event (the rest are pushed locally)
+	 */
+	EventBasePtr steal_run_first(RunTimeThreadContext & context, int min_lane);
+	void park(bool count_as_sleeper);
+	/**
+	 * @brief put ev on this thread's Timers if it has a time to wait for
+	 * @return false if it may run now
+	 */
+	bool arm_if_timed(const EventBasePtr & ev);
+	/**
+	 * @brief queue the timed events that are due
+	 */
+	void run_timers(RunTimeThreadContext & context, long long now);
+	void record_wake_to_run();
+	inline unsigned long park_threshold() const
+	{ // park sooner when stealing has not been paying off
+		return _spin_budget / 4
+			+ (((_spin_budget * 3) / 4) * _steal_success) 
+				/ Steal_Success_Scale;
+	}
+	inline void record_steal(bool success)
+	{ // moving average of steal success (weight 1/16)
+		_steal_success += 
+			((success ? (long)Steal_Success_Scale : 0L) 
+				- _steal_success) / 16;
+	}
 	inline bool critical() const { return _running && _queue_allowance<0; }
+	/**
+	 * @brief may ev (the only ready successor) be run right away
+	 * instead of being pushed and popped back? (see HandOff::may())
+	 */
+	bool can_hand_off(const EventBasePtr & ev) const;
 private:
 	RunTime & _rt;
 	int _index;
@@ -196,25 +391,60 @@ public:
 private:
 	bool _request_stop;
 	bool _asleep;
-	WorkStealingDeque _queue;
+	WorkStealingDeque _lanes[Lanes]; // popped highest lane first
 	long _queue_allowance;
 public:
 	oflux_thread_t _tid;
 private:
-	oflux_mutex_t _lck; 
-		// lock for the condition var (not really used as a lock)
-	oflux_cond_t _cond;
-		// conditional used for parking this thread
+	EventCount _parker; // where this thread parks when idle
+	volatile bool _on_idle_stack;
+	unsigned long _spin_budget;
+	long _steal_success; // out of Steal_Success_Scale
+	HandOff _handoff;
+	long _wake_threshold;
+	Victims _victims; // steal state (see RunTime::steal_batch_nearest())
+	volatile int _cpu; // where this thread last ran (-1 unknown)
+	std::string _placement; // CPUs it may run on (see place())
+	volatile long long _wake_stamp; // ns, set by a waker before it notifies
+	long long _woken_at; // stamp of the wake that ended the last park (0 if none)
+	Timers _timers; // this thread's timed events
 	RunTimeThreadContext * _context;
 	struct Stats {
-		Stats() : sleeps(0) {}
+		Stats() 
+			: sleeps(0) 
+			, wakes(0)
+			, futile_wakes(0)
+			, wake_ns(0)
+			, wake_ns_max(0)
+		{}
 		struct Events {
-			Events() : run(0), stolen(0), attempts_to_steal(0) {}
+			Events() 
+				: run(0)
+				, stolen(0)
+				, attempts_to_steal(0)
+				, lane_steal_attempts(0)
+				, steal_batches(0)
+				, steal_batch_max(0)
+				, handed_off(0)
+			{}
 			unsigned long run;
 			unsigned long stolen;
-			unsigned long attempts_to_steal;
+			unsigned long attempts_to_steal; // when out of work
+			unsigned long lane_steal_attempts; // for a higher lane
+			unsigned long steal_batches; // successful steals
+			unsigned long steal_batch_max; // largest batch stolen
+			unsigned long handed_off; // run without queueing
 		} events;
+		struct Lane {
+			Lane() : pushed(0), max_depth(0) {}
+			unsigned long pushed;
+			long max_depth;
+		} lanes[Lanes];
 		unsigned long sleeps;
+		unsigned long wakes; // woken and then ran an event
+		unsigned long futile_wakes; // woken, parked again without one
+		long long wake_ns; // total wake-to-run latency
+		long long wake_ns_max;
 	} _stats;
 };
 
@@ -0,0 +1,144 @@
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "lockfree/OFluxLockfreeTimers.h"
+#include "lockfree/OFluxLockfreeRunTime.h"
+#include "event/OFluxEventBase.h"
+#include "event/OFluxEventOperations.h"
+#include "flow/OFluxFlowNode.h"
+#include "OFluxLogging.h"
+#include <algorithm>
+#include <cassert>
+
+namespace oflux {
+namespace lockfree {
+
+Timers::Timers(RunTime & rt)
+	: _rt(rt)
+{
+}
+
+Timers::~Timers()
+{
+	// the events are dropped unrun: the suspended ones give back
+	// the guards they hold (launches have not acquired theirs yet)
+	std::vector<EventBaseSharedPtr> unrun;
+	_fired.clear();
+	_wheel.clear(_fired);
+	for(size_t i = 0; i < _fired.size(); ++i) {
+		EventBase::TimerEntry * t =
+			static_cast<EventBase::TimerEntry *>(_fired[i]);
+		oflux_log_debug("~Timers discarding timed event %s %p\n"
+			, t->ev->flow_node()->getName()
+			, get_EventBasePtr(t->ev));
+		if(t->ev->not_before() == 0) {
+			unrun.push_back(mk_EventBaseSharedPtr(t->ev));
+		}
+		t->owner = NULL;
+		t->ev = EventBasePtr(NULL);
+	}
+	_rt.timers_armed(-(long)_fired.size());
+	_fired.clear();
+	event::drop_unrun(unrun);
+}
+
+void
+Timers::arm(const EventBasePtr & ev)
+{
+	EventBase::TimerEntry & t = ev->timer_entry();
+	long long deadline =
+		(ev->not_before() > 0 ? ev->not_before() : ev->wait_deadline());
+	if(!t.armed()) {
+		t.ev = ev;
+		t.owner = this;
+		_rt.timers_armed(1);
+	}
+	assert(t.owner == this && "armed on another thread's Timers");
+	_wheel.arm(&t,deadline);
+	++_stats.armed;
+	oflux_log_trace("[" PTHREAD_PRINTF_FORMAT "] Timers::arm() %s %p in %lld us\n"
+		, oflux_self()
+		, ev->flow_node()->getName()
+		, get_EventBasePtr(ev)
+		, (deadline - TimerWheel::now_ns()) / 1000);
+}
+
+bool
+Timers::cancel(const EventBasePtr & ev)
+{
+	EventBase::TimerEntry & t = ev->timer_entry();
+	if(!t.armed() || t.owner != this) {
+		return false;
+	}
+	_wheel.cancel(&t);
+	t.owner = NULL;
+	t.ev = EventBasePtr(NULL); // ev (the caller's) still holds it
+	++_stats.cancelled;
+	_rt.timers_armed(-1);
+	return true;
+}
+
+size_t
+Timers::fire(long long now, std::vector<EventBasePtr> & evs)
+{
+	_fired.clear();
+	_wheel.advance(now,_fired);
+	for(size_t i = 0; i < _fired.size(); ++i) {
+		EventBase::TimerEntry * t =
+			static_cast<EventBase::TimerEntry *>(_fired[i]);
+		long long late = now - t->deadline;
+		_stats.late_ns += late;
+		_stats.late_ns_max = std::max(_stats.late_ns_max,late);
+		evs.push_back(t->ev);
+		t->owner = NULL;
+		t->ev = EventBasePtr(NULL);
+	}
+	size_t n = _fired.size();
+	_stats.fired += n;
+	_rt.timers_armed(-(long)n);
+	_fired.clear();
+	return n;
+}
+
+void
+Timers::log_snapshot(int index)
+{
+	oflux_log_info("thread %d timers: armed:%zu set:%lu fired:%lu cancelled:%lu late:%lldus late.mx:%lldus\n"
+		, index
+		, armed()
+		, _stats.armed
+		, _stats.fired
+		, _stats.cancelled
+		, (_stats.fired ? _stats.late_ns / (long long)_stats.fired : 0LL) / 1000
+		, _stats.late_ns_max / 1000);
+}
+
+bool
+suspend_until(long long deadline)
+{
+	RunTimeThreadAbstract * rtt = RunTime::_thread;
+	EventBase * evb = (rtt ? rtt->thisEvent() : NULL);
+	if(!evb) {
+		return false;
+	}
+	// 0 means not waiting: make a past deadline just due
+	evb->wait_until(deadline > 0 ? deadline : 1);
+	return true;
+}
+
+} // namespace lockfree
+} // namespace oflux
@@ -0,0 +1,105 @@
+#ifndef OFLUX_LF_TIMERS
+#define OFLUX_LF_TIMERS
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file OFluxLockfreeTimers.h
+ * @author Mark Pichora
+ *   Timed events for the lock-free runtime.  Each worker owns a timer
+ * wheel: the launches of timed sources (nodes with a period) and the
+ * events suspended with suspend_until() are armed on it.  The worker
+ * checks its wheel between events and parks no longer than its next
+ * deadline, so there is no timer thread.
+ *
+ * Use case (node Pace):
+ *
+ *   if(!in->sent_at && oflux::lockfree::suspend_until(deadline)) {
+ *     return 0; // re-run (guards still held) once deadline passes
+ *   }
+ */
+
+#include "OFlux.h"
+#include "OFluxTimerWheel.h"
+#include <vector>
+
+namespace oflux {
+namespace lockfree {
+
+class RunTime;
+
+class Timers {
+public:
+	Timers(RunTime & rt);
+	~Timers();
+	/**
+	 * @brief hold ev until deadline (ev->not_before() or its
+	 * wait_deadline())
+	 */
+	void arm(const EventBasePtr & ev);
+	/**
+	 * @brief take ev back off the wheel (its EventBase::timer_entry()
+	 * is the handle)
+	 * @return false if it was not armed here
+	 */
+	bool cancel(const EventBasePtr & ev);
+	inline bool due(long long now) const
+	{
+		long long next = _wheel.next_deadline();
+		return next > 0 && next <= now;
+	}
+	/**
+	 * @brief move the events whose time has come into evs
+	 * @return the number moved
+	 */
+	size_t fire(long long now, std::vector<EventBasePtr> & evs);
+	inline long long next_deadline() const { return _wheel.next_deadline(); }
+	inline size_t armed() const { return _wheel.armed(); }
+	void log_snapshot(int index);
+private:
+	RunTime & _rt;
+	TimerWheel _wheel;
+	std::vector<TimerWheel::Entry *> _fired;
+	struct Stats {
+		Stats()
+			: armed(0)
+			, fired(0)
+			, cancelled(0)
+			, late_ns(0)
+			, late_ns_max(0)
+		{}
+		unsigned long armed;
+		unsigned long fired;
+		unsigned long cancelled;
+		long long late_ns; // total time fired past the deadline
+		long long late_ns_max;
+	} _stats;
+};
+
+/**
+ * @brief suspend the current event (called from a node function)
+ * @param deadline is when to re-run it (ns, see TimerWheel::now_ns())
+ * @return false if this is not a lock-free runtime thread (the node
+ *   should sleep)
+ */
+bool suspend_until(long long deadline);
+
+} // namespace lockfree
+} // namespace oflux
+
+#endif // OFLUX_LF_TIMERS
@@ -0,0 +1,158 @@
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "lockfree/OFluxLockfreeVictims.h"
+#include "OFluxLogging.h"
+#include <set>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#ifdef LINUX
+# include <sched.h>
+#endif // LINUX
+
+namespace oflux {
+namespace lockfree {
+
+const char * Topology::sys_cpu_dir = "/sys/devices/system/cpu";
+
+static bool
+read_int(const char * path, int & val)
+{
+	FILE * f = fopen(path,"r");
+	if(!f) {
+		return false;
+	}
+	bool res = (fscanf(f,"%d",&val) == 1); // first CPU of a list too
+	fclose(f);
+	return res;
+}
+
+static int
+llc_group_of(const char * sys_dir, int cpu)
+{
+	// the shared_cpu_list of the highest cache level names the group
+	// (CPUs without cache information are all put in group -1, so
+	// that they are not told apart)
+	char path[256];
+	int best_level = -1;
+	int group = -1;
+	for(int index = 0; ; ++index) {
+		int level = 0;
+		snprintf(path,sizeof(path),"%s/cpu%d/cache/index%d/level"
+			, sys_dir, cpu, index);
+		if(!read_int(path,level)) {
+			break;
+		}
+		int first = cpu;
+		snprintf(path,sizeof(path),"%s/cpu%d/cache/index%d/shared_cpu_list"
+			, sys_dir, cpu, index);
+		if(level > best_level && read_int(path,first)) {
+			best_level = level;
+			group = first;
+		}
+	}
+	return group;
+}
+
+static int
+node_of(const char * sys_dir, int cpu)
+{
+	char path[256];
+	snprintf(path,sizeof(path),"%s/cpu%d",sys_dir,cpu);
+	DIR * dir = opendir(path);
+	int node = -1;
+	if(dir) {
+		struct dirent * de;
+		while(node < 0 && (de = readdir(dir)) != NULL) {
+			int n;
+			if(strncmp(de->d_name,"node",4) == 0
+					&& sscanf(de->d_name+4,"%d",&n) == 1) {
+				node = n;
+			}
+		}
+		closedir(dir);
+	}
+	if(node < 0) { // no NUMA info: go by socket
+		snprintf(path,sizeof(path)
+			,"%s/cpu%d/topology/physical_package_id"
+			, sys_dir, cpu);
+		if(!read_int(path,node)) {
+			node = 0;
+		}
+	}
+	return node;
+}
+
+Topology::Topology()
+	: _levels(1)
+{
+	init(sys_cpu_dir,sysconf(_SC_NPROCESSORS_CONF));
+}
+
+Topology::Topology(const char * sys_dir, long n)
+	: _levels(1)
+{
+	init(sys_dir,n);
+}
+
+void
+Topology::init(const char * sys_dir, long n)
+{
+	std::set<int> caches;
+	std::set<int> nodes;
+	for(int cpu = 0; cpu < n; ++cpu) {
+		_cache.push_back(llc_group_of(sys_dir,cpu));
+		_node.push_back(node_of(sys_dir,cpu));
+		caches.insert(_cache.back());
+		nodes.insert(_node.back());
+	}
+	if(nodes.size() > 1) {
+		_levels = D_Count;
+	} else if(caches.size() > 1) {
+		_levels = D_Node+1;
+	}
+	oflux_log_info("lockfree::Topology: %d cpus %zu cache groups %zu nodes\n"
+		, cpus()
+		, caches.size()
+		, nodes.size());
+}
+
+void
+Topology::log_snapshot() const
+{
+	for(int cpu = 0; cpu < cpus(); ++cpu) {
+		oflux_log_debug("lockfree::Topology: cpu %d cache group %d node %d\n"
+			, cpu
+			, _cache[cpu]
+			, _node[cpu]);
+	}
+}
+
+int
+Topology::current_cpu()
+{
+#ifdef LINUX
+	return sched_getcpu();
+#else
+	return -1;
+#endif // LINUX
+}
+
+} // namespace lockfree
+} // namespace oflux
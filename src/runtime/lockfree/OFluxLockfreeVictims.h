@@ -0,0 +1,142 @@
+#ifndef OFLUX_LOCKFREE_VICTIMS_H
+#define OFLUX_LOCKFREE_VICTIMS_H
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file OFluxLockfreeVictims.h
+ * @author Mark Pichora
+ *  Steal victim selection for the lock-free runtime.  The machine
+ * topology (which CPUs share a last level cache, which NUMA node each
+ * CPU is on) is read from /sys/devices/system/cpu once.  A thief tries
+ * the victim it last stole from first, then threads running near it
+ * (same cache, then same node) before remote ones, starting each sweep
+ * at a random thread (per-thread xorshift, no libc lock).
+ */
+
+#include <vector>
+
+namespace oflux {
+namespace lockfree {
+
+class Topology {
+public:
+	enum Distance
+		{ D_Cache = 0  // share a last level cache
+		, D_Node = 1   // same NUMA node (or package)
+		, D_Remote = 2
+		, D_Count = 3
+		};
+
+	Topology();
+	/**
+	 * @brief read the topology of CPUs 0 to n-1 from another
+	 * directory laid out as sys_cpu_dir (for testing)
+	 */
+	Topology(const char * sys_dir, long n);
+	/**
+	 * @return how far apart CPUs a and b are (< levels())
+	 */
+	inline int distance(int a, int b) const
+	{
+		if(a < 0 || b < 0 || a >= cpus() || b >= cpus()) {
+			return _levels-1;
+		}
+		int d = (_cache[a] == _cache[b]
+			? D_Cache
+			: (_node[a] == _node[b] ? D_Node : D_Remote));
+		return d < _levels ? d : _levels-1;
+	}
+	/**
+	 * @return number of distances worth telling apart (1 if flat)
+	 */
+	inline int levels() const { return _levels; }
+	inline int cpus() const { return (int)_cache.size(); }
+	void log_snapshot() const;
+	/**
+	 * @return the CPU the calling thread is running on (-1 unknown)
+	 */
+	static int current_cpu();
+
+	static const char * sys_cpu_dir;
+private:
+	void init(const char * sys_dir, long n);
+private:
+	std::vector<int> _cache; // per CPU: lowest CPU sharing its LLC (-1 unknown)
+	std::vector<int> _node;  // per CPU: NUMA node
+	int _levels;
+};
+
+/**
+ * @class Victims
+ * @brief per thread steal state: RNG, last victim and success counts
+ */
+class Victims {
+public:
+	Victims(int index)
+		: _seed(2463534242U + 97U * index)
+		, _last(-1)
+		, _sweeps(0)
+		, _last_hits(0)
+	{
+		for(int d = 0; d < Topology::D_Count; ++d) {
+			_hits[d] = 0;
+		}
+	}
+	inline unsigned int next_random()
+	{ // xorshift32
+		_seed ^= _seed << 13;
+		_seed ^= _seed >> 17;
+		_seed ^= _seed << 5;
+		return _seed;
+	}
+	inline int last() const { return _last; }
+	inline void sweep() { ++_sweeps; }
+	inline void stole_last() { ++_last_hits; }
+	inline void missed_last() { _last = -1; }
+	inline void stole_from(int victim, int distance)
+	{
+		_last = victim;
+		++_hits[distance];
+	}
+	inline unsigned long sweeps() const { return _sweeps; }
+	inline unsigned long last_hits() const { return _last_hits; }
+	inline unsigned long hits(int distance) const { return _hits[distance]; }
+	/**
+	 * @return percentage of sweeps that stole something
+	 */
+	inline unsigned long success_pct() const
+	{
+		unsigned long ok = _last_hits;
+		for(int d = 0; d < Topology::D_Count; ++d) {
+			ok += _hits[d];
+		}
+		return _sweeps ? (100 * ok) / _sweeps : 0;
+	}
+private:
+	unsigned int _seed;
+	int _last; // victim index of the last successful steal
+	unsigned long _sweeps;
+	unsigned long _last_hits;
+	unsigned long _hits[Topology::D_Count]; // by distance
+};
+
+} // namespace lockfree
+} // namespace oflux
+
+#endif // OFLUX_LOCKFREE_VICTIMS_H
@@ -119,6 +119,44 @@ write_barrier(void) {
 #endif
 }
 
+/**
+ * @brief compare and swap the two adjacent longs p[0] and p[1] as one
+ * (p must be aligned to twice the size of a long)
+ */
+EXTERN_INLINE bool
+cas_pair(volatile long * p, long old0, long old1, long new0, long new1) {
+#if x86_64_HOST_ARCH
+    bool res;
+    __asm__ __volatile__ ("lock; cmpxchg16b %1\n\tsetz %0"
+        : "=q" (res), "+m" (*(volatile __int128 *)p), "+a" (old0), "+d" (old1)
+        : "b" (new0), "c" (new1)
+        : "memory", "cc");
+    return res;
+#elif i386_HOST_ARCH || (sparc_HOST_ARCH && !defined(__sparcv9))
+    /* two 32 bit longs fit one 64 bit CAS */
+    union { long l[2]; unsigned long long ll; } o, n;
+    o.l[0] = old0; o.l[1] = old1;
+    n.l[0] = new0; n.l[1] = new1;
+    return __sync_bool_compare_and_swap(
+        (volatile unsigned long long *)p, o.ll, n.ll);
+#else
+#error pair compare and swap unimplemented on this architecture
+#endif
+}
+
+EXTERN_INLINE void
+spin_pause(void) {
+#if i386_HOST_ARCH
+    __asm__ __volatile__ ("pause" : : : "memory");
+#elif x86_64_HOST_ARCH
+    __asm__ __volatile__ ("pause" : : : "memory");
+#elif sparc_HOST_ARCH
+    __asm__ __volatile__ ("" : : : "memory");
+#else
+#error spin pause unimplemented on this architecture
+#endif
+}
+
 
 } // namespace lockfree
 } // namespace oflux
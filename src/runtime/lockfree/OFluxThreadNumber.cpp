@@ -16,6 +16,7 @@
  *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "OFluxThreadNumber.h"
+#include <vector>
 
 namespace oflux {
 namespace lockfree {
@@ -23,6 +24,9 @@ namespace lockfree {
 size_t ThreadNumber::num_threads = 0;
 __thread ThreadNumber _tn = {0};
 
+static pthread_mutex_t released_lock = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<size_t> * released = NULL; // indices of exited threads
+
 void
 ThreadNumber::init(int i)
 {
@@ -37,9 +41,28 @@ void
 ThreadNumber::init()
 {
 	// This version is less used
+	pthread_mutex_lock(&released_lock);
+	if(released && !released->empty()) {
+		_tn.index = released->back();
+		released->pop_back();
+		pthread_mutex_unlock(&released_lock);
+		return;
+	}
+	pthread_mutex_unlock(&released_lock);
 	_tn.index = __sync_fetch_and_add(&ThreadNumber::num_threads,1);
 }
 
+void
+ThreadNumber::release()
+{
+	pthread_mutex_lock(&released_lock);
+	if(!released) {
+		released = new std::vector<size_t>();
+	}
+	released->push_back(_tn.index);
+	pthread_mutex_unlock(&released_lock);
+}
+
 
 } // namespace lockfree
 } // namespace oflux
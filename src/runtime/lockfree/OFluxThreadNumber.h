@@ -37,7 +37,12 @@ public:
         size_t index;
 
 	static void init(int i);
-	static void init();
+	static void init(); // reuses a released index if there is one
+	/**
+	 * @brief give the calling thread's index back (it is exiting)
+	 * for a later init() to reuse
+	 */
+	static void release();
 };
 
 extern __thread ThreadNumber _tn; // thread local access to a thread's index
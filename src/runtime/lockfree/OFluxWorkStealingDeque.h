@@ -30,52 +30,80 @@
  */
 
 #include <cstdio>
+#include <cstdlib>
 #include <strings.h>
+#include <algorithm>
+#include "OFluxAllocator.h"
 #include "lockfree/OFluxThreadNumber.h"
 #include "lockfree/OFluxMachineSpecific.h"
 #include "lockfree/OFluxSentinel.h"
+#include "lockfree/allocator/OFluxSMR.h"
 
 namespace oflux {
 namespace lockfree {
 
 
+/**
+ * @class CircularArray
+ * @brief the backing store of a deque; header and slots in one allocation
+ * Arrays replaced by grow() or shrink() are retired to the SMR deferred 
+ * free list and reclaimed once no thief holds them as a hazard.
+ */
 template<typename T>
 class CircularArray {
 public:
 	typedef T * TPtr;
 	enum { default_log_size = 8 };
-	CircularArray(int log_size = default_log_size)
-		: _log_size(log_size)
-		, _old(NULL)
+
+	static CircularArray<T> * create(int log_size = default_log_size)
+	{
+		void * mem = ::malloc(bytes(log_size));
+		if(!mem) {
+			throw std::bad_alloc();
+		}
+		return new (mem) CircularArray<T>(log_size);
+	}
+	static void destroy(CircularArray<T> * a)
 	{
-		_data = new TPtr[1<< log_size];
+		::free(a);
 	}
-	~CircularArray()
+	static void retire(CircularArray<T> * a)
 	{
-		delete [] _data;
-		delete _old;
+		smr::DeferFree::defer_put(a
+			, *default_allocator<sizeof(CircularArray<T>)>());
 	}
+	static size_t bytes(int log_size)
+	{ return sizeof(CircularArray<T>) + ((1 << log_size) - 1) * sizeof(TPtr); }
+	inline size_t bytes() const
+	{ return bytes(_log_size); }
+	inline int log_size() const
+	{ return _log_size; }
 	inline long size() const
 	{ return 1 << _log_size; }
 	inline T * get(long i) const
 	{ return _data[i % size()]; }
 	inline void put(long i,T * o)
 	{ _data[i % size()] = o; }
-	CircularArray<T> * grow(long b, long t) const
+	CircularArray<T> * resize(long b, long t, int log_size) const
 	{
-		CircularArray<T> * res = 
-			new CircularArray<T>(_log_size+1);
+		CircularArray<T> * res = create(log_size);
 		for(long i = t; i < b; ++i) {
 			res->put(i,get(i));
 		}
-		res->_old = this;
 		return res;
 	}
+	inline CircularArray<T> * grow(long b, long t) const
+	{ return resize(b,t,_log_size+1); }
+	inline CircularArray<T> * shrink(long b, long t) const
+	{ return resize(b,t,_log_size-1); }
 private: 
+	CircularArray(int log_size)
+		: _log_size(log_size)
+	{}
+	CircularArray(const CircularArray<T> &); // not implemented
+
 	int _log_size;
-	const CircularArray<T> * _old;
-	T ** _data;
-	
+	T * _data[1]; // really (1 << _log_size) entries
 };
 
 template<typename T>
@@ -92,10 +120,20 @@ public:
 	size_t big_log[100000];
 #endif
 
+	enum 
+		{ Shrink_Occupancy_Ratio = 8 // shrink below 1/8 full
+		, Shrink_Patience = 256 // for this many consecutive pops
+		, Steal_Claim_Max = 16 // most elements one steal_batch() claims
+		};
+
 	CircularWorkStealingDeque()
-		: _bottom(0)
-		, _top(0)
-		, _active_array(new CircularArray<T>())
+		: _top(0)
+		, _pops(0)
+		, _bottom(0)
+		, _active_array(CircularArray<T>::create())
+		, _low_occupancy_pops(0)
+		, _array_bytes(_active_array->bytes())
+		, _array_bytes_high_water(_array_bytes)
 	{
 #ifdef CSW_DEQUE_BIG_LOG
 	::bzero(big_log,100000);
@@ -104,7 +142,7 @@ public:
 
 	~CircularWorkStealingDeque()
 	{ 
-		delete _active_array; 
+		CircularArray<T>::destroy(_active_array); 
 	}
 
 	inline bool cas_top(long oldVal,long newVal)
@@ -118,7 +156,7 @@ public:
 		long size= b-t;
 		if(size >= a->size()-1) {
 			a = a->grow(b,t);
-			_active_array = a;
+			replace_array(a);
 		}
 #ifdef CSW_DEQUE_BIG_LOG
 		big_log[b%100000] |= (1 << (_tn.index + 16));
@@ -131,32 +169,39 @@ public:
 
 	inline T * steal()
 	{
-		long t = _top;
-		load_load_barrier();
-		long b = _bottom;
-		CircularArray<T> * a = _active_array;
-		long size = b - t;
-		if(size <= 0) {
-			return empty;
-		}
-		T * e = a->get(t);
-		if(!cas_top(t,t+1)) {
-			return abort;
-		}
-#ifdef CSW_DEQUE_BIG_LOG
-		big_log[t%100000] |= (1 << _tn.index);
-#endif
+		T * e = NULL;
+		claim(&e,1,false); // e is empty or abort if nothing was claimed
 		return e;
 	}
 
+	/**
+	 * @brief steal up to half of the elements (but no more than max_n
+	 * or Steal_Claim_Max) with one CAS on _top (and _pops)
+	 * Elements come out oldest first.
+	 * @return the number of elements written to out
+	 */
+	inline size_t steal_batch(T ** out, size_t max_n)
+	{
+		return claim(out,max_n,true);
+	}
+
+	/**
+	 * The owner takes the newest element without a CAS unless it is the
+	 * last one (as in Chase and Lev).  Each pop bumps _pops before it
+	 * reads _top, and a thief's claim fails if _pops moved since the 
+	 * thief read _bottom, so a batch never includes a slot the owner
+	 * has popped (or is popping).
+	 */
 	inline T * popBottom()
 	{
+		maybe_shrink();
 		CircularArray<T> * a = _active_array;
 		long b = _bottom;
 		long t;
 		long size;
 		b = b-1;
 		_bottom = b;
+		_pops = _pops + 1;
 		store_load_barrier();
 		t = _top;
 		size = b - t;
@@ -185,16 +230,111 @@ public:
 		printf("deque at %p:\n",this);
 		long t = _top;
 		for(long i = t; i < _bottom; ++i) {
-			printf(" [%ld] = %p\n",i-t,_active_array.get(i));
+			printf(" [%ld] = %p\n",i-t,_active_array->get(i));
 		}
 	}
 	inline long size() const { return _bottom - _top; }
+	/**
+	 * @brief re-allocate the array from the calling (owner) thread, so
+	 * that it lands in memory local to where that thread runs
+	 */
+	inline void relocate()
+	{ // owner only
+		CircularArray<T> * a = _active_array;
+		replace_array(a->resize(_bottom,_top,a->log_size()));
+	}
+	/**
+	 * @brief bytes held by the active array (and its high water mark)
+	 */
+	inline size_t array_bytes() const { return _array_bytes; }
+	inline size_t array_bytes_high_water() const 
+	{ return _array_bytes_high_water; }
+
+private:
+	enum { Hazard_Index = SMR_HP_DEQUE_ARRAY };
+
+	/**
+	 * @brief claim the oldest element (or up to half of them when half)
+	 * @return the number claimed (0 with *out set to empty or abort)
+	 */
+	inline size_t claim(T ** out, size_t max_n, bool half)
+	{
+		long p = _pops;
+		long t = _top;
+		load_load_barrier();
+		long b = _bottom;
+		long size = b - t;
+		if(size <= 0 || max_n == 0) {
+			*out = empty;
+			return 0;
+		}
+		long n = (half ? (size+1)/2 : 1);
+		n = std::min(n,(long)std::min(max_n,(size_t)Steal_Claim_Max));
+		CircularArray<T> * a = protect_array();
+		for(long i = 0; i < n; ++i) {
+			out[i] = a->get(t+i);
+		}
+		HAZARD_PTR_RELEASE(Hazard_Index);
+		// pushes since b was read only add slots above the claim, and
+		// any pop would have moved _pops
+		if(!cas_pair(&_top,t,p,t+n,p)) {
+			*out = abort;
+			return 0;
+		}
+#ifdef CSW_DEQUE_BIG_LOG
+		for(long i = 0; i < n; ++i) {
+			big_log[(t+i)%100000] |= (1 << _tn.index);
+		}
+#endif
+		return n;
+	}
+
+	inline CircularArray<T> * protect_array()
+	{ // thieves keep the array they read from alive with a hazard ptr
+		CircularArray<T> * a;
+		do {
+			a = _active_array;
+			smr::set(a,Hazard_Index);
+		} while(a != _active_array);
+		return a;
+	}
+	inline void replace_array(CircularArray<T> * a)
+	{ // owner only
+		CircularArray<T> * old = _active_array;
+		write_barrier();
+		_active_array = a;
+		CircularArray<T>::retire(old);
+		_array_bytes = a->bytes();
+		if(_array_bytes > _array_bytes_high_water) {
+			_array_bytes_high_water = _array_bytes;
+		}
+	}
+	inline void maybe_shrink()
+	{ // owner only
+		CircularArray<T> * a = _active_array;
+		if(a->log_size() <= CircularArray<T>::default_log_size) {
+			return;
+		}
+		long b = _bottom;
+		long t = _top;
+		if(b - t >= a->size() / Shrink_Occupancy_Ratio) {
+			_low_occupancy_pops = 0;
+		} else if(++_low_occupancy_pops >= Shrink_Patience) {
+			_low_occupancy_pops = 0;
+			replace_array(a->shrink(b,t));
+		}
+	}
 
 private:
+	// _top and _pops are claimed together by cas_pair()
+	volatile long _top __attribute__((aligned(2*sizeof(long))));
+	volatile long _pops; // owner pops so far
 	volatile long _bottom;
-	volatile long _top;
-	CircularArray<T> * _active_array;
-	char _align_dontcare[256 - 2*sizeof(long) - sizeof(CircularArray<T> *)];
+	CircularArray<T> * volatile _active_array;
+	long _low_occupancy_pops;
+	size_t _array_bytes;
+	size_t _array_bytes_high_water;
+	char _align_dontcare[256 - 4*sizeof(long) - 2*sizeof(size_t) - sizeof(CircularArray<T> *)];
 };
 
 template< typename T >
@@ -26,6 +26,8 @@ namespace smr {
 
 HazardPtrForThread hazard[DEFAULT_MEMPOOL_MAX_THREADS];
 
+Stats stats;
+
 static int plist_compare(const void * l, const void * r)
 { return *(void**)l == *(void**)r ? 0 : ( *(void**)l < *(void**)r ? -1 : 1 ); }
 
@@ -70,6 +72,7 @@ PerThread::scan()
 	qsort(&plist[0], plist_ind , sizeof(plist[0]), plist_compare);
 // stage 3 & 4 (in place)
 	int new_dcount = 0;
+	long long reclaimed = 0;
 	for(size_t dl_i = 0; dl_i < _dcount; ++dl_i) {
 		if(plist_ind>0 && binary_search(_dlist[dl_i],plist_ind, plist)) {
 			_dlist[new_dcount].v = _dlist[dl_i].v;
@@ -80,9 +83,11 @@ PerThread::scan()
 			_dlist[dl_i].alloc->put(_dlist[dl_i].v);
 			_dlist[dl_i].v = NULL;
 			_dlist[dl_i].alloc = NULL;
+			++reclaimed;
 		}
 	}
 	_dcount = new_dcount;
+	stats.reclaimed += reclaimed;
 }
 
 
@@ -20,6 +20,7 @@
 
 #include "lockfree/OFluxThreadNumber.h"
 #include "lockfree/OFluxMachineSpecific.h"
+#include "lockfree/OFluxDistributedCounter.h"
 #include <cstdlib>
 #include <cassert>
 
@@ -37,11 +38,13 @@ namespace oflux {
 namespace lockfree {
 namespace smr {
 
-#define SMR_NUM_HAZARD_PTR 2
+#define SMR_NUM_HAZARD_PTR 3
+// hazard pointer slots 0 and 1 are used by the atomic waiter queues
+#define SMR_HP_DEQUE_ARRAY 2 // work stealing deque array
 
 struct HazardPtrForThread {
 	void * h[SMR_NUM_HAZARD_PTR];
-	char _unused[oflux::lockfree::MachineSpecific::Cache_Line_Size - sizeof(void *)];
+	char _unused[oflux::lockfree::MachineSpecific::Cache_Line_Size - SMR_NUM_HAZARD_PTR*sizeof(void *)];
 };
 
 extern HazardPtrForThread hazard[DEFAULT_MEMPOOL_MAX_THREADS];
@@ -52,6 +55,19 @@ enum    { SMR_P = DEFAULT_MEMPOOL_MAX_THREADS // num threads upper bound
 	, SMR_R = 2 * SMR_N   // batch size
 	};
 
+/**
+ * @brief blocks handed out by the DeferFree allocators (waiter lists and
+ * pooled atomics), and blocks freed: retired ones wait in a thread's
+ * list until no hazard pointer covers them, reclaimed ones are gone
+ */
+struct Stats {
+	Counter<long long> allocated;
+	Counter<long long> retired;
+	Counter<long long> reclaimed;
+};
+
+extern Stats stats;
+
 struct DListEntry {
 	void * v;
 	AllocatorImplementation * alloc;
@@ -73,6 +89,7 @@ public:
 		_dlist[_dcount].v = v;
 		_dlist[_dcount].alloc = &ai;
 		++_dcount;
+		++stats.retired;
 		if(_dcount >= SMR_R) {
 			scan();
 		}
@@ -92,6 +109,7 @@ public:
 	{
 		_per_thread.defer_put(v,ai);
 	}
+	inline static void allocated() { ++stats.allocated; }
 	inline static void init() // important to call this on thread creation
 	{ _per_thread.init_PerThread(); }
 private:
@@ -109,13 +127,26 @@ inline void set(T * hp, size_t n)
 	oflux::lockfree::mfence_or_equiv_barrier();
 }
 
+/**
+ * @brief clear the nth hazard pointer
+ * Unlike set() this needs no fence: the reads made through the hazard
+ * are not reordered after a later store on the (TSO) machines handled
+ * in OFluxMachineSpecific.h, so a compiler barrier is enough.
+ */
+inline void release(size_t n)
+{
+	size_t thr_ind = oflux::lockfree::_tn.index;
+	oflux::lockfree::write_barrier();
+	hazard[thr_ind].h[n] = NULL;
+}
+
 #define HAZARD_PTR_ASSIGN(H,HFROM,N) \
    H = HFROM; \
    ::oflux::lockfree::smr::set(H,N); \
    if(H != HFROM) continue;
 
 #define HAZARD_PTR_RELEASE(N) \
-   ::oflux::lockfree::smr::set((void*)NULL,N);
+   ::oflux::lockfree::smr::release(N);
 
 } // namespace smr
 } // namespace lockfree
@@ -288,6 +288,7 @@ public:
 	virtual ~AtomicExclusive() {}
 	virtual int held() const { return ! _waiters.empty(); }
 	virtual size_t waiter_count() { return _waiters.count(); }
+	virtual bool waiter_count_safe() const { return false; }
 	virtual bool has_no_waiters() { return !_waiters.has_waiters(); }
 	virtual int wtype() const { return EventBaseHolder::Exclusive; }
 	virtual const char * atomic_class() const
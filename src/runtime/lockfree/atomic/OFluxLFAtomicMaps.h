@@ -120,6 +120,10 @@ public:
 	{ return new K(); }
 	virtual void delete_key(void *o) const
 	{ delete reinterpret_cast<K *>(o); }
+	virtual size_t key_size() const { return sizeof(K); }
+	virtual void * construct_key(void * buf) const { return new (buf) K(); }
+	virtual void destroy_key(void * o) const
+	{ reinterpret_cast<K *>(o)->~K(); }
 	virtual oflux::atomic::AtomicMapWalker * walker()
 	{
 		KeyValueHashTableEnumerator<K,A> * enumer =
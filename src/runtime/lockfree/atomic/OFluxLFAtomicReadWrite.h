@@ -236,6 +236,7 @@ public:
 	}
 	virtual size_t waiter_count() 
 	{ return _waiters.count_waiters(); }
+	virtual bool waiter_count_safe() const { return false; }
 	virtual bool has_no_waiters()
 	{ 
 		return !_waiters.has_waiters();
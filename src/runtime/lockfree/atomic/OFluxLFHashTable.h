@@ -20,6 +20,9 @@
 
 #include <cassert>
 #include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <stdint.h>
 #include "OFlux.h" // for the hash stuff
 #include "lockfree/OFluxEnumerator.h"
 #include "lockfree/OFluxMachineSpecific.h"
@@ -77,8 +80,8 @@ public:
 	static const V * Copied_Value;
 	static const V * TombStone;
 
-	static const unsigned int TAG1 = 1U;
-		//(1U << (sizeof(unsigned int)*8 -1));
+	// low bit of a value pointer (values are at least 2-aligned)
+	static const uintptr_t TAG1 = 1U;
 
 	class Cas_Expect {
 	public:
@@ -87,7 +90,7 @@ public:
 		static const V * Does_Not_Exist;
 	};
 
-	static CompileCheck<sizeof(unsigned int) == sizeof(const V *)> cc_v_ptr_size;
+	static CompileCheck<sizeof(uintptr_t) == sizeof(const V *)> cc_v_ptr_size;
 	static inline const V * Tag_Value(const V * v) {
 		return reinterpret_cast<const V*>((uintptr_t)v | TAG1);
 	}
@@ -152,6 +155,9 @@ public:
 		K * key; // use the has_ptr template
 		V * value;
 	};
+	// a bucket is the Entry-s in one cache line (4 with 64-bit pointers)
+	static CompileCheck<(MachineSpecific::Cache_Line_Size 
+			% sizeof(Entry)) == 0> cc_entry_size;
 
 	/*static const K * key_from_value(const V *v) {
 		static const Entry e;
@@ -200,6 +206,7 @@ public:
 		, _next(NULL)
 		, _probe(_scale * 1.5 + 2)
 		, _ref_count(1)
+		, _retired_next(NULL)
 	{
 		size_t quarter = (1ULL << (_scale -2)) / Entries_Per_Bucket;
 		if(_probe  > quarter && quarter > 4) {
@@ -207,28 +214,36 @@ public:
 		}
 		assert(_probe);
 		size_t sz = (1ULL << _scale);
-		_table = new Entry[sz];
+		void * mem = NULL;
+		if(posix_memalign(&mem,Cache_Line_Size,sz*sizeof(Entry))) {
+			throw std::bad_alloc();
+		}
+		_table = reinterpret_cast<Entry *>(mem);
+		for(size_t i = 0; i < sz; ++i) {
+			new (const_cast<Entry *>(_table+i)) Entry();
+		}
 		assert(_scale >= Min_Scale && _scale < 63); // size must be a power of 2
 		assert(sizeof(Entry) * Entries_Per_Bucket % Cache_Line_Size == 0); // divisible into cache
-		//assert((size_t)_table % Cache_Line_Size == 0); // cache aligned
+		assert((uintptr_t)_table % Cache_Line_Size == 0); // cache aligned
 	}
 
 	~HashTableImplementation() {
-		HashTableEnumeratorBase<K,V,KVEnumeratorRef<K,V> > enumr(this,true);
-		const K * kp;
-		const V * vp;
-		while(enumr.next(kp,vp)) {
+		size_t sz = (_table ? (1ULL << _scale) : 0);
+		for(size_t i = 0; i < sz; ++i) {
+			K * kp = _table[i].key;
+			V * vp = _table[i].value;
+			if(HTC::Is_Tagged(vp)) {
+				continue; // key and value now belong to _next
+			}
 			if(kp) {
 				delete kp;
-				kp = NULL;
 			}
-			if(vp && vp != HTC::TombStone && vp != HTC::Copied_Value ) {
+			if(vp && vp != HTC::TombStone) {
 				delete vp;
-				vp = NULL;
 			}
 		}
 		if(_table) { 
-			delete [] _table;
+			free(const_cast<Entry *>(_table)); // Entry is trivial
 			_table = NULL;
 		}
 		if(_next) {
@@ -471,7 +486,11 @@ protected:
 	// a particular element (hash given)
 	inline size_t 
 	nextIndex(size_t old_index, size_t k_hash) {
-		size_t incr = (k_hash >> (32 - _scale));
+		// the stride comes from the high bits of the low 32 
+		// (hash values are often only 32 bits wide)
+		size_t incr = (_scale < 32
+			? ((k_hash & MASK(32)) >> (32 - _scale))
+			: (k_hash >> 32));
 		if(incr < Entries_Per_Bucket) {
 			incr += Entries_Per_Bucket;
 		}
@@ -529,9 +548,9 @@ protected:
 				return true;
 			}
 		}
-		ent_val = __sync_fetch_and_or(
-			  &ent->value
-			, HTC::Tag_Value(0));
+		ent_val = reinterpret_cast<const V *>(__sync_fetch_and_or(
+			  reinterpret_cast<volatile uintptr_t *>(&ent->value)
+			, HTC::TAG1));
 		if(ent_val == HTC::Copied_Value
 				|| ent_val == HTC::Tag_Value(HTC::TombStone)) {
 			return false;
@@ -618,8 +637,7 @@ protected:
 	int 
 	release() {
 		assert(_ref_count > 0);
-		_ref_count = __sync_fetch_and_add(&_ref_count,-1);
-		return _ref_count;
+		return __sync_add_and_fetch(&_ref_count,-1);
 	}
 
 	// count() _____________________________________________________
@@ -637,6 +655,7 @@ protected:
 	Stats                          _stats;
 	size_t                         _probe;
 	int                            _ref_count;
+	HashTableImplementation<K,V> * _retired_next; // see HashTable::retire
 };
 
 template< typename K
@@ -735,6 +754,7 @@ public:
 
 	HashTable()
 		: _impl(new Implementation(*this))
+		, _retired(NULL)
 	{}
 
 	~HashTable() {
@@ -742,6 +762,12 @@ public:
 			delete _impl;
 			_impl = NULL;
 		}
+		while(_retired) {
+			Implementation * r = _retired;
+			_retired = r->_retired_next;
+			r->_next = NULL; // only the live chain owns _next
+			delete r;
+		}
 	}
 
 	// size() ______________________________________________________
@@ -753,6 +779,7 @@ public:
 		Implementation * impl = _impl;
 		while(impl) {
 			res += impl->count();
+			impl = impl->_next;
 		}
 		return res;
 	}
@@ -818,9 +845,8 @@ public:
 						, impl->_next)) {
 					//printf("%d impl up %p %p\n", pthread_self(), impl, impl->_next);
 					Implementation * impl_next = impl->_next;
-					if(0 == impl->release()) {
-						delete impl;
-					}
+					impl->release();
+					retire(impl);
 					impl = impl_next;
 				}
 			}
@@ -856,8 +882,19 @@ public:
 			new KeyValueHashTableEnumerator<K,V>(_impl);
 		//);
 	}
+private:
+	// unlinked tables may still be read by other threads, 
+	// so they are kept until the table goes (at most the live size)
+	void retire(Implementation * impl) {
+		Implementation * r;
+		do {
+			r = _retired;
+			impl->_retired_next = r;
+		} while(!__sync_bool_compare_and_swap(&_retired,r,impl));
+	}
 private:
 	Implementation * _impl;
+	Implementation * volatile _retired;
 };
 
 } // namespace lockfree
@@ -19,25 +19,36 @@
 #include "lockfree/OFluxDistributedCounter.h"
 #include "lockfree/OFluxThreadNumber.h"
 #include <pthread.h>
+#include <sys/time.h>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
+#include <algorithm>
+
+/**
+ * @file test_lfhashtable.cpp
+ * Throughput benchmark for the lock-free hash table:
+ *   test_lfhashtable [-t] [threads [ops/thread [key range [get %]]]]
+ * Each thread does a random mix of get/insert/remove on 64-bit keys
+ * spread over the key range.  At the end the number of successful 
+ * inserts less successful removes must match what is in the table
+ * (-t also walks the table with an enumerator).
+ */
 
 using namespace oflux::lockfree;
 using namespace oflux;
 
 struct Key {
-	int a;
-	int b;
+	long long a;
+	long long b;
 
 	bool operator==(const Key & k) const {
 		return (a==k.a) && (b == k.b);
 	}
-	size_t hash() const { return (size_t)(a^b); }
 };
 
 struct Value {
-	int f;
+	long long f;
 };
 
 
@@ -45,121 +56,199 @@ namespace oflux {
 template<>
 struct hash<Key> {
 	inline size_t operator()(const Key& k) const
-	{
-		return (size_t)(k.a ^ k.b);
+	{ // spread across all 64 bits (tests the wide hashes)
+		unsigned long long h = (k.a ^ k.b) * 0x9E3779B97F4A7C15ULL;
+		return (size_t)(h ^ (h >> 29));
 	}
 };
 } //namespace oflux;
 
 
-enum { num_threads = 4 };
+size_t num_threads = 4;
+size_t num_ops = 1000000; // per thread
+long long key_range = 100000;
+size_t get_percent = 80;
 
 typedef HashTable<Key,Value> HT;
 
 Counter<size_t> get_hit_count;
 Counter<size_t> get_miss_count;
-Counter<size_t> insert_hit_count;
-Counter<size_t> insert_miss_count;
-Counter<size_t> remove_hit_count;
+Counter<size_t> insert_count; // new key
+Counter<size_t> insert_exists_count; // key was already there
+Counter<size_t> remove_count;
 Counter<size_t> remove_miss_count;
 
 const Value * Does_Not_Exist =
 	HT::HTC::Does_Not_Exist;
 
-void * run_thread(void *htvoid)
+pthread_barrier_t barrier;
+
+struct ThreadArg {
+	HT * ht;
+	int index;
+};
+
+static inline unsigned long long
+next_rand(unsigned long long & x)
+{ // xorshift64
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return x;
+}
+
+void * run_thread(void *vp)
 {
-	HT * ht = reinterpret_cast<HT *>(htvoid);
-	ThreadNumber::init();
-	for(size_t i = 0; i < 50000; ++i) {
-		Key k = { _tn.index%2, i};
-		if((i+_tn.index)%2) {
-			Value * v = new Value();
-			v->f =  i / ((double) _tn.index);
-			const Value * ov = ht->compareAndSwap(
-					  k
-					, Does_Not_Exist
-					, v);
-			if(ov != Does_Not_Exist) {
-				++insert_hit_count;
-			} else {
-				++insert_miss_count;
-			}
-		} else {
+	ThreadArg * ta = reinterpret_cast<ThreadArg *>(vp);
+	HT * ht = ta->ht;
+	ThreadNumber::init(ta->index);
+	unsigned long long r = 0x2545F4914F6CDD1DULL * (ta->index + 1);
+	pthread_barrier_wait(&barrier);
+	for(size_t i = 0; i < num_ops; ++i) {
+		long long kv = next_rand(r) % key_range;
+		Key k = { kv, kv << 32 }; // keys use the high 32 bits too
+		size_t op = next_rand(r) % 100;
+		if(op < get_percent) {
 			const Value * v = ht->get(k);
 			if(v != Does_Not_Exist) {
 				++get_hit_count;
 			} else {
 				++get_miss_count;
 			}
-		}
-	}
-	for(size_t i = 0; i < 50000; ++i) {
-		Key k = { _tn.index%2, i};
-		if((i+_tn.index)%2) {
-			const Value * v = ht->remove(k);
-			if(v != Does_Not_Exist) {
-				delete v;
-				++remove_hit_count;
+		} else if((op - get_percent) % 2) {
+			Value * v = new Value();
+			v->f = kv;
+			const Value * ov = ht->compareAndSwap(
+					  k
+					, HT::HTC::Cas_Expect::Does_Not_Exist
+					, v);
+			if(ov == Does_Not_Exist) {
+				++insert_count;
 			} else {
-				++remove_miss_count;
+				delete v;
+				++insert_exists_count;
 			}
 		} else {
-			const Value * v = ht->get(k);
+			// removed values are not freed: others may be reading them
+			const Value * v = ht->remove(k);
 			if(v != Does_Not_Exist) {
-				++get_hit_count;
+				++remove_count;
 			} else {
-				++get_miss_count;
+				++remove_miss_count;
 			}
 		}
 	}
 	return NULL;
 }
 
-void
+size_t
 traverse_map(HT & table)
 {
 	KeyValueHashTableEnumerator<Key,Value> * kv_enum =
 		table.getKeyValues();
 	const Key * kp = NULL;
 	const Value * vp = NULL;
+	size_t n = 0;
 	while(kv_enum->next(kp,vp)) {
-		// do something?
+		assert(vp->f == kp->a);
+		++n;
 	}
+	delete kv_enum;
+	return n;
+}
+
+static double
+now()
+{
+	struct timeval tv;
+	gettimeofday(&tv,NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
 }
 
 int main(int argc, char * argv[])
 {
+	bool traverse = false;
+	if(argc > 1 && strcmp(argv[1],"-t") == 0) {
+		traverse = true;
+		--argc;
+		++argv;
+	}
+	if(argc >= 2) {
+		num_threads = std::max(1,std::min(16,atoi(argv[1])));
+	}
+	if(argc >= 3) {
+		num_ops = atol(argv[2]);
+	}
+	if(argc >= 4) {
+		key_range = std::max(1LL,atoll(argv[3]));
+	}
+	if(argc >= 5) {
+		get_percent = std::min(100,atoi(argv[4]));
+	}
+	printf("%u threads %u ops/thread %lld keys %u%% gets (%u-bit pointers)\n"
+		, (unsigned)num_threads
+		, (unsigned)num_ops
+		, key_range
+		, (unsigned)get_percent
+		, (unsigned)(sizeof(void *)*8));
 	HT htable;
 	pthread_t tids[num_threads];
+	ThreadArg targs[num_threads];
+	pthread_barrier_init(&barrier,NULL,num_threads+1);
 	for(size_t i = 0; i < num_threads; ++i) {
-		int err = pthread_create(&tids[i],NULL,run_thread,&htable);
+		targs[i].ht = &htable;
+		targs[i].index = i;
+		int err = pthread_create(&tids[i],NULL,run_thread,&targs[i]);
 		if(err != 0) {
 			exit(11);
 		}
 	}
-	time_t startt = time(NULL);
+	pthread_barrier_wait(&barrier);
+	double startt = now();
 	void * tret = NULL;
-	if(argc > 1 && strcmp(argv[1],"-t") == 0) {
-		traverse_map(htable);
-	}
-	printf("statistics (hit/miss counts):\n");
 	for(size_t i=0; i < num_threads; ++i) {
 		int err = pthread_join(tids[i],&tret);
 		if(err != 0) {
 			exit(12);
 		}
-		/*printf("thread %u malloced %ld freed %ld collected %ld\n"
-			, i
-			, malloc_counter[i]
-			, free_counter[i]
-			, collect_counter[i]);*/
-		printf("thread %u get %u/%u insert %u/%u remove %u/%u\n"
-			, i
-			, get_hit_count[i] , get_miss_count[i]
-			, insert_hit_count[i], insert_miss_count[i]
-			, remove_hit_count[i], remove_miss_count[i] );
 	}
-	time_t endt = time(NULL);
-	printf("total time the test ran %ld sec\n", endt - startt);
-	return 0;
+	double elapsed = now() - startt;
+	printf("statistics (hit/miss counts):\n");
+	size_t inserted = 0;
+	size_t removed = 0;
+	for(size_t i=0; i < num_threads; ++i) {
+		printf("thread %u get %lu/%lu insert %lu/%lu remove %lu/%lu\n"
+			, (unsigned)i
+			, (unsigned long)get_hit_count[i]
+			, (unsigned long)get_miss_count[i]
+			, (unsigned long)insert_count[i]
+			, (unsigned long)insert_exists_count[i]
+			, (unsigned long)remove_count[i]
+			, (unsigned long)remove_miss_count[i]);
+		inserted += insert_count[i];
+		removed += remove_count[i];
+	}
+	printf("%.3f sec %.2f Mops/sec (copies %lu probe %lu density %.1f%%)\n"
+		, elapsed
+		, (num_threads * num_ops) / elapsed / 1e6
+		, (unsigned long)htable._copies
+		, (unsigned long)htable._probe
+		, htable._density);
+	size_t expected = inserted - removed;
+	size_t present = 0;
+	for(long long kv = 0; kv < key_range; ++kv) {
+		Key k = { kv, kv << 32 };
+		present += (htable.get(k) != Does_Not_Exist);
+	}
+	printf("keys present %lu expected %lu\n"
+		, (unsigned long)present
+		, (unsigned long)expected);
+	if(traverse) {
+		size_t walked = traverse_map(htable);
+		printf("keys walked %lu\n", (unsigned long)walked);
+		if(walked != expected) {
+			return 2;
+		}
+	}
+	return (present == expected ? 0 : 1);
 }
@@ -22,6 +22,8 @@
 #include <deque>
 #include <pthread.h>
 #include "OFluxWorkStealingDeque.h"
+#include "lockfree/OFluxThreadNumber.h"
+#include "lockfree/allocator/OFluxSMR.h"
 
 using namespace oflux::lockfree;
 
@@ -46,6 +48,8 @@ void *
 run_thread (void *vp)
 {
 	int * ip = reinterpret_cast<int *>(vp);
+	ThreadNumber::init(*ip); // index for hazard pointers
+	smr::DeferFree::init();
 	long total_event_executions = 0;
 	long total_steal_successes = 0;
 	long total_steal_failures = 0;
@@ -0,0 +1,186 @@
+/*
+ *    OFlux: a domain specific language with event-based runtime for C++ programs
+ *    Copyright (C) 2008-2012  Mark Pichora <mark@oanda.com> OANDA Corp.
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Affero General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//
+// This program converts a runtime trace dump (see OFluxTrace.h, written
+// as file.1, file.2, ... when OFLUX_CONFIG has trace=file) to the Chrome
+// trace event JSON that chrome://tracing and the Perfetto UI load:
+//   trace2json app.trace.1 > app.json
+// Each traced thread is a track: node executions are slices, queue
+// pushes/pops/steals and guard waits are instants on them.
+
+#include "OFluxTrace.h"
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+using oflux::trace::Record;
+
+struct Thread {
+	int label;
+	std::vector<Record> records;
+};
+
+static bool
+read_ints(FILE * f, int * is, size_t n)
+{
+	return fread(is,sizeof(int),n,f) == n;
+}
+
+static std::string
+quoted(const std::string & s)
+{
+	std::string res("\"");
+	for(size_t i = 0; i < s.size(); ++i) {
+		if(s[i] == '"' || s[i] == '\\') {
+			res += '\\';
+		}
+		res += s[i];
+	}
+	return res + "\"";
+}
+
+static const char *
+arg_name(int kind)
+{
+	switch(kind) {
+	case oflux::trace::K_push:
+	case oflux::trace::K_pop:
+		return "lane";
+	case oflux::trace::K_steal:
+		return "victim";
+	case oflux::trace::K_exec_end:
+		return "rc";
+	default:
+		return NULL;
+	}
+}
+
+int
+main(int argc, char * argv[])
+{
+	if(argc <= 1) {
+		fprintf(stderr,"provide a trace dump file argument\n");
+		return 9;
+	}
+	FILE * f = fopen(argv[1],"rb");
+	if(!f) {
+		fprintf(stderr,"could not open %s\n",argv[1]);
+		return 1;
+	}
+	char magic[8];
+	int hdr[2];
+	if(fread(magic,1,8,f) != 8
+			|| strncmp(magic,OFLUX_TRACE_MAGIC,8) != 0
+			|| !read_ints(f,hdr,2)
+			|| hdr[0] != (int)sizeof(Record)) {
+		fprintf(stderr,"%s is not a trace dump from this platform\n",argv[1]);
+		return 2;
+	}
+	std::map<int,std::string> names;
+	for(int i = 0; i < hdr[1]; ++i) {
+		int nd[2];
+		if(!read_ints(f,nd,2)) {
+			fprintf(stderr,"%s is truncated\n",argv[1]);
+			return 2;
+		}
+		std::vector<char> name(nd[1]+1,'\0');
+		if(fread(&name[0],1,nd[1],f) != (size_t)nd[1]) {
+			fprintf(stderr,"%s is truncated\n",argv[1]);
+			return 2;
+		}
+		names[nd[0]] = &name[0];
+	}
+	int num_threads = 0;
+	read_ints(f,&num_threads,1);
+	std::vector<Thread> threads(num_threads);
+	long long ts0 = 0;
+	for(int i = 0; i < num_threads; ++i) {
+		int th[2];
+		if(!read_ints(f,th,2)) {
+			fprintf(stderr,"%s is truncated\n",argv[1]);
+			return 2;
+		}
+		threads[i].label = th[0];
+		threads[i].records.resize(th[1]);
+		if(th[1] && fread(&threads[i].records[0],sizeof(Record),th[1],f)
+				!= (size_t)th[1]) {
+			fprintf(stderr,"%s is truncated\n",argv[1]);
+			return 2;
+		}
+		if(th[1] && (ts0 == 0 || threads[i].records[0].ts < ts0)) {
+			ts0 = threads[i].records[0].ts;
+		}
+	}
+	fclose(f);
+
+	const char * sep = "\n";
+	printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	for(int i = 0; i < num_threads; ++i) {
+		const Thread & t = threads[i];
+		printf("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d"
+			",\"args\":{\"name\":\"thread %d\"}}"
+			, sep
+			, t.label
+			, t.label);
+		sep = ",\n";
+		int depth = 0; // exec slices open
+		for(size_t j = 0; j < t.records.size(); ++j) {
+			const Record & r = t.records[j];
+			std::map<int,std::string>::const_iterator nitr = names.find(r.node);
+			std::string node;
+			if(nitr != names.end()) {
+				node = nitr->second;
+			} else { // from an earlier flow (or none)
+				char buff[32];
+				snprintf(buff,sizeof(buff),"node %d",r.node);
+				node = buff;
+			}
+			const char * ph = "i";
+			if(r.kind == oflux::trace::K_exec_begin) {
+				ph = "B";
+				++depth;
+			} else if(r.kind == oflux::trace::K_exec_end) {
+				if(depth == 0) {
+					continue; // its begin was overwritten
+				}
+				ph = "E";
+				--depth;
+			}
+			printf("%s{\"name\":%s,\"cat\":\"%s\",\"ph\":\"%s\"%s"
+				",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"ev\":\"%p\""
+				, sep
+				, quoted(*ph == 'i'
+					? std::string(oflux::trace::kind_name(r.kind)) + " " + node
+					: node).c_str()
+				, oflux::trace::kind_name(r.kind)
+				, ph
+				, (*ph == 'i' ? ",\"s\":\"t\"" : "")
+				, t.label
+				, (r.ts - ts0) / 1000.0
+				, r.ev);
+			if(arg_name(r.kind)) {
+				printf(",\"%s\":%d",arg_name(r.kind),r.arg);
+			}
+			printf("}}");
+		}
+	}
+	printf("\n]}\n");
+	return 0;
+}
@@ -198,6 +198,9 @@ public:
 	static const char * attr_isnegated;
 	static const char * attr_iserrhandler;
 	static const char * attr_detached;
+	static const char * attr_priority;
+	static const char * attr_maxinflight;
+	static const char * attr_period;
 	static const char * attr_unionhash;
 	static const char * attr_inputunionhash;
 	static const char * attr_outputunionhash;
@@ -836,6 +839,9 @@ const char * XMLVocab::attr_door = "door";
 const char * XMLVocab::attr_isnegated = "isnegated";
 const char * XMLVocab::attr_iserrhandler = "iserrhandler";
 const char * XMLVocab::attr_detached = "detached";
+const char * XMLVocab::attr_priority = "priority";
+const char * XMLVocab::attr_maxinflight = "maxinflight";
+const char * XMLVocab::attr_period = "period";
 const char * XMLVocab::attr_unionhash = "unionhash";
 const char * XMLVocab::attr_inputunionhash = "inputunionhash";
 const char * XMLVocab::attr_outputunionhash = "outputunionhash";
@@ -880,6 +886,9 @@ fillAttributeMap(
 		, XMLVocab::attr_isnegated
 		, XMLVocab::attr_iserrhandler
 		, XMLVocab::attr_detached
+		, XMLVocab::attr_priority
+		, XMLVocab::attr_maxinflight
+		, XMLVocab::attr_period
 		, XMLVocab::attr_unionhash
 		, XMLVocab::attr_inputunionhash
 		, XMLVocab::attr_outputunionhash
@@ -1156,7 +1165,11 @@ flow_element_factory<flow::Node>(AttributeMap & amap, Reader & reader)
 			, is_door
 			, amap.getOrThrow(XMLVocab::attr_detached).boolVal()
 			, amap.getOrThrow(XMLVocab::attr_inputunionhash).c_str()
-			, amap.getOrThrow(XMLVocab::attr_outputunionhash).c_str());
+			, amap.getOrThrow(XMLVocab::attr_outputunionhash).c_str()
+			, amap.getOrDefault(XMLVocab::attr_priority,"0").intVal());
+		result->max_in_flight(amap.getOrDefault(XMLVocab::attr_maxinflight,"0").intVal());
+		// microseconds in the XML
+		result->period_ns(1000LL * amap.getOrDefault(XMLVocab::attr_period,"0").intVal());
 	}
 	return result;
 }
@@ -1196,6 +1209,7 @@ flow_element_factory<flow::Flow>(AttributeMap & amap, Reader & reader)
 		f = ( ef 
 			? new flow::Flow(*ef,name) 
 			: new flow::Flow(name));
+		f->admission().max_in_flight(amap.getOrDefault(XMLVocab::attr_maxinflight,"0").intVal());
 	}
 	return f;
 }
@@ -1249,6 +1263,8 @@ Reader::read( const char * filename )
         for(int i = 0; i < (int)_set_error_handlers.size(); i++) {
                 _set_error_handlers[i].execute(flow);
         }
+        flow->compile_successors();
+        flow->bind_guards();
         flow->pretty_print(); // to the log
 	return flow;
 }
@@ -0,0 +1,149 @@
+#include "atomic/OFluxAtomic.h"
+#include <gtest/gtest.h>
+#include <set>
+
+namespace oflux {
+ class RunTimeAbstractForShim;
+} // namespace oflux
+
+oflux::RunTimeAbstractForShim *eminfo = NULL; // need this symbol due to doors
+
+using namespace oflux;
+
+typedef atomic::AtomicMapSharded<int> OrderedMap;
+typedef atomic::AtomicMapSharded<int,atomic::AtomicExclusive,false> UnorderedMap;
+typedef atomic::AtomicMapSharded<int,atomic::AtomicExclusive,true,4,true> LockedMap;
+
+class OFluxAtomicMapShardedTests : public testing::Test {
+public:
+	enum { Num_Keys = 2000 };
+
+	OFluxAtomicMapShardedTests() {}
+	virtual ~OFluxAtomicMapShardedTests() {}
+	virtual void SetUp() {}
+	virtual void TearDown() {}
+
+	template<typename M>
+	const int * get(M & m, int k, atomic::Atomic * & a)
+	{
+		return reinterpret_cast<const int *>(m.get(a,&k));
+	}
+	template<typename M>
+	std::vector<int> walk(M & m)
+	{
+		std::vector<int> res;
+		atomic::AtomicMapWalker * w = m.walker();
+		const void * k = NULL;
+		atomic::Atomic * a = NULL;
+		while(w->next(k,a)) {
+			res.push_back(*reinterpret_cast<const int *>(k));
+		}
+		delete w;
+		return res;
+	}
+};
+
+TEST_F(OFluxAtomicMapShardedTests,GetInsertsOnce) {
+	OrderedMap m;
+	atomic::Atomic * a1 = NULL;
+	atomic::Atomic * a2 = NULL;
+	atomic::Atomic * a3 = NULL;
+	const int * k1 = get(m,7,a1);
+	const int * k2 = get(m,7,a2);
+	const int * k3 = get(m,8,a3);
+	ASSERT_TRUE(k1 != NULL);
+	EXPECT_EQ(7,*k1);
+	EXPECT_EQ(k1,k2) << "same key, same entry";
+	EXPECT_EQ(a1,a2);
+	EXPECT_NE(a1,a3);
+	EXPECT_EQ(8,*k3);
+	EXPECT_EQ(2,walk(m).size());
+}
+
+TEST_F(OFluxAtomicMapShardedTests,EraseRecyclesTheEntry) {
+	OrderedMap m;
+	atomic::Atomic * a = NULL;
+	const int * k = get(m,42,a);
+	EXPECT_TRUE(m.garbage_collect(k,a));
+	EXPECT_TRUE(walk(m).empty());
+	int missing = 42;
+	EXPECT_FALSE(m.garbage_collect(&missing,a)) << "already erased";
+	atomic::Atomic * a2 = NULL;
+	const int * k2 = get(m,43,a2); // same shard or not, 42's slot is free
+	atomic::Atomic * a3 = NULL;
+	const int * k3 = get(m,42,a3);
+	EXPECT_TRUE(k2 == k || k3 == k) << "erased entry memory is reused";
+	EXPECT_EQ(42,*k3);
+}
+
+TEST_F(OFluxAtomicMapShardedTests,FindsPastTombstones) {
+	OrderedMap m;
+	std::vector<const int *> keys(Num_Keys);
+	std::vector<atomic::Atomic *> atoms(Num_Keys);
+	for(int i = 0; i < Num_Keys; ++i) {
+		keys[i] = get(m,i,atoms[i]); // grows (rebuilds) each shard
+	}
+	for(int i = 0; i < Num_Keys; i += 2) {
+		ASSERT_TRUE(m.garbage_collect(keys[i],atoms[i]));
+	}
+	for(int i = 1; i < Num_Keys; i += 2) {
+		atomic::Atomic * a = NULL;
+		ASSERT_EQ(keys[i],get(m,i,a)) << "key " << i;
+		ASSERT_EQ(atoms[i],a);
+	}
+	EXPECT_EQ(Num_Keys/2,walk(m).size());
+	// erase and re-insert in rounds: tombstones must not pile up
+	for(int round = 0; round < 8; ++round) {
+		for(int i = 0; i < Num_Keys; i += 2) {
+			keys[i] = get(m,i,atoms[i]);
+		}
+		for(int i = 0; i < Num_Keys; i += 2) {
+			ASSERT_TRUE(m.garbage_collect(keys[i],atoms[i]));
+		}
+	}
+	for(int i = 1; i < Num_Keys; i += 2) {
+		atomic::Atomic * a = NULL;
+		ASSERT_EQ(keys[i],get(m,i,a)) << "key " << i;
+	}
+	EXPECT_EQ(Num_Keys/2,walk(m).size());
+}
+
+TEST_F(OFluxAtomicMapShardedTests,OrderedWalker) {
+	OrderedMap m;
+	atomic::Atomic * a = NULL;
+	for(int i = 0; i < Num_Keys; ++i) {
+		get(m,(i * 7919) % Num_Keys,a); // all keys, scrambled
+	}
+	std::vector<int> ks = walk(m);
+	ASSERT_EQ(Num_Keys,ks.size());
+	for(int i = 0; i < Num_Keys; ++i) {
+		ASSERT_EQ(i,ks[i]);
+	}
+}
+
+TEST_F(OFluxAtomicMapShardedTests,UnorderedWalkerSeesAll) {
+	UnorderedMap m;
+	atomic::Atomic * a = NULL;
+	for(int i = 0; i < 100; ++i) {
+		get(m,i,a);
+	}
+	std::vector<int> ks = walk(m);
+	std::set<int> seen(ks.begin(),ks.end());
+	EXPECT_EQ(100,ks.size());
+	EXPECT_EQ(100,seen.size());
+}
+
+TEST_F(OFluxAtomicMapShardedTests,Locked) {
+	LockedMap m;
+	atomic::Atomic * a1 = NULL;
+	atomic::Atomic * a2 = NULL;
+	const int * k = get(m,1,a1);
+	EXPECT_EQ(k,get(m,1,a2));
+	EXPECT_TRUE(m.garbage_collect(k,a1));
+	EXPECT_TRUE(walk(m).empty());
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,101 @@
+#include "OFluxAffinity.h"
+#include <gtest/gtest.h>
+
+namespace oflux {
+ class RunTimeAbstractForShim;
+} // namespace oflux
+
+oflux::RunTimeAbstractForShim *eminfo = NULL; // need this symbol due to doors
+
+using namespace oflux;
+
+class OFluxCpuSetTests : public testing::Test {
+public:
+	OFluxCpuSetTests() {}
+	virtual ~OFluxCpuSetTests() {}
+	virtual void SetUp() {}
+	virtual void TearDown() {}
+
+	std::string parsed(const char * list)
+	{
+		std::vector<int> cpus;
+		const char * err = CpuSet::parse(list,cpus);
+		if(err) {
+			return std::string("error: ") + err;
+		}
+		std::string res;
+		for(size_t i = 0; i < cpus.size(); ++i) {
+			char buf[16];
+			snprintf(buf,sizeof(buf),"%s%d",i ? " " : "",cpus[i]);
+			res += buf;
+		}
+		return res;
+	}
+	bool rejected(const char * list)
+	{
+		std::vector<int> cpus;
+		return CpuSet::parse(list,cpus) != NULL;
+	}
+};
+
+TEST_F(OFluxCpuSetTests,Empty) {
+	EXPECT_EQ("",parsed(NULL));
+	EXPECT_EQ("",parsed(""));
+	CpuSet cs;
+	EXPECT_TRUE(cs.empty());
+	EXPECT_EQ("-",cs.str());
+}
+
+TEST_F(OFluxCpuSetTests,ListsAndRanges) {
+	EXPECT_EQ("3",parsed("3"));
+	EXPECT_EQ("0 1 2 3",parsed("0-3"));
+	EXPECT_EQ("0 1 2 3 8",parsed("0-3,8"));
+	EXPECT_EQ("8 2",parsed("8,2")) << "order kept";
+	EXPECT_EQ("5",parsed("5-5"));
+}
+
+TEST_F(OFluxCpuSetTests,ReversedRange) {
+	EXPECT_TRUE(rejected("8-2"));
+	EXPECT_TRUE(rejected("0,3-1"));
+}
+
+TEST_F(OFluxCpuSetTests,HugeRange) {
+	EXPECT_TRUE(rejected("0-4000000000"));
+	EXPECT_TRUE(rejected("99999999"));
+	char last[16];
+	snprintf(last,sizeof(last),"%d",CpuSet::Max_Cpus-1);
+	EXPECT_FALSE(rejected(last));
+	snprintf(last,sizeof(last),"%d",CpuSet::Max_Cpus);
+	EXPECT_TRUE(rejected(last));
+}
+
+TEST_F(OFluxCpuSetTests,Malformed) {
+	EXPECT_TRUE(rejected("a"));
+	EXPECT_TRUE(rejected("-1"));
+	EXPECT_TRUE(rejected("1-"));
+	EXPECT_TRUE(rejected("1,"));
+	EXPECT_TRUE(rejected(",1"));
+	EXPECT_TRUE(rejected("1;2"));
+	EXPECT_TRUE(rejected("1- 2"));
+	EXPECT_TRUE(rejected("1 "));
+}
+
+TEST_F(OFluxCpuSetTests,BadListLeavesTheSetEmpty) {
+	CpuSet cs("8-2");
+	EXPECT_TRUE(cs.empty());
+	EXPECT_EQ(0,cs.pin()) << "nothing to pin";
+}
+
+TEST_F(OFluxCpuSetTests,Str) {
+	EXPECT_EQ("0-3,8",CpuSet("0,1,2,3,8").str());
+	EXPECT_EQ("2,4-5",CpuSet("2,4-5").str());
+	CpuSet cs("4-5");
+	EXPECT_EQ(2,cs.size());
+	EXPECT_EQ(4,cs[0]);
+	EXPECT_EQ(4,cs[2]) << "indexed modulo the size";
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,81 @@
+#include "lockfree/OFluxDistributedCounter.h"
+#include "lockfree/OFluxThreadNumber.h"
+#include <gtest/gtest.h>
+#include <pthread.h>
+
+namespace oflux {
+ class RunTimeAbstractForShim;
+} // namespace oflux
+
+oflux::RunTimeAbstractForShim *eminfo = NULL; // need this symbol due to doors
+
+using namespace oflux;
+
+typedef lockfree::Counter<long long> Counter;
+
+class OFluxDistributedCounterTests : public testing::Test {
+public:
+	enum { Num_Adds = 100000 };
+
+	OFluxDistributedCounterTests() {}
+	virtual ~OFluxDistributedCounterTests() {}
+	virtual void SetUp() {}
+	virtual void TearDown() {}
+};
+
+namespace {
+
+struct Bumper {
+	Counter * counter;
+	int index;
+};
+
+void *
+bump(void * v)
+{
+	Bumper * b = reinterpret_cast<Bumper *>(v);
+	lockfree::ThreadNumber::init(b->index);
+	for(int i = 0; i < OFluxDistributedCounterTests::Num_Adds; ++i) {
+		(*b->counter)++;
+	}
+	*(b->counter) += 2;
+	*(b->counter) -= 2;
+	return NULL;
+}
+
+} // namespace
+
+TEST_F(OFluxDistributedCounterTests,OwnedSlots) {
+	Counter c(5);
+	c++;
+	c += 10;
+	c--;
+	EXPECT_EQ(15,c.value());
+}
+
+TEST_F(OFluxDistributedCounterTests,ThreadsBeyondTheSlots) {
+	// 1 and 2 own slots, 32 and 40 share one (past the padded slots),
+	// and 1000 is far past the lock-free runtime's limit
+	int indices[] = { 1, 2, 32, 40, 1000 };
+	enum { Num_Threads = sizeof(indices)/sizeof(indices[0]) };
+	Counter c;
+	pthread_t th[Num_Threads];
+	Bumper b[Num_Threads];
+	for(int i = 0; i < Num_Threads; ++i) {
+		b[i].counter = &c;
+		b[i].index = indices[i];
+		ASSERT_EQ(0,pthread_create(&th[i],NULL,bump,&b[i]));
+	}
+	for(int i = 0; i < Num_Threads; ++i) {
+		void * dontcare;
+		pthread_join(th[i],&dontcare);
+	}
+	EXPECT_EQ((long long)Num_Threads * Num_Adds,c.value())
+		<< "no lost updates on the shared slots";
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	oflux::lockfree::ThreadNumber::init(0);
+	return RUN_ALL_TESTS();
+}
@@ -37,6 +37,24 @@ TEST_F(OFluxEventTests,Execute1) {
         EXPECT_EQ(0,r_next) << "next returnval check";
 }
 
+TEST_F(OFluxEventTests,PredecessorReferences) {
+        CreateNodeFn createfn_source = n_source.getCreateFn();
+        CreateNodeFn createfn_succ = n_succ.getCreateFn();
+        EventBaseSharedPtr ev_source(
+                (*createfn_source)(EventBase::no_event_shared,NULL,&n_source));
+        EXPECT_EQ(1,ev_source.use_count()) << "fresh event is unique";
+        EventBaseSharedPtr ev_succ(
+                (*createfn_succ)(ev_source,NULL,&n_succ));
+        EXPECT_EQ(2,ev_source.use_count()) << "successor holds its predecessor";
+        ev_succ->release();
+        EXPECT_EQ(1,ev_source.use_count()) << "release drops the predecessor";
+        EventBase * ev_raw = ev_source.recover();
+        EXPECT_TRUE(ev_raw != NULL) << "unique event can be recovered";
+        EXPECT_FALSE(ev_source) << "recovered pointer is emptied";
+        EventBaseSharedPtr ev_again(ev_raw);
+        EXPECT_EQ(1,ev_again.use_count()) << "recovered event is re-adopted";
+}
+
 int main(int argc, char **argv) {
 	testing::InitGoogleTest(&argc, argv);
 	return RUN_ALL_TESTS();
@@ -0,0 +1,126 @@
+#include "flow/OFluxFlow.h"
+#include "flow/OFluxFlowNode.h"
+#include "flow/OFluxFlowCase.h"
+#include "flow/OFluxFlowNodeIncr.h"
+#include <gtest/gtest.h>
+
+namespace oflux {
+ class RunTimeAbstractForShim;
+} // namespace oflux
+
+oflux::RunTimeAbstractForShim *eminfo = NULL; // need this symbol due to doors
+
+using namespace oflux::flow;
+
+class OFluxFlowAdmissionTests : public testing::Test {
+public:
+	OFluxFlowAdmissionTests()
+		: f("f")
+		, src(NULL)
+		, mid(NULL)
+	{}
+	virtual ~OFluxFlowAdmissionTests() {}
+	virtual void SetUp()
+	{
+		// src -> mid
+		src = new Node("src","src",NULL,NULL,false,true,false,false,"","");
+		mid = new Node("mid","mid",NULL,NULL,false,false,false,false,"","");
+		Successor * s = new Successor("s");
+		s->add(new Case("mid",mid));
+		SuccessorList * sl = new SuccessorList();
+		sl->add(s);
+		src->successor_list(sl);
+		f.add(src);
+		f.add(mid);
+	}
+	virtual void TearDown() {}
+
+	void in_flight(Node * n, long to)
+	{
+		while(n->in_flight() < to) n->count_in_flight(1);
+		while(n->in_flight() > to) n->count_in_flight(-1);
+	}
+	std::vector<Node *> resume()
+	{
+		std::vector<Node *> srcs;
+		f.admission().resume(srcs);
+		return srcs;
+	}
+
+	Flow f;
+	Node * src;
+	Node * mid;
+};
+
+TEST_F(OFluxFlowAdmissionTests,NoLimitsNothingCounted) {
+	f.compile_successors();
+	mid->count_in_flight(1);
+	EXPECT_EQ(0,mid->in_flight()) << "not covered by a limit";
+	EXPECT_TRUE(f.admission().admit(src));
+	EXPECT_FALSE(f.admission().has_parked());
+}
+
+TEST_F(OFluxFlowAdmissionTests,NodeLimitParksAndResumesAtThreeQuarters) {
+	mid->max_in_flight(8);
+	f.compile_successors();
+	in_flight(mid,7);
+	EXPECT_TRUE(f.admission().admit(src)) << "below the limit";
+	in_flight(mid,8);
+	EXPECT_FALSE(f.admission().admit(src)) << "at the limit";
+	EXPECT_TRUE(f.admission().has_parked());
+	EXPECT_TRUE(resume().empty()) << "still at the limit";
+	in_flight(mid,7);
+	EXPECT_TRUE(resume().empty()) << "below the limit, above 3/4 of it";
+	in_flight(mid,6);
+	std::vector<Node *> r = resume();
+	ASSERT_EQ(1,r.size());
+	EXPECT_EQ(src,r[0]);
+	EXPECT_FALSE(f.admission().has_parked());
+	EXPECT_TRUE(resume().empty()) << "resumed once";
+	in_flight(mid,0);
+}
+
+TEST_F(OFluxFlowAdmissionTests,ParkedOnce) {
+	mid->max_in_flight(4);
+	f.compile_successors();
+	in_flight(mid,4);
+	EXPECT_FALSE(f.admission().admit(src));
+	EXPECT_FALSE(f.admission().admit(src)) << "already parked";
+	in_flight(mid,3);
+	EXPECT_EQ(1,resume().size());
+	in_flight(mid,0);
+}
+
+TEST_F(OFluxFlowAdmissionTests,FlowLimitCountsEveryNode) {
+	f.admission().max_in_flight(4);
+	f.compile_successors();
+	in_flight(src,1);
+	in_flight(mid,2);
+	EXPECT_EQ(3,f.admission().in_flight());
+	EXPECT_TRUE(f.admission().admit(src));
+	in_flight(mid,3);
+	EXPECT_FALSE(f.admission().admit(src));
+	in_flight(src,0);
+	EXPECT_EQ(1,resume().size()) << "3 of 4 in flight";
+	in_flight(mid,0);
+	EXPECT_EQ(0,f.admission().in_flight());
+}
+
+TEST_F(OFluxFlowAdmissionTests,UnrunEventLeavesTheCount) {
+	mid->max_in_flight(4);
+	f.compile_successors();
+	{
+		NodeCounterIncrementer ran(mid);
+		NodeCounterIncrementer unrun(mid);
+		EXPECT_EQ(2,mid->in_flight());
+		ran.done_in_flight();
+		ran.done_in_flight();
+		EXPECT_EQ(1,mid->in_flight()) << "left once";
+	}
+	EXPECT_EQ(0,mid->in_flight()) << "destroyed without running";
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,138 @@
+#include "flow/OFluxFlowGuard.h"
+#include <gtest/gtest.h>
+
+namespace oflux {
+ class RunTimeAbstractForShim;
+} // namespace oflux
+
+oflux::RunTimeAbstractForShim *eminfo = NULL; // need this symbol due to doors
+
+using namespace oflux;
+using namespace oflux::flow;
+
+namespace {
+
+int live_keys = 0; // constructed and not yet destroyed
+
+template<size_t N>
+struct Key {
+	Key() : v(0) { ++live_keys; }
+	Key(const Key & k) : v(k.v) { ++live_keys; }
+	~Key() { --live_keys; }
+	bool operator<(const Key & k) const { return v < k.v; }
+
+	int v;
+	char pad[N];
+};
+
+typedef Key<4> SmallKey;
+typedef Key<2*GuardLocalKey::Inline_Key_Size> BigKey; // over the buffer
+
+template<typename K>
+struct Map {
+	typedef atomic::AtomicMapStdMap<atomic::StdMapPolicy<K> > type;
+};
+
+bool
+inside(const void * p, const void * obj, size_t sz)
+{
+	const char * c = reinterpret_cast<const char *>(p);
+	const char * o = reinterpret_cast<const char *>(obj);
+	return c >= o && c < o + sz;
+}
+
+} // namespace
+
+class OFluxFlowGuardTests : public testing::Test {
+public:
+	OFluxFlowGuardTests() {}
+	virtual ~OFluxFlowGuardTests() {}
+	virtual void SetUp() { live_keys = 0; }
+	virtual void TearDown() {}
+};
+
+TEST_F(OFluxFlowGuardTests,KeySizeFromTheMap) {
+	Map<SmallKey>::type small_map;
+	Map<BigKey>::type big_map;
+	Guard small_guard(&small_map,"small",false);
+	Guard big_guard(&big_map,"big",false);
+	Guard unbound(NULL,"unbound",false);
+	EXPECT_EQ(0,small_guard.key_size()) << "not bound yet";
+	small_guard.bind();
+	big_guard.bind();
+	unbound.bind();
+	EXPECT_EQ(sizeof(SmallKey),small_guard.key_size());
+	EXPECT_EQ(sizeof(BigKey),big_guard.key_size());
+	EXPECT_EQ(0,unbound.key_size());
+}
+
+TEST_F(OFluxFlowGuardTests,ConstructDestroyKey) {
+	Map<SmallKey>::type m;
+	Guard g(&m,"g",false);
+	g.bind();
+	union {
+		char bytes[sizeof(SmallKey)];
+		long long align_ll;
+	} buf;
+	void * k = g.construct_key(buf.bytes);
+	EXPECT_EQ((void *)buf.bytes,k) << "built in the given buffer";
+	EXPECT_EQ(1,live_keys);
+	EXPECT_EQ(0,reinterpret_cast<SmallKey *>(k)->v);
+	g.destroy_key(k);
+	EXPECT_EQ(0,live_keys);
+}
+
+TEST_F(OFluxFlowGuardTests,SmallKeyIsInline) {
+	Map<SmallKey>::type m;
+	Guard g(&m,"g",false);
+	g.bind();
+	{
+		GuardLocalKey lk(&g);
+		EXPECT_TRUE(inside(lk.get(),&lk,sizeof(lk)));
+		EXPECT_EQ(1,live_keys);
+		reinterpret_cast<SmallKey *>(lk.get())->v = 3;
+		atomic::Atomic * a = NULL;
+		const void * pk = g.get(a,lk.get());
+		EXPECT_NE(lk.get(),pk) << "map keeps its own copy";
+		EXPECT_EQ(3,reinterpret_cast<const SmallKey *>(pk)->v);
+		EXPECT_EQ(2,live_keys);
+	}
+	EXPECT_EQ(1,live_keys) << "local key destroyed, map copy remains";
+}
+
+TEST_F(OFluxFlowGuardTests,BigKeyIsOnTheHeap) {
+	Map<BigKey>::type m;
+	Guard g(&m,"g",false);
+	g.bind();
+	ASSERT_GT(g.key_size(),(size_t)GuardLocalKey::Inline_Key_Size);
+	{
+		GuardLocalKey lk(&g);
+		ASSERT_TRUE(lk.get() != NULL);
+		EXPECT_FALSE(inside(lk.get(),&lk,sizeof(lk)));
+		EXPECT_EQ(1,live_keys);
+		reinterpret_cast<BigKey *>(lk.get())->v = 5;
+		atomic::Atomic * a = NULL;
+		const void * pk = g.get(a,lk.get());
+		EXPECT_EQ(5,reinterpret_cast<const BigKey *>(pk)->v);
+	}
+	EXPECT_EQ(1,live_keys) << "heap key deleted, map copy remains";
+}
+
+TEST_F(OFluxFlowGuardTests,KeyAtTheInlineLimit) {
+	typedef Key<GuardLocalKey::Inline_Key_Size-sizeof(int)> FitKey;
+	ASSERT_EQ((size_t)GuardLocalKey::Inline_Key_Size,sizeof(FitKey));
+	Map<FitKey>::type m;
+	Guard g(&m,"g",false);
+	g.bind();
+	{
+		GuardLocalKey lk(&g);
+		EXPECT_TRUE(inside(lk.get(),&lk,sizeof(lk)));
+		EXPECT_EQ(1,live_keys);
+	}
+	EXPECT_EQ(0,live_keys);
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
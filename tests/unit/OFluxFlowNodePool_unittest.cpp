@@ -0,0 +1,127 @@
+#include "flow/OFluxFlowNodePool.h"
+#include "lockfree/OFluxThreadNumber.h"
+#include "OFluxWrappers.h"
+#include <gtest/gtest.h>
+#include <string.h>
+
+namespace oflux {
+ class RunTimeAbstractForShim; 
+} // namespace oflux
+
+oflux::RunTimeAbstractForShim *eminfo = NULL; // need this symbol due to doors
+
+using namespace oflux;
+using oflux::flow::NodeEventPool;
+
+class OFluxFlowNodePoolTests : public testing::Test {
+public:
+	OFluxFlowNodePoolTests() {}
+	virtual ~OFluxFlowNodePoolTests() {}
+	virtual void SetUp() { pool.sized(40); }
+	virtual void TearDown() {}
+
+	NodeEventPool pool;
+};
+
+TEST_F(OFluxFlowNodePoolTests,RecyclesOnSameThread) {
+	void * m1 = pool.get();
+	EXPECT_EQ(1,pool.misses()) << "first get goes to the heap";
+	pool.put(m1);
+	void * m2 = pool.get();
+	EXPECT_EQ(m1,m2) << "put block comes back";
+	EXPECT_EQ(1,pool.hits());
+	NodeEventPool::release(m2);
+	void * m3 = pool.get();
+	EXPECT_EQ(m1,m3) << "release returns to the owner pool";
+	pool.put(m3);
+}
+
+TEST_F(OFluxFlowNodePoolTests,HeapBlocksAreFreed) {
+	void * m = NodeEventPool::heap_get(64);
+	ASSERT_TRUE(m != NULL);
+	NodeEventPool::release(m); // no owner pool: back to the heap
+	EXPECT_EQ(0,pool.hits());
+	EXPECT_EQ(0,pool.misses());
+}
+
+TEST_F(OFluxFlowNodePoolTests,CollidingPoolsKeepTheirHits) {
+	NodeEventPool other[NodeEventPool::Thread_Cache_Slots];
+	// the last of other is Thread_Cache_Slots pools after pool
+	NodeEventPool & colliding = other[NodeEventPool::Thread_Cache_Slots-1];
+	colliding.sized(40);
+	EXPECT_NE(pool.index(),colliding.index());
+	pool.put(pool.get());
+	colliding.put(colliding.get());
+	for(int i = 0; i < 100; ++i) {
+		pool.put(pool.get());
+		colliding.put(colliding.get());
+	}
+	EXPECT_EQ(1,pool.misses()) << "pool's free list was not evicted";
+	EXPECT_EQ(100,pool.hits());
+	EXPECT_EQ(1,colliding.misses());
+	EXPECT_EQ(100,colliding.hits());
+}
+
+TEST_F(OFluxFlowNodePoolTests,ReusedIndexStartsEmpty) {
+	size_t index = 0;
+	{
+		NodeEventPool dead;
+		dead.sized(16);
+		dead.put(dead.get());
+		index = dead.index();
+	}
+	NodeEventPool reuse;
+	reuse.sized(4096);
+	EXPECT_EQ(index,reuse.index()) << "indices stay dense";
+	void * m = reuse.get();
+	EXPECT_EQ(1,reuse.misses()) << "not the dead pool's smaller block";
+	memset(m,0,4096);
+	reuse.put(m);
+}
+
+namespace {
+
+NodeEventPool * late_pool = NULL;
+bool late_done = false;
+
+void
+late_destructor(void *)
+{
+	// runs after the thread's cache was destroyed (keys are destroyed
+	// in creation order)
+	void * m = late_pool->get();
+	late_pool->put(m);
+	late_done = true;
+}
+
+ThreadLocalDataKey<int> * late_key = NULL;
+
+void *
+late_thread(void *)
+{
+	static int dummy = 0;
+	late_pool->put(late_pool->get()); // this thread has a cache
+	late_key->set(&dummy);
+	return NULL;
+}
+
+} // namespace
+
+TEST_F(OFluxFlowNodePoolTests,UseAfterThreadCacheDestroyed) {
+	pool.put(pool.get()); // the cache key exists before late_key
+	late_pool = &pool;
+	late_key = new ThreadLocalDataKey<int>(late_destructor);
+	pthread_t tid; // joinable (oflux_create_thread detaches)
+	ASSERT_EQ(0,pthread_create(&tid,NULL,late_thread,NULL));
+	void * dontcare;
+	pthread_join(tid,&dontcare);
+	EXPECT_TRUE(late_done) << "pool usable from a later key destructor";
+	delete late_key;
+	late_key = NULL;
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	oflux::lockfree::ThreadNumber::init(); // so the hit counters add up
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,84 @@
+#include "lockfree/OFluxHandOff.h"
+#include "flow/OFluxFlowNodeIncr.h"
+#include "lockfree/OFluxThreadNumber.h"
+#include <gtest/gtest.h>
+
+namespace oflux {
+ class RunTimeAbstractForShim;
+} // namespace oflux
+
+oflux::RunTimeAbstractForShim *eminfo = NULL; // need this symbol due to doors
+
+using namespace oflux::flow;
+using oflux::lockfree::HandOff;
+
+class OFluxHandOffTests : public testing::Test {
+public:
+	OFluxHandOffTests()
+		: n_lane0("lane0","lane0",NULL,NULL,false,false,false,false,"","",0)
+		, n_lane1("lane1","lane1",NULL,NULL,false,false,false,false,"","",1)
+	{}
+	virtual ~OFluxHandOffTests() {}
+	virtual void SetUp() {}
+	virtual void TearDown()
+	{
+		for(size_t i = 0; i < created.size(); ++i) {
+			delete created[i];
+		}
+		created.clear();
+	}
+
+	void create(Node * n, int count)
+	{
+		for(int i = 0; i < count; ++i) {
+			created.push_back(new NodeCounterIncrementer(n));
+		}
+	}
+
+	Node n_lane0;
+	Node n_lane1;
+	std::vector<NodeCounterIncrementer *> created;
+};
+
+TEST_F(OFluxHandOffTests,Depth) {
+	EXPECT_EQ(HandOff::Default_Depth,HandOff(0).depth());
+	EXPECT_EQ(3,HandOff(3).depth());
+	EXPECT_EQ(0,HandOff(-1).depth());
+	EXPECT_FALSE(HandOff(-1).may(&n_lane0,0,0)) << "turned off";
+}
+
+TEST_F(OFluxHandOffTests,QueuedEventsGetTheirTurn) {
+	HandOff h(2);
+	EXPECT_TRUE(h.may(&n_lane0,0,0));
+	h.handed();
+	EXPECT_TRUE(h.may(&n_lane0,0,0));
+	h.handed();
+	EXPECT_EQ(2,h.run());
+	EXPECT_FALSE(h.may(&n_lane0,0,0)) << "two in a row";
+	h.queued();
+	EXPECT_EQ(0,h.run());
+	EXPECT_TRUE(h.may(&n_lane0,0,0));
+}
+
+TEST_F(OFluxHandOffTests,NotPastAHigherLane) {
+	HandOff h(0);
+	EXPECT_FALSE(h.may(&n_lane0,1,0)) << "queued here";
+	EXPECT_FALSE(h.may(&n_lane0,0,1)) << "queued elsewhere";
+	EXPECT_TRUE(h.may(&n_lane1,1,1)) << "same lane";
+	EXPECT_TRUE(h.may(&n_lane1,0,0));
+}
+
+TEST_F(OFluxHandOffTests,ExecutionGapped) {
+	HandOff h(0);
+	create(&n_lane0,HandOff::Critical_Execution_Gap);
+	EXPECT_TRUE(h.may(&n_lane0,0,0)) << "at the gap";
+	create(&n_lane0,1);
+	EXPECT_FALSE(h.may(&n_lane0,0,0)) << "over the gap: queued with the gapped";
+	EXPECT_TRUE(h.may(&n_lane1,0,0)) << "other nodes are not held back";
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	oflux::lockfree::ThreadNumber::init(); // node counters sum per thread
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,91 @@
+#include "lockfree/OFluxLaneCounts.h"
+#include <gtest/gtest.h>
+#include <pthread.h>
+
+namespace oflux {
+ class RunTimeAbstractForShim;
+} // namespace oflux
+
+oflux::RunTimeAbstractForShim *eminfo = NULL; // need this symbol due to doors
+
+using namespace oflux;
+using namespace oflux::lockfree;
+
+class OFluxLaneCountsTests : public testing::Test {
+public:
+	OFluxLaneCountsTests() {}
+	virtual ~OFluxLaneCountsTests() {}
+	virtual void SetUp() { lc.enable(); }
+	virtual void TearDown() {}
+
+	LaneCounts lc;
+};
+
+TEST_F(OFluxLaneCountsTests,NothingQueued) {
+	EXPECT_EQ(0,lc.top());
+}
+
+TEST_F(OFluxLaneCountsTests,DisabledReadsNothing) {
+	LaneCounts off;
+	EXPECT_FALSE(off.enabled());
+	off.queued(LaneCounts::Lanes-1,1);
+	EXPECT_EQ(0,off.top()) << "no flow uses lanes yet";
+	off.enable();
+	EXPECT_EQ(LaneCounts::Lanes-1,off.top());
+}
+
+TEST_F(OFluxLaneCountsTests,LaneZeroIsNotCounted) {
+	lc.queued(0,5);
+	EXPECT_EQ(0,lc.queued(0));
+	EXPECT_EQ(0,lc.top());
+}
+
+TEST_F(OFluxLaneCountsTests,HighestLaneFirst) {
+	ASSERT_GE(LaneCounts::Lanes,3);
+	lc.queued(1,2);
+	EXPECT_EQ(1,lc.top());
+	lc.queued(2,1);
+	EXPECT_EQ(2,lc.top()) << "higher lane wins";
+	lc.queued(2,-1);
+	EXPECT_EQ(1,lc.top()) << "back to the lower lane once drained";
+	lc.queued(1,-2);
+	EXPECT_EQ(0,lc.top());
+}
+
+namespace {
+
+enum { Adders = 4, Adds = 100000 };
+
+void *
+add_and_take(void * v)
+{
+	LaneCounts * lc = reinterpret_cast<LaneCounts *>(v);
+	for(int i = 0; i < Adds; ++i) {
+		lc->queued(1 + i % (LaneCounts::Lanes-1),1);
+	}
+	for(int i = 0; i < Adds; ++i) {
+		lc->queued(1 + i % (LaneCounts::Lanes-1),-1);
+	}
+	return NULL;
+}
+
+} // namespace
+
+TEST_F(OFluxLaneCountsTests,ConcurrentCountsBalance) {
+	pthread_t th[Adders];
+	for(int i = 0; i < Adders; ++i) {
+		ASSERT_EQ(0,pthread_create(&th[i],NULL,add_and_take,&lc));
+	}
+	for(int i = 0; i < Adders; ++i) {
+		pthread_join(th[i],NULL);
+	}
+	for(int lane = 0; lane < LaneCounts::Lanes; ++lane) {
+		EXPECT_EQ(0,lc.queued(lane)) << "lane " << lane;
+	}
+	EXPECT_EQ(0,lc.top());
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,135 @@
+#include "OFluxLatency.h"
+#include "flow/OFluxFlowNode.h"
+#include <gtest/gtest.h>
+
+namespace oflux {
+ class RunTimeAbstractForShim;
+} // namespace oflux
+
+oflux::RunTimeAbstractForShim *eminfo = NULL; // need this symbol due to doors
+
+using namespace oflux;
+
+class OFluxLatencyTests : public testing::Test {
+public:
+	OFluxLatencyTests() {}
+	virtual ~OFluxLatencyTests() {}
+	virtual void SetUp() {}
+	virtual void TearDown() {}
+
+	// v lies in the bucket index() gives it
+	void in_bucket(unsigned long long v)
+	{
+		int i = Histogram::index(v);
+		ASSERT_GE(i,0);
+		ASSERT_LT(i,(int)Histogram::Buckets);
+		EXPECT_LE(Histogram::lower(i),v) << "v " << v;
+		EXPECT_GE(Histogram::upper(i),v) << "v " << v;
+	}
+};
+
+TEST_F(OFluxLatencyTests,ExactBelowSub) {
+	for(int v = 0; v < Histogram::Sub; ++v) {
+		EXPECT_EQ(v,Histogram::index(v));
+		EXPECT_EQ((unsigned long long)v,Histogram::lower(v));
+		EXPECT_EQ((unsigned long long)v,Histogram::upper(v));
+	}
+}
+
+TEST_F(OFluxLatencyTests,BucketsTileTheRange) {
+	for(int i = 0; i + 1 < Histogram::Buckets; ++i) {
+		EXPECT_EQ(Histogram::upper(i) + 1,Histogram::lower(i+1))
+			<< "bucket " << i;
+		EXPECT_EQ(i,Histogram::index(Histogram::lower(i)));
+		EXPECT_EQ(i,Histogram::index(Histogram::upper(i)));
+	}
+	EXPECT_EQ(~0ULL,Histogram::upper(Histogram::Buckets-1));
+}
+
+TEST_F(OFluxLatencyTests,IndexBounds) {
+	for(unsigned long long v = 1; v < (1ULL << 20); v = v * 3 + 1) {
+		in_bucket(v);
+		in_bucket(v - 1);
+	}
+	in_bucket(1ULL << Histogram::Max_Exp);
+	in_bucket((1ULL << (Histogram::Max_Exp+1)) - 1);
+	EXPECT_EQ(Histogram::Buckets-1,Histogram::index(~0ULL))
+		<< "larger values land in the last bucket";
+}
+
+TEST_F(OFluxLatencyTests,BucketWidth) {
+	for(int i = Histogram::Sub; i + 1 < Histogram::Buckets; ++i) {
+		unsigned long long lo = Histogram::lower(i);
+		unsigned long long width = Histogram::upper(i) - lo + 1;
+		EXPECT_LE(width * Histogram::Sub,lo) << "within 1/Sub";
+	}
+}
+
+TEST_F(OFluxLatencyTests,Percentile) {
+	Histogram h;
+	EXPECT_EQ(0ULL,h.percentile(0.5)) << "empty";
+	for(unsigned long long v = 1; v <= 100; ++v) {
+		h.add(v * 1000);
+	}
+	EXPECT_EQ(100ULL,h.count());
+	EXPECT_EQ(100000ULL,h.max());
+	EXPECT_DOUBLE_EQ(50500.0,h.mean());
+	unsigned long long p50 = h.percentile(0.5);
+	EXPECT_GE(p50,50000ULL);
+	EXPECT_LE(p50,50000ULL + 50000ULL / Histogram::Sub);
+	EXPECT_EQ(100000ULL,h.percentile(1.0)) << "capped at the max";
+	EXPECT_EQ(h.percentile(0.0),h.percentile(0.01)) << "the smallest";
+	EXPECT_EQ(Histogram::upper(Histogram::index(1000)),h.percentile(0.0));
+}
+
+TEST_F(OFluxLatencyTests,Merge) {
+	Histogram a;
+	Histogram b;
+	a.add(10);
+	b.add(20);
+	b.add(5000);
+	a.merge(b);
+	EXPECT_EQ(3ULL,a.count());
+	EXPECT_EQ(5000ULL,a.max());
+	EXPECT_EQ(5030ULL,a.sum());
+	EXPECT_EQ(5000ULL,a.percentile(0.99));
+}
+
+TEST_F(OFluxLatencyTests,RecordAndSnapshot) {
+	int id = 7;
+	latency::record(id,latency::M_exec,100);
+	latency::record(id,latency::M_exec,300);
+	latency::record(id,latency::M_queue_wait,5);
+	latency::NodeLatency nl;
+	latency::snapshot(id,nl);
+	EXPECT_EQ(2ULL,nl.h[latency::M_exec].count());
+	EXPECT_EQ(400ULL,nl.h[latency::M_exec].sum());
+	EXPECT_EQ(1ULL,nl.h[latency::M_queue_wait].count());
+	EXPECT_EQ(0ULL,nl.h[latency::M_guard_wait].count());
+	latency::record(latency::Max_Nodes,latency::M_exec,1); // dropped
+	latency::snapshot(latency::Max_Nodes,nl);
+	EXPECT_EQ(0ULL,nl.h[latency::M_exec].count());
+}
+
+TEST_F(OFluxLatencyTests,CycleClock) {
+	EXPECT_GT(CycleClock::ns_per_tick(),0.0);
+	if(!CycleClock::tsc()) {
+		EXPECT_EQ(1.0,CycleClock::ns_per_tick()) << "ticks are ns";
+	}
+	unsigned long long a = CycleClock::now();
+	unsigned long long b = CycleClock::now();
+	EXPECT_LE(a,b);
+}
+
+TEST_F(OFluxLatencyTests,NodeIdKeptByName) {
+	flow::Node a("lat_a","f",NULL,NULL,false,false,false,false,"","");
+	flow::Node b("lat_b","f",NULL,NULL,false,false,false,false,"","");
+	EXPECT_NE(a.id(),b.id());
+	flow::Node reloaded("lat_a","f",NULL,NULL,false,false,false,false,"","");
+	EXPECT_EQ(a.id(),reloaded.id()) << "a reloaded node keeps its histograms";
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,188 @@
+#include "OFluxMetrics.h"
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace oflux {
+ class RunTimeAbstractForShim;
+} // namespace oflux
+
+oflux::RunTimeAbstractForShim *eminfo = NULL; // need this symbol due to doors
+
+using namespace oflux::metrics;
+
+class OFluxMetricsTests : public testing::Test {
+public:
+	OFluxMetricsTests() {}
+	virtual ~OFluxMetricsTests() {}
+	virtual void SetUp() {}
+	virtual void TearDown()
+	{
+		socket_path(NULL);
+		if(!path.empty()) {
+			unlink(path.c_str());
+			rmdir(dir.c_str());
+		}
+	}
+
+	std::string prometheus(const Snapshot & s)
+	{
+		std::string out;
+		s.prometheus(out);
+		return out;
+	}
+	std::string json(const Snapshot & s)
+	{
+		std::string out;
+		s.json(out);
+		// drop the timestamp (it is the wall clock)
+		size_t from = out.find(":") + 1;
+		size_t to = out.find(",",from);
+		return out.substr(0,from) + "0" + out.substr(to);
+	}
+	void temp_path()
+	{
+		char tmpl[] = "/tmp/oflux_metrics_XXXXXX";
+		ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+		dir = tmpl;
+		path = dir + "/sock";
+		socket_path(path.c_str());
+	}
+	// a socket file nobody listens on (as a crashed run leaves it)
+	void stale_socket()
+	{
+		struct sockaddr_un addr;
+		memset(&addr,0,sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strcpy(addr.sun_path,path.c_str());
+		int fd = socket(AF_UNIX,SOCK_STREAM,0);
+		ASSERT_GE(fd,0);
+		ASSERT_EQ(0,bind(fd,(struct sockaddr *)&addr,sizeof(addr)));
+		close(fd);
+	}
+
+	std::string dir;
+	std::string path;
+};
+
+TEST_F(OFluxMetricsTests,Empty) {
+	Snapshot s;
+	EXPECT_EQ(0,s.size());
+	EXPECT_EQ("",prometheus(s));
+	EXPECT_EQ("{\"timestamp_ms\":0,\"metrics\":[\n]}\n",json(s));
+}
+
+TEST_F(OFluxMetricsTests,Prometheus) {
+	Snapshot s;
+	s.gauge("oflux_depth","queue depth").add(Labels(),3);
+	s.counter("oflux_runs_total","runs")
+		.add(Labels().add("node","A").add("thread",1LL),10);
+	s.counter("oflux_runs_total","runs")
+		.add(Labels().add("node","B").add("thread",2LL),2.5);
+	EXPECT_EQ(2,s.size()) << "the same family";
+	EXPECT_EQ(
+		"# HELP oflux_depth queue depth\n"
+		"# TYPE oflux_depth gauge\n"
+		"oflux_depth 3\n"
+		"# HELP oflux_runs_total runs\n"
+		"# TYPE oflux_runs_total counter\n"
+		"oflux_runs_total{node=\"A\",thread=\"1\"} 10\n"
+		"oflux_runs_total{node=\"B\",thread=\"2\"} 2.5\n"
+		, prometheus(s));
+}
+
+TEST_F(OFluxMetricsTests,Summary) {
+	Snapshot s;
+	Family & f = s.family("oflux_exec_seconds",T_summary,"run time");
+	Labels l;
+	l.add("node","A");
+	Labels q(l);
+	q.add("quantile","0.99");
+	f.add(q,0.25);
+	f.add(l,7,"_count");
+	EXPECT_EQ(
+		"# HELP oflux_exec_seconds run time\n"
+		"# TYPE oflux_exec_seconds summary\n"
+		"oflux_exec_seconds{node=\"A\",quantile=\"0.99\"} 0.25\n"
+		"oflux_exec_seconds_count{node=\"A\"} 7\n"
+		, prometheus(s));
+	EXPECT_EQ(
+		"{\"timestamp_ms\":0,\"metrics\":[\n"
+		"{\"name\":\"oflux_exec_seconds\",\"type\":\"summary\""
+		",\"help\":\"run time\",\"samples\":["
+		"{\"labels\":{\"node\":\"A\",\"quantile\":\"0.99\"},\"value\":0.25}"
+		",{\"suffix\":\"_count\",\"labels\":{\"node\":\"A\"},\"value\":7}]}"
+		"\n]}\n"
+		, json(s));
+}
+
+TEST_F(OFluxMetricsTests,Json) {
+	Snapshot s;
+	s.gauge("a","first").add(Labels(),1);
+	s.gauge("b","second").add(Labels().add("k","v"),-2);
+	EXPECT_EQ(
+		"{\"timestamp_ms\":0,\"metrics\":[\n"
+		"{\"name\":\"a\",\"type\":\"gauge\",\"help\":\"first\""
+		",\"samples\":[{\"labels\":{},\"value\":1}]},\n"
+		"{\"name\":\"b\",\"type\":\"gauge\",\"help\":\"second\""
+		",\"samples\":[{\"labels\":{\"k\":\"v\"},\"value\":-2}]}"
+		"\n]}\n"
+		, json(s));
+}
+
+TEST_F(OFluxMetricsTests,Escaping) {
+	Snapshot s;
+	s.gauge("g","help").add(Labels().add("guard","a\"b\\c\nd\te"),1);
+	EXPECT_EQ(
+		"# HELP g help\n"
+		"# TYPE g gauge\n"
+		"g{guard=\"a\\\"b\\\\c\\nd e\"} 1\n"
+		, prometheus(s)) << "quote, backslash, newline; control chars blanked";
+	EXPECT_NE(std::string::npos
+		, json(s).find("{\"guard\":\"a\\\"b\\\\c\\nd e\"}"));
+}
+
+TEST_F(OFluxMetricsTests,NoPathNoServer) {
+	Server server;
+	EXPECT_FALSE(server.start(NULL,256*1024));
+}
+
+TEST_F(OFluxMetricsTests,NotASocketIsLeftAlone) {
+	temp_path();
+	FILE * f = fopen(path.c_str(),"w");
+	ASSERT_TRUE(f != NULL);
+	fclose(f);
+	Server server;
+	EXPECT_FALSE(server.start(NULL,256*1024));
+	struct stat st;
+	ASSERT_EQ(0,lstat(path.c_str(),&st));
+	EXPECT_TRUE(S_ISREG(st.st_mode)) << "not unlinked";
+}
+
+TEST_F(OFluxMetricsTests,StaleSocketReplaced) {
+	temp_path();
+	stale_socket();
+	{
+		Server server;
+		ASSERT_TRUE(server.start(NULL,256*1024));
+		struct stat st;
+		ASSERT_EQ(0,lstat(path.c_str(),&st));
+		EXPECT_TRUE(S_ISSOCK(st.st_mode));
+		EXPECT_EQ((int)Server::Socket_Mode,(int)(st.st_mode & 0777));
+		Server second;
+		EXPECT_FALSE(second.start(NULL,256*1024)) << "in use";
+		server.stop();
+	}
+	struct stat st;
+	EXPECT_NE(0,lstat(path.c_str(),&st)) << "removed by stop()";
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,200 @@
+#include "CommonEventunit.h"
+#include "OFluxQueue.h"
+#include <algorithm>
+#include <pthread.h>
+#include <set>
+
+using namespace oflux;
+
+class OFluxMultiQueueTests : public OFluxCommonEventTests {
+public:
+	enum { Shards = 4 };
+
+	OFluxMultiQueueTests()
+		: mq(Shards)
+		, seed(2463534242U)
+		, n_lane0("lane0","c_source",c_source,NULL,false,true,false,false,"","",0)
+		, n_lane1("lane1","c_source",c_source,NULL,false,true,false,false,"","",1)
+		, n_lane2("lane2","c_source",c_source,NULL,false,true,false,false,"","",2)
+	{}
+	virtual ~OFluxMultiQueueTests() {}
+	virtual void SetUp() {}
+	virtual void TearDown()
+	{
+		mq.clear();
+		events.clear();
+	}
+
+	EventBase * make(flow::Node * n)
+	{
+		CreateNodeFn createfn = n->getCreateFn();
+		events.push_back(EventBaseSharedPtr(
+			(*createfn)(EventBase::no_event_shared,NULL,n)));
+		return events.back().get();
+	}
+	void push(int home, EventBase * ev)
+	{
+		std::vector<MultiQueue::Element> vec;
+		vec.push_back(mk_EventBasePtr(ev));
+		mq.push_list(home,vec);
+	}
+	EventBase * pop(int home)
+	{
+		MultiQueue::Element e;
+		return mq.pop(home,seed,e) ? get_EventBasePtr(e) : NULL;
+	}
+
+	MultiQueue mq;
+	unsigned int seed;
+	flow::Node n_lane0;
+	flow::Node n_lane1;
+	flow::Node n_lane2;
+	std::vector<EventBaseSharedPtr> events;
+};
+
+TEST_F(OFluxMultiQueueTests,EmptyQueue) {
+	EXPECT_TRUE(mq.empty());
+	EXPECT_EQ(0,mq.size());
+	EXPECT_TRUE(pop(0) == NULL);
+	EXPECT_EQ(Shards,mq.shards());
+}
+
+TEST_F(OFluxMultiQueueTests,HomeShardIsFifo) {
+	EventBase * e[3];
+	for(int i = 0; i < 3; ++i) {
+		e[i] = make(&n_lane0);
+		push(1,e[i]);
+	}
+	EXPECT_EQ(3,mq.size());
+	EXPECT_FALSE(mq.empty());
+	for(int i = 0; i < 3; ++i) {
+		EXPECT_EQ(e[i],pop(1));
+	}
+	EXPECT_TRUE(mq.empty());
+}
+
+TEST_F(OFluxMultiQueueTests,PopsFromOtherShards) {
+	EventBase * e0 = make(&n_lane0);
+	EventBase * e1 = make(&n_lane0);
+	push(2,e0);
+	push(3,e1);
+	std::set<EventBase *> got;
+	got.insert(pop(0));
+	got.insert(pop(0));
+	EXPECT_EQ(1,got.count(e0));
+	EXPECT_EQ(1,got.count(e1));
+	EXPECT_TRUE(pop(0) == NULL) << "every shard seen empty";
+}
+
+TEST_F(OFluxMultiQueueTests,ShardsWrapAround) {
+	EventBase * e = make(&n_lane0);
+	push(Shards + 1,e); // lands on shard 1
+	EXPECT_EQ(e,pop(1));
+}
+
+TEST_F(OFluxMultiQueueTests,HigherLaneFirstAcrossShards) {
+	EventBase * low0 = make(&n_lane0);
+	EventBase * low1 = make(&n_lane0);
+	EventBase * mid = make(&n_lane1);
+	EventBase * high = make(&n_lane2);
+	push(0,low0);
+	push(0,low1);
+	push(2,mid);
+	push(3,high);
+	EXPECT_EQ(2,mq.lane_size(0));
+	EXPECT_EQ(1,mq.lane_size(1));
+	EXPECT_EQ(1,mq.lane_size(2));
+	EXPECT_EQ(high,pop(0)) << "lane 2 on another shard comes first";
+	EXPECT_EQ(mid,pop(0));
+	EXPECT_EQ(low0,pop(0));
+	EXPECT_EQ(low1,pop(0));
+	for(int lane = 0; lane < QueueLanes::Lanes; ++lane) {
+		EXPECT_EQ(0,mq.lane_size(lane));
+	}
+}
+
+TEST_F(OFluxMultiQueueTests,Clear) {
+	push(0,make(&n_lane0));
+	push(1,make(&n_lane2));
+	mq.clear();
+	EXPECT_TRUE(mq.empty());
+	EXPECT_EQ(0,mq.lane_size(2));
+	EXPECT_TRUE(pop(0) == NULL);
+}
+
+namespace {
+
+enum { Stress_Per_Thread = 5000 };
+
+struct StressThread {
+	MultiQueue * mq;
+	int home;
+	std::vector<MultiQueue::Element> mine;
+	std::vector<EventBase *> popped;
+	volatile int * left;
+};
+
+void *
+stress(void * v)
+{
+	StressThread * st = reinterpret_cast<StressThread *>(v);
+	unsigned int seed = 2463534242U + 97U * st->home;
+	for(size_t i = 0; i < st->mine.size(); i += 10) {
+		std::vector<MultiQueue::Element> batch(st->mine.begin() + i
+			, st->mine.begin() + std::min(i + 10, st->mine.size()));
+		st->mq->push_list(st->home,batch);
+		MultiQueue::Element e;
+		if(st->mq->pop(st->home,seed,e)) {
+			st->popped.push_back(get_EventBasePtr(e));
+			__sync_fetch_and_sub(st->left,1);
+		}
+	}
+	while(*(st->left) > 0) {
+		MultiQueue::Element e;
+		if(st->mq->pop(st->home,seed,e)) {
+			st->popped.push_back(get_EventBasePtr(e));
+			__sync_fetch_and_sub(st->left,1);
+		}
+	}
+	return NULL;
+}
+
+} // namespace
+
+TEST_F(OFluxMultiQueueTests,EachEventPoppedOnce) {
+	StressThread st[Shards];
+	volatile int left = Shards * Stress_Per_Thread;
+	flow::Node * nodes[] = { &n_lane0, &n_lane1, &n_lane2 };
+	for(int t = 0; t < Shards; ++t) {
+		st[t].mq = &mq;
+		st[t].home = t;
+		st[t].left = &left;
+		for(int i = 0; i < Stress_Per_Thread; ++i) {
+			st[t].mine.push_back(mk_EventBasePtr(make(nodes[i % 3])));
+		}
+	}
+	pthread_t th[Shards];
+	for(int t = 0; t < Shards; ++t) {
+		ASSERT_EQ(0,pthread_create(&th[t],NULL,stress,&st[t]));
+	}
+	for(int t = 0; t < Shards; ++t) {
+		pthread_join(th[t],NULL);
+	}
+	std::set<EventBase *> seen;
+	size_t total = 0;
+	for(int t = 0; t < Shards; ++t) {
+		total += st[t].popped.size();
+		seen.insert(st[t].popped.begin(),st[t].popped.end());
+	}
+	EXPECT_EQ((size_t)(Shards * Stress_Per_Thread),total);
+	EXPECT_EQ(total,seen.size()) << "no event popped twice";
+	EXPECT_TRUE(mq.empty());
+	for(int lane = 0; lane < QueueLanes::Lanes; ++lane) {
+		EXPECT_EQ(0,mq.lane_size(lane));
+	}
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
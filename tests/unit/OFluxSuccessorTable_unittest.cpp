@@ -0,0 +1,148 @@
+#include "flow/OFluxFlowCase.h"
+#include <gtest/gtest.h>
+
+namespace oflux {
+ class RunTimeAbstractForShim;
+} // namespace oflux
+
+oflux::RunTimeAbstractForShim *eminfo = NULL; // need this symbol due to doors
+
+using namespace oflux;
+using namespace oflux::flow;
+
+namespace {
+
+struct Out {
+	int x;
+};
+
+bool is_even(const void * v) { return (static_cast<const Out *>(v)->x % 2) == 0; }
+bool is_small(const void * v) { return static_cast<const Out *>(v)->x < 10; }
+
+// targets are only compared, never dereferenced
+char node_storage[4];
+Node * const n0 = reinterpret_cast<Node *>(&node_storage[0]);
+Node * const n1 = reinterpret_cast<Node *>(&node_storage[1]);
+Node * const n2 = reinterpret_cast<Node *>(&node_storage[2]);
+Node * const n3 = reinterpret_cast<Node *>(&node_storage[3]);
+
+} // namespace
+
+class OFluxSuccessorTableTests : public testing::Test {
+public:
+	OFluxSuccessorTableTests() {}
+	virtual ~OFluxSuccessorTableTests() {}
+	virtual void SetUp() {}
+	virtual void TearDown()
+	{
+		for(size_t i = 0; i < cases.size(); ++i) {
+			delete cases[i];
+		}
+		cases.clear();
+	}
+
+	Case * make_case(Node * target, ConditionFn c1 = NULL, bool neg1 = false
+		, ConditionFn c2 = NULL, bool neg2 = false)
+	{
+		Case * fc = new Case("",target);
+		if(c1) fc->add(new Condition(c1,neg1));
+		if(c2) fc->add(new Condition(c2,neg2));
+		cases.push_back(fc);
+		return fc;
+	}
+	std::vector<Node *> resolve(int x)
+	{
+		Out o;
+		o.x = x;
+		std::vector<const SuccessorRecord *> recs;
+		table.get_successors(recs,&o);
+		std::vector<Node *> res;
+		for(size_t i = 0; i < recs.size(); ++i) {
+			res.push_back(recs[i]->targetNode());
+		}
+		return res;
+	}
+
+	SuccessorTable table;
+	std::vector<Case *> cases;
+};
+
+TEST_F(OFluxSuccessorTableTests,EmptyTable) {
+	EXPECT_EQ(0,table.size());
+	EXPECT_TRUE(resolve(1).empty());
+}
+
+TEST_F(OFluxSuccessorTableTests,FirstSatisfiedCaseWins) {
+	// successor: [even && small -> n0] [!even -> n1] [default -> n2]
+	table.begin_successor();
+	table.add_case(make_case(n0,is_even,false,is_small,false));
+	table.add_case(make_case(n1,is_even,true));
+	table.add_case(make_case(n2));
+	table.end_successor();
+	EXPECT_EQ(4,table.size());
+	std::vector<Node *> r;
+	r = resolve(2);
+	ASSERT_EQ(1,r.size());
+	EXPECT_EQ(n0,r[0]);
+	r = resolve(3);
+	ASSERT_EQ(1,r.size());
+	EXPECT_EQ(n1,r[0]);
+	r = resolve(12); // even but not small: second condition fails
+	ASSERT_EQ(1,r.size());
+	EXPECT_EQ(n2,r[0]);
+}
+
+TEST_F(OFluxSuccessorTableTests,NoCaseSatisfied) {
+	table.begin_successor();
+	table.add_case(make_case(n0,is_even));
+	table.end_successor();
+	EXPECT_TRUE(resolve(1).empty());
+	ASSERT_EQ(1,resolve(4).size());
+}
+
+TEST_F(OFluxSuccessorTableTests,CasesAfterDefaultAreDropped) {
+	table.begin_successor();
+	table.add_case(make_case(n0));
+	table.add_case(make_case(n1,is_even));
+	table.end_successor();
+	EXPECT_EQ(1,table.size());
+	std::vector<Node *> targets;
+	table.targets(targets);
+	ASSERT_EQ(1,targets.size());
+	EXPECT_EQ(n0,targets[0]);
+}
+
+TEST_F(OFluxSuccessorTableTests,EachSuccessorContributes) {
+	// two concurrent successors, resolved in order
+	table.begin_successor();
+	table.add_case(make_case(n0,is_small));
+	table.add_case(make_case(n1));
+	table.end_successor();
+	table.begin_successor();
+	table.add_case(make_case(n2,is_even));
+	table.add_case(make_case(n3,is_small,true));
+	table.end_successor();
+	std::vector<Node *> r;
+	r = resolve(4);
+	ASSERT_EQ(2,r.size());
+	EXPECT_EQ(n0,r[0]);
+	EXPECT_EQ(n2,r[1]);
+	r = resolve(11);
+	ASSERT_EQ(2,r.size());
+	EXPECT_EQ(n1,r[0]);
+	EXPECT_EQ(n3,r[1]);
+	r = resolve(5);
+	ASSERT_EQ(1,r.size());
+	EXPECT_EQ(n0,r[0]);
+	std::vector<Node *> targets;
+	table.targets(targets);
+	EXPECT_EQ(4,targets.size());
+	table.clear();
+	EXPECT_EQ(0,table.size());
+	EXPECT_TRUE(resolve(4).empty());
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
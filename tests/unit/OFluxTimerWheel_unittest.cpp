@@ -0,0 +1,137 @@
+#include "OFluxTimerWheel.h"
+#include <gtest/gtest.h>
+
+namespace oflux {
+ class RunTimeAbstractForShim;
+} // namespace oflux
+
+oflux::RunTimeAbstractForShim *eminfo = NULL; // need this symbol due to doors
+
+using namespace oflux;
+
+class OFluxTimerWheelTests : public testing::Test {
+public:
+	OFluxTimerWheelTests()
+		: base(TimerWheel::now_ns())
+		, t(w.tick_ns())
+	{}
+	virtual ~OFluxTimerWheelTests() {}
+	virtual void SetUp() {}
+	virtual void TearDown() {}
+
+	size_t advance(long long now)
+	{
+		fired.clear();
+		w.advance(now,fired);
+		return fired.size();
+	}
+	// arm e at d: nothing fires just before d, e fires at d
+	void fires_at(TimerWheel::Entry * e, long long d)
+	{
+		w.arm(e,d);
+		EXPECT_EQ(0,advance(d-1)) << "early";
+		EXPECT_TRUE(e->armed());
+		ASSERT_EQ(1,advance(d));
+		EXPECT_EQ(e,fired[0]);
+		EXPECT_FALSE(e->armed());
+		EXPECT_EQ(0,w.armed());
+	}
+
+	TimerWheel w;
+	long long base;
+	long long t;
+	std::vector<TimerWheel::Entry *> fired;
+};
+
+enum { Span_Ticks = 1 << (TimerWheel::Slot_Bits * TimerWheel::Levels) };
+
+TEST_F(OFluxTimerWheelTests,Empty) {
+	EXPECT_EQ(0,w.armed());
+	EXPECT_EQ(0,w.next_deadline());
+	EXPECT_EQ(0,advance(base + 1000*t));
+}
+
+TEST_F(OFluxTimerWheelTests,LevelZero) {
+	TimerWheel::Entry e;
+	fires_at(&e,base + 10*t);
+}
+
+TEST_F(OFluxTimerWheelTests,AlreadyDue) {
+	TimerWheel::Entry e;
+	w.arm(&e,base - 5*t);
+	EXPECT_EQ(1,advance(TimerWheel::now_ns())) << "on the next advance";
+}
+
+TEST_F(OFluxTimerWheelTests,CascadeFromEachLevel) {
+	TimerWheel::Entry e1;
+	TimerWheel::Entry e2;
+	TimerWheel::Entry e3;
+	fires_at(&e1,base + 100*t);
+	fires_at(&e2,base + 5000*t);
+	fires_at(&e3,base + 300000*t);
+}
+
+TEST_F(OFluxTimerWheelTests,InOrder) {
+	TimerWheel::Entry e[3];
+	w.arm(&e[2],base + 5000*t);
+	w.arm(&e[0],base + 70*t);
+	w.arm(&e[1],base + 70*t + 1);
+	EXPECT_EQ(3,w.armed());
+	ASSERT_EQ(1,advance(base + 70*t));
+	EXPECT_EQ(&e[0],fired[0]) << "not the one later in the same tick";
+	ASSERT_EQ(1,advance(base + 4000*t));
+	EXPECT_EQ(&e[1],fired[0]);
+	ASSERT_EQ(1,advance(base + 5000*t));
+	EXPECT_EQ(&e[2],fired[0]);
+}
+
+TEST_F(OFluxTimerWheelTests,BeyondTheHorizon) {
+	TimerWheel::Entry e;
+	fires_at(&e,base + (Span_Ticks + 1000LL)*t);
+}
+
+TEST_F(OFluxTimerWheelTests,NextDeadline) {
+	TimerWheel::Entry near;
+	TimerWheel::Entry far;
+	w.arm(&far,base + 5000*t);
+	long long cascade = w.next_deadline();
+	EXPECT_GT(cascade,base);
+	EXPECT_LE(cascade,base + 5000*t) << "no later than the next cascade";
+	w.arm(&near,base + 3*t);
+	EXPECT_EQ(base + 3*t,w.next_deadline()) << "exact within a lap";
+	w.cancel(&near);
+	EXPECT_EQ(cascade,w.next_deadline());
+}
+
+TEST_F(OFluxTimerWheelTests,CancelAndRearm) {
+	TimerWheel::Entry e;
+	w.arm(&e,base + 200*t);
+	w.cancel(&e);
+	EXPECT_FALSE(e.armed());
+	EXPECT_EQ(0,w.armed());
+	w.cancel(&e);
+	EXPECT_EQ(0,w.armed()) << "cancel twice";
+	w.arm(&e,base + 200*t);
+	w.arm(&e,base + 20*t);
+	EXPECT_EQ(1,w.armed()) << "re-armed, not added";
+	EXPECT_EQ(1,advance(base + 20*t));
+	EXPECT_EQ(0,advance(base + 300*t));
+}
+
+TEST_F(OFluxTimerWheelTests,Clear) {
+	TimerWheel::Entry e[3];
+	w.arm(&e[0],base + 2*t);
+	w.arm(&e[1],base + 2000*t);
+	w.arm(&e[2],base + (Span_Ticks * 2LL)*t);
+	w.clear(fired);
+	EXPECT_EQ(3,fired.size());
+	EXPECT_EQ(0,w.armed());
+	for(int i = 0; i < 3; ++i) {
+		EXPECT_FALSE(e[i].armed());
+	}
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,161 @@
+#include "lockfree/OFluxLockfreeVictims.h"
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+namespace oflux {
+ class RunTimeAbstractForShim;
+} // namespace oflux
+
+oflux::RunTimeAbstractForShim *eminfo = NULL; // need this symbol due to doors
+
+using namespace oflux::lockfree;
+
+// builds a fake /sys/devices/system/cpu tree in a temporary directory
+class OFluxTopologyTests : public testing::Test {
+public:
+	OFluxTopologyTests() {}
+	virtual ~OFluxTopologyTests() {}
+	virtual void SetUp()
+	{
+		char tmpl[] = "/tmp/oflux_topology_XXXXXX";
+		ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+		root = tmpl;
+		made.push_back(root);
+	}
+	virtual void TearDown()
+	{
+		for(size_t i = made.size(); i > 0; --i) {
+			remove(made[i-1].c_str());
+		}
+		made.clear();
+	}
+
+	void dir(const std::string & rel)
+	{
+		std::string p = root;
+		size_t pos = 0;
+		while(pos != std::string::npos) {
+			pos = rel.find('/',pos+1);
+			p = root + "/" + rel.substr(0,pos);
+			if(mkdir(p.c_str(),0700) == 0) {
+				made.push_back(p);
+			}
+		}
+	}
+	void file(const std::string & rel, const char * content)
+	{
+		dir(rel.substr(0,rel.rfind('/')));
+		std::string p = root + "/" + rel;
+		FILE * f = fopen(p.c_str(),"w");
+		ASSERT_TRUE(f != NULL);
+		fputs(content,f);
+		fclose(f);
+		made.push_back(p);
+	}
+	std::string cpu(int c)
+	{
+		char buf[32];
+		snprintf(buf,sizeof(buf),"cpu%d",c);
+		return buf;
+	}
+	// an L1 of its own and an L3 shared with llc_list
+	void caches(int c, const char * llc_list)
+	{
+		char own[16];
+		snprintf(own,sizeof(own),"%d\n",c);
+		file(cpu(c) + "/cache/index0/level","1\n");
+		file(cpu(c) + "/cache/index0/shared_cpu_list",own);
+		file(cpu(c) + "/cache/index1/level","3\n");
+		file(cpu(c) + "/cache/index1/shared_cpu_list",llc_list);
+	}
+	void node(int c, int n)
+	{
+		char buf[32];
+		snprintf(buf,sizeof(buf),"/node%d",n);
+		dir(cpu(c) + buf);
+	}
+	void package(int c, const char * id)
+	{
+		file(cpu(c) + "/topology/physical_package_id",id);
+	}
+
+	std::string root;
+	std::vector<std::string> made; // removed in reverse
+};
+
+TEST_F(OFluxTopologyTests,Flat) {
+	package(0,"0\n");
+	package(1,"0\n");
+	Topology t(root.c_str(),2);
+	EXPECT_EQ(2,t.cpus());
+	EXPECT_EQ(1,t.levels());
+	EXPECT_EQ(0,t.distance(0,1));
+}
+
+TEST_F(OFluxTopologyTests,NoSysTree) {
+	Topology t((root + "/missing").c_str(),4);
+	EXPECT_EQ(4,t.cpus());
+	EXPECT_EQ(1,t.levels());
+	EXPECT_EQ(0,t.distance(0,3));
+}
+
+TEST_F(OFluxTopologyTests,TwoCacheGroupsOneNode) {
+	caches(0,"0-1\n");
+	caches(1,"0-1\n");
+	caches(2,"2-3\n");
+	caches(3,"2-3\n");
+	for(int c = 0; c < 4; ++c) {
+		node(c,0);
+	}
+	Topology t(root.c_str(),4);
+	EXPECT_EQ(2,t.levels());
+	EXPECT_EQ(Topology::D_Cache,t.distance(0,1));
+	EXPECT_EQ(Topology::D_Cache,t.distance(3,2));
+	EXPECT_EQ(Topology::D_Node,t.distance(1,2));
+}
+
+TEST_F(OFluxTopologyTests,TwoNodes) {
+	caches(0,"0,1\n");
+	caches(1,"0,1\n");
+	caches(2,"2,3\n");
+	caches(3,"2,3\n");
+	node(0,0);
+	node(1,0);
+	node(2,1);
+	node(3,1);
+	Topology t(root.c_str(),4);
+	EXPECT_EQ(Topology::D_Count,t.levels());
+	EXPECT_EQ(Topology::D_Cache,t.distance(0,1));
+	EXPECT_EQ(Topology::D_Remote,t.distance(0,2));
+	EXPECT_EQ(Topology::D_Remote,t.distance(3,1));
+}
+
+TEST_F(OFluxTopologyTests,PackagesWithoutNuma) {
+	caches(0,"0\n");
+	caches(1,"1\n");
+	package(0,"0\n");
+	package(1,"1\n");
+	Topology t(root.c_str(),2);
+	EXPECT_EQ(Topology::D_Count,t.levels());
+	EXPECT_EQ(Topology::D_Remote,t.distance(0,1));
+}
+
+TEST_F(OFluxTopologyTests,UnknownCpuIsFarthest) {
+	caches(0,"0-1\n");
+	caches(1,"0-1\n");
+	caches(2,"2\n");
+	Topology t(root.c_str(),3);
+	EXPECT_EQ(2,t.levels());
+	EXPECT_EQ(1,t.distance(-1,0));
+	EXPECT_EQ(1,t.distance(0,3));
+	EXPECT_EQ(Topology::D_Cache,t.distance(1,0));
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
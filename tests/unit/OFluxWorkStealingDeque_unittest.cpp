@@ -0,0 +1,229 @@
+#include "lockfree/OFluxWorkStealingDeque.h"
+#include "lockfree/OFluxThreadNumber.h"
+#include <gtest/gtest.h>
+#include <pthread.h>
+
+namespace oflux {
+ class RunTimeAbstractForShim;
+} // namespace oflux
+
+oflux::RunTimeAbstractForShim *eminfo = NULL; // need this symbol due to doors
+
+using namespace oflux;
+
+typedef lockfree::CircularWorkStealingDeque<int> Deque;
+
+class OFluxWorkStealingDequeTests : public testing::Test {
+public:
+	enum { Num_Items = 4096 };
+
+	OFluxWorkStealingDequeTests() {}
+	virtual ~OFluxWorkStealingDequeTests() {}
+	virtual void SetUp()
+	{
+		for(int i = 0; i < Num_Items; ++i) {
+			items[i] = i;
+		}
+	}
+	virtual void TearDown() {}
+
+	void push(int from, int to)
+	{
+		for(int i = from; i < to; ++i) {
+			dq.pushBottom(&items[i]);
+		}
+	}
+
+	Deque dq;
+	int items[Num_Items];
+};
+
+TEST_F(OFluxWorkStealingDequeTests,EmptyDeque) {
+	EXPECT_EQ(Deque::empty,dq.popBottom());
+	EXPECT_EQ(Deque::empty,dq.steal());
+	int * out[4];
+	EXPECT_EQ(0,dq.steal_batch(out,4));
+	EXPECT_EQ(Deque::empty,out[0]);
+}
+
+TEST_F(OFluxWorkStealingDequeTests,StealTakesOldest) {
+	push(0,3);
+	EXPECT_EQ(&items[0],dq.steal());
+	EXPECT_EQ(&items[1],dq.steal());
+	EXPECT_EQ(1,dq.size());
+}
+
+TEST_F(OFluxWorkStealingDequeTests,LongDequePopsNewest) {
+	push(0,100);
+	EXPECT_EQ(&items[99],dq.popBottom());
+	EXPECT_EQ(&items[98],dq.popBottom());
+	EXPECT_EQ(98,dq.size());
+}
+
+TEST_F(OFluxWorkStealingDequeTests,ShortDequePopsNewest) {
+	// the owner's order does not depend on the depth of the deque
+	push(0,Deque::Steal_Claim_Max);
+	for(int i = Deque::Steal_Claim_Max-1; i >= 0; --i) {
+		EXPECT_EQ(&items[i],dq.popBottom());
+	}
+	EXPECT_EQ(Deque::empty,dq.popBottom());
+}
+
+TEST_F(OFluxWorkStealingDequeTests,PopFailsAStaleClaim) {
+	push(0,4);
+	int * out[Deque::Steal_Claim_Max];
+	EXPECT_EQ(2,dq.steal_batch(out,Deque::Steal_Claim_Max));
+	EXPECT_EQ(&items[3],dq.popBottom());
+	EXPECT_EQ(&items[2],dq.steal()) << "claims after a pop still work";
+	EXPECT_EQ(0,dq.size());
+}
+
+TEST_F(OFluxWorkStealingDequeTests,StealBatchClaimsHalf) {
+	push(0,10);
+	int * out[Deque::Steal_Claim_Max];
+	size_t n = dq.steal_batch(out,Deque::Steal_Claim_Max);
+	ASSERT_EQ(5,n);
+	for(size_t i = 0; i < n; ++i) {
+		EXPECT_EQ(&items[i],out[i]) << "oldest first";
+	}
+	EXPECT_EQ(5,dq.size());
+	EXPECT_EQ(1,dq.steal_batch(out,1)) << "max_n caps the batch";
+	EXPECT_EQ(&items[5],out[0]);
+}
+
+TEST_F(OFluxWorkStealingDequeTests,StealBatchIsCapped) {
+	push(0,1000);
+	int * out[2*Deque::Steal_Claim_Max];
+	size_t n = dq.steal_batch(out,2*Deque::Steal_Claim_Max);
+	EXPECT_EQ(Deque::Steal_Claim_Max,n);
+	EXPECT_EQ(1000-Deque::Steal_Claim_Max,dq.size());
+	EXPECT_EQ(&items[Deque::Steal_Claim_Max],dq.steal());
+}
+
+TEST_F(OFluxWorkStealingDequeTests,ShrinksAfterLowOccupancy) {
+	const size_t start_bytes = dq.array_bytes();
+	push(0,Num_Items);
+	size_t grown_bytes = dq.array_bytes();
+	EXPECT_GT(grown_bytes,start_bytes);
+	EXPECT_EQ(grown_bytes,dq.array_bytes_high_water());
+	// drain all but a few (newest first while the deque is long) and keep
+	// cycling those few until the array has had time to shrink all the way
+	const int left = Deque::Steal_Claim_Max;
+	for(int i = Num_Items-1; i >= left; --i) {
+		ASSERT_EQ(&items[i],dq.popBottom());
+	}
+	for(int k = 0; k < 16 * Deque::Shrink_Patience; ++k) {
+		int * e = dq.popBottom();
+		ASSERT_TRUE(e != Deque::empty);
+		dq.pushBottom(e); // occupancy stays low
+	}
+	EXPECT_EQ(start_bytes,dq.array_bytes()) << "back to the default size";
+	EXPECT_EQ(grown_bytes,dq.array_bytes_high_water());
+	EXPECT_EQ(left,dq.size());
+	int seen[left];
+	for(int i = 0; i < left; ++i) {
+		seen[i] = 0;
+	}
+	for(int i = 0; i < left; ++i) {
+		int * e = dq.steal();
+		ASSERT_TRUE(e != Deque::empty);
+		ASSERT_TRUE(*e >= 0 && *e < left);
+		++seen[*e];
+	}
+	for(int i = 0; i < left; ++i) {
+		EXPECT_EQ(1,seen[i]) << "element " << i << " survived the shrinks";
+	}
+}
+
+namespace {
+
+enum { Stress_Items = 200000, Stress_Thieves = 3 };
+
+struct StressState {
+	Deque dq;
+	int items[Stress_Items];
+	int claimed[Stress_Items];
+	volatile bool done;
+};
+
+void
+claim(StressState * s, int * e)
+{
+	__sync_fetch_and_add(&s->claimed[*e],1);
+}
+
+void *
+thief(void * v)
+{
+	oflux::lockfree::ThreadNumber::init();
+	StressState * s = reinterpret_cast<StressState *>(v);
+	int * out[Deque::Steal_Claim_Max];
+	int k = 0;
+	while(!s->done || s->dq.size() > 0) {
+		if(++k % 2) {
+			int * e = s->dq.steal();
+			if(e != Deque::empty && e != Deque::abort) {
+				claim(s,e);
+			}
+		} else {
+			size_t n = s->dq.steal_batch(out,Deque::Steal_Claim_Max);
+			for(size_t i = 0; i < n; ++i) {
+				claim(s,out[i]);
+			}
+		}
+	}
+	return NULL;
+}
+
+} // namespace
+
+TEST(OFluxWorkStealingDequeStress,EachElementClaimedOnce) {
+	StressState * s = new StressState();
+	s->done = false;
+	for(int i = 0; i < Stress_Items; ++i) {
+		s->items[i] = i;
+		s->claimed[i] = 0;
+	}
+	pthread_t th[Stress_Thieves];
+	for(int i = 0; i < Stress_Thieves; ++i) {
+		ASSERT_EQ(0,pthread_create(&th[i],NULL,thief,s));
+	}
+	int pushed = 0;
+	while(pushed < Stress_Items) {
+		// bursts of pushes and pops so the deque crosses
+		// Steal_Claim_Max in both directions (and the owner pops
+		// slots a thief may be copying)
+		int burst = 1 + (pushed % 61);
+		for(int i = 0; i < burst && pushed < Stress_Items; ++i) {
+			s->dq.pushBottom(&s->items[pushed++]);
+		}
+		for(int i = 0; i < (burst % 3 ? burst/2 : burst); ++i) {
+			int * e = s->dq.popBottom();
+			if(e == Deque::empty) {
+				break;
+			} else if(e != Deque::abort) {
+				claim(s,e);
+			}
+		}
+	}
+	s->done = true;
+	for(int i = 0; i < Stress_Thieves; ++i) {
+		pthread_join(th[i],NULL);
+	}
+	int * e;
+	while((e = s->dq.popBottom()) != Deque::empty) {
+		if(e != Deque::abort) {
+			claim(s,e);
+		}
+	}
+	for(int i = 0; i < Stress_Items; ++i) {
+		ASSERT_EQ(1,s->claimed[i]) << "element " << i;
+	}
+	delete s;
+}
+
+int main(int argc, char **argv) {
+	testing::InitGoogleTest(&argc, argv);
+	oflux::lockfree::ThreadNumber::init(); // hazard pointer slot
+	return RUN_ALL_TESTS();
+}
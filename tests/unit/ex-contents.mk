@@ -4,8 +4,23 @@ OFLUX_UNIT_TESTS += \
   OFluxOrderable_unittest.cpp \
   OFluxEvent_unittest.cpp \
   OFluxLinkedList_unittest.cpp \
-  OFluxAtomic_unittest.cpp 
+  OFluxAtomic_unittest.cpp \
+  OFluxFlowNodePool_unittest.cpp \
+  OFluxWorkStealingDeque_unittest.cpp \
+  OFluxSuccessorTable_unittest.cpp \
+  OFluxAtomicMapSharded_unittest.cpp \
+  OFluxFlowGuard_unittest.cpp \
+  OFluxMultiQueue_unittest.cpp \
+  OFluxLaneCounts_unittest.cpp \
+  OFluxFlowAdmission_unittest.cpp \
+  OFluxHandOff_unittest.cpp \
+  OFluxTopology_unittest.cpp \
+  OFluxCpuSet_unittest.cpp \
+  OFluxTimerWheel_unittest.cpp \
+  OFluxLatency_unittest.cpp \
+  OFluxMetrics_unittest.cpp \
+  OFluxDistributedCounter_unittest.cpp 
   #OFluxLFAtomic_unittest.cpp \
 
 
-OFluxEvent_unittest OFluxAtomic_unittest OFluxLFAtomic_unittest: CommonEventunit.o
+OFluxEvent_unittest OFluxAtomic_unittest OFluxLFAtomic_unittest OFluxMultiQueue_unittest: CommonEventunit.o
@@ -12,7 +12,7 @@ so $VIMRUNTIME/syntax/cpp.vim
 " Flux extentions
 syn keyword fluxStatement as where terminate handle begin end if precedence
 syn keyword fluxType guard readwrite sequence pool condition node source error atomic instance module exclusive initial plugin free
-syn keyword fluxModifier detached abstract read write external unordered gc
+syn keyword fluxModifier detached abstract read write external unordered gc sharded priority period maxinflight
 syn keyword fluxInclude include depends
 
 " Default highlighting